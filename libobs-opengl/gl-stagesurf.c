@@ -68,6 +68,8 @@ gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
 void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
 {
 	if (stagesurf) {
+		if (stagesurf->sync)
+			glDeleteSync(stagesurf->sync);
 		if (stagesurf->pack_buffer)
 			gl_delete_buffers(1, &stagesurf->pack_buffer);
 
@@ -106,6 +108,21 @@ static bool can_stage(struct gs_stage_surface *dst, struct gs_texture_2d *src)
 	return true;
 }
 
+/* inserts a fence after the readback so gs_stagesurface_ready can tell
+ * whether the copy has actually completed before the buffer is mapped */
+static void insert_fence(struct gs_stage_surface *surf)
+{
+	if (!GLAD_GL_VERSION_3_2 && !GLAD_GL_ARB_sync)
+		return;
+
+	if (surf->sync)
+		glDeleteSync(surf->sync);
+
+	surf->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	if (!gl_success("glFenceSync"))
+		surf->sync = NULL;
+}
+
 #ifdef __APPLE__
 
 /* Apparently for mac, PBOs won't do an asynchronous transfer unless you use
@@ -141,6 +158,7 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 	if (!gl_success("glReadPixels"))
 		goto failed_unbind_all;
 
+	insert_fence(dst);
 	success = true;
 
 failed_unbind_all:
@@ -172,6 +190,8 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 	if (!gl_success("glGetTexImage"))
 		goto failed;
 
+	insert_fence(dst);
+
 	gl_bind_texture(GL_TEXTURE_2D, 0);
 	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 	return;
@@ -222,6 +242,22 @@ fail:
 	return false;
 }
 
+bool gs_stagesurface_ready(gs_stagesurf_t *stagesurf)
+{
+	GLenum result;
+
+	if (!stagesurf->sync)
+		return true;
+
+	result = glClientWaitSync(stagesurf->sync, 0, 0);
+	if (result == GL_WAIT_FAILED) {
+		gl_success("glClientWaitSync");
+		return true;
+	}
+
+	return result != GL_TIMEOUT_EXPIRED;
+}
+
 void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 {
 	if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER, stagesurf->pack_buffer))
@@ -707,6 +707,10 @@ EXPORT bool     gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
 		uint32_t *linesize);
 EXPORT void     gs_stagesurface_unmap(gs_stagesurf_t *stagesurf);
 
+/** Returns true if the last copy to the stage surface has completed, and
+ *  mapping it will not stall waiting for the GPU */
+EXPORT bool     gs_stagesurface_ready(gs_stagesurf_t *stagesurf);
+
 EXPORT void     gs_zstencil_destroy(gs_zstencil_t *zstencil);
 
 EXPORT void     gs_samplerstate_destroy(gs_samplerstate_t *samplerstate);
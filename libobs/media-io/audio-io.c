@@ -25,6 +25,7 @@
 #include "../util/profiler.h"
 
 #include "audio-io.h"
+#include "audio-math.h"
 #include "audio-resampler.h"
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
@@ -54,6 +55,7 @@ struct audio_mix {
 struct audio_output {
 	struct audio_output_info   info;
 	size_t                     block_size;
+	size_t                     block_frames;
 	size_t                     channels;
 	size_t                     planes;
 
@@ -164,7 +166,8 @@ static inline void do_audio_output(struct audio_output *audio,
 	pthread_mutex_unlock(&audio->input_mutex);
 }
 
-static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
+static inline void clamp_audio_output(struct audio_output *audio, size_t bytes,
+		uint32_t active_mixes)
 {
 	size_t float_size = bytes / sizeof(float);
 
@@ -172,27 +175,18 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
 		/* do not process mixing if a specific mix is inactive */
-		if (!mix->inputs.num)
+		if ((active_mixes & (1 << mix_idx)) == 0)
 			continue;
 
-		for (size_t plane = 0; plane < audio->planes; plane++) {
-			float *mix_data = mix->buffer[plane];
-			float *mix_end = &mix_data[float_size];
-
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val >  1.0f) ?  1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
-		}
+		for (size_t plane = 0; plane < audio->planes; plane++)
+			audio_mix_clamp(mix->buffer[plane], float_size);
 	}
 }
 
 static void input_and_output(struct audio_output *audio,
 		uint64_t audio_time, uint64_t prev_time)
 {
-	size_t bytes = AUDIO_OUTPUT_FRAMES * audio->block_size;
+	size_t bytes = audio->block_frames * audio->block_size;
 	struct audio_output_data data[MAX_AUDIO_MIXES];
 	uint32_t active_mixes = 0;
 	uint64_t new_ts = 0;
@@ -213,15 +207,18 @@ static void input_and_output(struct audio_output *audio,
 	}
 	pthread_mutex_unlock(&audio->input_mutex);
 
-	/* clear mix buffers */
+	/* clear mix buffers, inactive mixes aren't rendered or output */
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
-		memset(mix->buffer[0], 0, AUDIO_OUTPUT_FRAMES *
-				MAX_AUDIO_CHANNELS * sizeof(float));
-
 		for (size_t i = 0; i < audio->planes; i++)
 			data[mix_idx].data[i] = mix->buffer[i];
+
+		if ((active_mixes & (1 << mix_idx)) == 0)
+			continue;
+
+		for (size_t i = 0; i < audio->planes; i++)
+			memset(mix->buffer[i], 0, bytes);
 	}
 
 	/* get new audio data */
@@ -231,11 +228,15 @@ static void input_and_output(struct audio_output *audio,
 		return;
 
 	/* clamps audio data to -1.0..1.0 */
-	clamp_audio_output(audio, bytes);
+	clamp_audio_output(audio, bytes, active_mixes);
 
-	/* output */
-	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
-		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+	/* output.  a mix connected after the active mixes were checked waits
+	 * until the next tick, as its buffer hasn't been rendered */
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		if ((active_mixes & (1 << i)) != 0)
+			do_audio_output(audio, i, new_ts,
+					(uint32_t)audio->block_frames);
+	}
 }
 
 static void *audio_thread(void *param)
@@ -247,7 +248,7 @@ static void *audio_thread(void *param)
 	uint64_t prev_time = start_time;
 	uint64_t audio_time = prev_time;
 	uint32_t audio_wait_time =
-		(uint32_t)(audio_frames_to_ns(rate, AUDIO_OUTPUT_FRAMES) /
+		(uint32_t)(audio_frames_to_ns(rate, audio->block_frames) /
 				1000000);
 
 	os_set_thread_name("audio-io: audio thread");
@@ -265,7 +266,7 @@ static void *audio_thread(void *param)
 
 		cur_time = os_gettime_ns();
 		while (audio_time <= cur_time) {
-			samples += AUDIO_OUTPUT_FRAMES;
+			samples += audio->block_frames;
 			audio_time = start_time +
 				audio_frames_to_ns(rate, samples);
 
@@ -392,7 +393,7 @@ void audio_output_disconnect(audio_t *audio, size_t mix_idx,
 static inline bool valid_audio_params(const struct audio_output_info *info)
 {
 	return info->format && info->name && info->samples_per_sec > 0 &&
-	       info->speakers > 0;
+	       info->speakers > 0 && info->block_frames <= AUDIO_OUTPUT_FRAMES;
 }
 
 int audio_output_open(audio_t **audio, struct audio_output_info *info)
@@ -415,6 +416,9 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 	out->input_param= info->input_param;
 	out->block_size = (planar ? 1 : out->channels) *
 	                  get_audio_bytes_per_channel(info->format);
+	out->block_frames = info->block_frames ?
+		info->block_frames : AUDIO_OUTPUT_FRAMES;
+	out->info.block_frames = (uint32_t)out->block_frames;
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		goto fail;
@@ -485,6 +489,11 @@ size_t audio_output_get_block_size(const audio_t *audio)
 	return audio ? audio->block_size : 0;
 }
 
+size_t audio_output_get_block_frames(const audio_t *audio)
+{
+	return audio ? audio->block_frames : 0;
+}
+
 size_t audio_output_get_planes(const audio_t *audio)
 {
 	return audio ? audio->planes : 0;
@@ -27,6 +27,8 @@ extern "C" {
 
 #define MAX_AUDIO_MIXES     4
 #define MAX_AUDIO_CHANNELS  2
+
+/* maximum number of frames in an output block, see audio_output_info */
 #define AUDIO_OUTPUT_FRAMES 1024
 
 /*
@@ -88,6 +90,10 @@ struct audio_output_info {
 
 	audio_input_callback_t input_callback;
 	void                   *input_param;
+
+	/* frames per output block, 0 for AUDIO_OUTPUT_FRAMES.  smaller blocks
+	 * lower latency at the cost of more frequent mixing */
+	uint32_t            block_frames;
 };
 
 struct audio_convert_info {
@@ -214,6 +220,7 @@ EXPORT void audio_output_disconnect(audio_t *video, size_t mix_idx,
 EXPORT bool audio_output_active(const audio_t *audio);
 
 EXPORT size_t audio_output_get_block_size(const audio_t *audio);
+EXPORT size_t audio_output_get_block_frames(const audio_t *audio);
 EXPORT size_t audio_output_get_planes(const audio_t *audio);
 EXPORT size_t audio_output_get_channels(const audio_t *audio);
 EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
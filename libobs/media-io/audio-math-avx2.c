@@ -0,0 +1,182 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/* AVX2 versions of the sample buffer operations in audio-math.c.  This file
+ * is compiled with AVX2 code generation enabled, so nothing in here may be
+ * called unless the CPU has been checked for AVX2 support first.
+ *
+ * Multiplies and adds are kept separate (no FMA) so the results match the
+ * SSE and C versions exactly. */
+
+#include "../util/c99defs.h"
+#include <immintrin.h>
+
+void audio_mix_add_avx2(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_add_ps(_mm256_loadu_ps(dst + i),
+				_mm256_loadu_ps(src + i));
+		_mm256_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+void audio_mix_scale_avx2(float *dst, float vol, size_t count)
+{
+	__m256 vol_val = _mm256_set1_ps(vol);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_mul_ps(_mm256_loadu_ps(dst + i), vol_val);
+		_mm256_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++)
+		dst[i] *= vol;
+}
+
+void audio_mix_scale_buf_avx2(float *dst, const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_mul_ps(_mm256_loadu_ps(dst + i),
+				_mm256_loadu_ps(vol + i));
+		_mm256_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++)
+		dst[i] *= vol[i];
+}
+
+void audio_mix_add_scaled_avx2(float *dst, const float *src, float vol,
+		size_t count)
+{
+	__m256 vol_val = _mm256_set1_ps(vol);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_mul_ps(_mm256_loadu_ps(src + i), vol_val);
+		val = _mm256_add_ps(_mm256_loadu_ps(dst + i), val);
+		_mm256_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i] * vol;
+}
+
+void audio_mix_add_scaled_buf_avx2(float *dst, const float *src,
+		const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_mul_ps(_mm256_loadu_ps(src + i),
+				_mm256_loadu_ps(vol + i));
+		val = _mm256_add_ps(_mm256_loadu_ps(dst + i), val);
+		_mm256_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i] * vol[i];
+}
+
+void audio_mix_clamp_avx2(float *dst, size_t count)
+{
+	__m256 max_val = _mm256_set1_ps(1.0f);
+	__m256 min_val = _mm256_set1_ps(-1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_min_ps(max_val, _mm256_loadu_ps(dst + i));
+		val = _mm256_max_ps(min_val, val);
+		_mm256_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++) {
+		float val = dst[i];
+		val = (val >  1.0f) ?  1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		dst[i] = val;
+	}
+}
+
+void audio_mix_crossfade_avx2(float *dst, const float *a, const float *b,
+		float t_start, float t_step, size_t count)
+{
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 step = _mm256_set1_ps(t_step);
+	__m256 start = _mm256_set1_ps(t_start);
+	__m256 idx = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f,
+			4.0f, 5.0f, 6.0f, 7.0f);
+	__m256 idx_inc = _mm256_set1_ps(8.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 t = _mm256_add_ps(start, _mm256_mul_ps(step, idx));
+		__m256 val_a = _mm256_mul_ps(_mm256_loadu_ps(a + i),
+				_mm256_sub_ps(one, t));
+		__m256 val_b = _mm256_mul_ps(_mm256_loadu_ps(b + i), t);
+
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(val_a, val_b));
+		idx = _mm256_add_ps(idx, idx_inc);
+	}
+
+	for (; i < count; i++) {
+		float t = t_start + t_step * (float)i;
+		dst[i] = a[i] * (1.0f - t) + b[i] * t;
+	}
+}
+
+void audio_level_scan_avx2(const float *src, size_t count, float *peak,
+		float *sum_squares)
+{
+	__m256 sign = _mm256_set1_ps(-0.0f);
+	__m256 max_val = _mm256_setzero_ps();
+	__m256 sum_val = _mm256_setzero_ps();
+	float max_out = *peak;
+	float sum_out = 0.0f;
+	float lanes[8];
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(src + i);
+		sum_val = _mm256_add_ps(sum_val, _mm256_mul_ps(val, val));
+		max_val = _mm256_max_ps(_mm256_andnot_ps(sign, val), max_val);
+	}
+
+	_mm256_storeu_ps(lanes, max_val);
+	for (size_t j = 0; j < 8; j++)
+		max_out = (lanes[j] > max_out) ? lanes[j] : max_out;
+
+	_mm256_storeu_ps(lanes, sum_val);
+	for (size_t j = 0; j < 8; j++)
+		sum_out += lanes[j];
+
+	for (; i < count; i++) {
+		float val = src[i] < 0.0f ? -src[i] : src[i];
+		sum_out += val * val;
+		max_out = (val > max_out) ? val : max_out;
+	}
+
+	*peak = max_out;
+	*sum_squares += sum_out;
+}
@@ -0,0 +1,376 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-math.h"
+#include "../util/platform.h"
+#include <string.h>
+#include <emmintrin.h>
+
+/* AVX2 versions live in audio-math-avx2.c, which is the only file built with
+ * AVX2 code generation */
+
+extern void audio_mix_add_avx2(float *dst, const float *src, size_t count);
+extern void audio_mix_scale_avx2(float *dst, float vol, size_t count);
+extern void audio_mix_scale_buf_avx2(float *dst, const float *vol,
+		size_t count);
+extern void audio_mix_add_scaled_avx2(float *dst, const float *src,
+		float vol, size_t count);
+extern void audio_mix_add_scaled_buf_avx2(float *dst, const float *src,
+		const float *vol, size_t count);
+extern void audio_mix_clamp_avx2(float *dst, size_t count);
+extern void audio_mix_crossfade_avx2(float *dst, const float *a,
+		const float *b, float t_start, float t_step, size_t count);
+extern void audio_level_scan_avx2(const float *src, size_t count,
+		float *peak, float *sum_squares);
+
+/* the result of the check is cached by os_cpu_has_avx2 */
+#define use_avx2() os_cpu_has_avx2()
+
+void audio_mix_add(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	if (use_avx2()) {
+		audio_mix_add_avx2(dst, src, count);
+		return;
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_add_ps(_mm_loadu_ps(dst + i),
+				_mm_loadu_ps(src + i));
+		_mm_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+void audio_mix_scale(float *dst, float vol, size_t count)
+{
+	__m128 vol_val = _mm_set1_ps(vol);
+	size_t i = 0;
+
+	if (use_avx2()) {
+		audio_mix_scale_avx2(dst, vol, count);
+		return;
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_mul_ps(_mm_loadu_ps(dst + i), vol_val);
+		_mm_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++)
+		dst[i] *= vol;
+}
+
+void audio_mix_scale_buf(float *dst, const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	if (use_avx2()) {
+		audio_mix_scale_buf_avx2(dst, vol, count);
+		return;
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_mul_ps(_mm_loadu_ps(dst + i),
+				_mm_loadu_ps(vol + i));
+		_mm_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++)
+		dst[i] *= vol[i];
+}
+
+void audio_mix_add_scaled(float *dst, const float *src, float vol,
+		size_t count)
+{
+	__m128 vol_val = _mm_set1_ps(vol);
+	size_t i = 0;
+
+	if (use_avx2()) {
+		audio_mix_add_scaled_avx2(dst, src, vol, count);
+		return;
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_mul_ps(_mm_loadu_ps(src + i), vol_val);
+		val = _mm_add_ps(_mm_loadu_ps(dst + i), val);
+		_mm_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i] * vol;
+}
+
+void audio_mix_add_scaled_buf(float *dst, const float *src,
+		const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	if (use_avx2()) {
+		audio_mix_add_scaled_buf_avx2(dst, src, vol, count);
+		return;
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_mul_ps(_mm_loadu_ps(src + i),
+				_mm_loadu_ps(vol + i));
+		val = _mm_add_ps(_mm_loadu_ps(dst + i), val);
+		_mm_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i] * vol[i];
+}
+
+/* min/max return their second operand if either is NaN, so the sample goes
+ * second to pass NaN through the same way the C comparisons do */
+void audio_mix_clamp(float *dst, size_t count)
+{
+	__m128 max_val = _mm_set1_ps(1.0f);
+	__m128 min_val = _mm_set1_ps(-1.0f);
+	size_t i = 0;
+
+	if (use_avx2()) {
+		audio_mix_clamp_avx2(dst, count);
+		return;
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_min_ps(max_val, _mm_loadu_ps(dst + i));
+		val = _mm_max_ps(min_val, val);
+		_mm_storeu_ps(dst + i, val);
+	}
+
+	for (; i < count; i++) {
+		float val = dst[i];
+		val = (val >  1.0f) ?  1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		dst[i] = val;
+	}
+}
+
+void audio_mix_crossfade(float *dst, const float *a, const float *b,
+		float t_start, float t_step, size_t count)
+{
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 step = _mm_set1_ps(t_step);
+	__m128 start = _mm_set1_ps(t_start);
+	__m128 idx = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	__m128 idx_inc = _mm_set1_ps(4.0f);
+	size_t i = 0;
+
+	if (use_avx2()) {
+		audio_mix_crossfade_avx2(dst, a, b, t_start, t_step, count);
+		return;
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 t = _mm_add_ps(start, _mm_mul_ps(step, idx));
+		__m128 val_a = _mm_mul_ps(_mm_loadu_ps(a + i),
+				_mm_sub_ps(one, t));
+		__m128 val_b = _mm_mul_ps(_mm_loadu_ps(b + i), t);
+
+		_mm_storeu_ps(dst + i, _mm_add_ps(val_a, val_b));
+		idx = _mm_add_ps(idx, idx_inc);
+	}
+
+	for (; i < count; i++) {
+		float t = t_start + t_step * (float)i;
+		dst[i] = a[i] * (1.0f - t) + b[i] * t;
+	}
+}
+
+void audio_float_to_s16(int16_t *dst, const float *src, size_t count)
+{
+	__m128 scale = _mm_set1_ps(32767.0f);
+	__m128 max_val = _mm_set1_ps(32767.0f);
+	__m128 min_val = _mm_set1_ps(-32768.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 lo = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+		__m128 hi = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+
+		lo = _mm_max_ps(_mm_min_ps(lo, max_val), min_val);
+		hi = _mm_max_ps(_mm_min_ps(hi, max_val), min_val);
+
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(
+				_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi)));
+	}
+
+	for (; i < count; i++) {
+		float val = src[i] * 32767.0f;
+		val = (val >  32767.0f) ?  32767.0f : val;
+		val = (val < -32768.0f) ? -32768.0f : val;
+		dst[i] = (int16_t)val;
+	}
+}
+
+void audio_s16_to_float(float *dst, const int16_t *src, size_t count)
+{
+	__m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i val = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(val, val), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(val, val), 16);
+
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(dst + i + 4,
+				_mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+
+	for (; i < count; i++)
+		dst[i] = (float)src[i] / 32768.0f;
+}
+
+void audio_level_scan(const float *src, size_t count, float *peak,
+		float *sum_squares)
+{
+	__m128 sign = _mm_set1_ps(-0.0f);
+	__m128 max_val = _mm_setzero_ps();
+	__m128 sum_val = _mm_setzero_ps();
+	float max_out = *peak;
+	float sum_out = 0.0f;
+	float lanes[4];
+	size_t i = 0;
+
+	if (use_avx2()) {
+		audio_level_scan_avx2(src, count, peak, sum_squares);
+		return;
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(src + i);
+		sum_val = _mm_add_ps(sum_val, _mm_mul_ps(val, val));
+		max_val = _mm_max_ps(_mm_andnot_ps(sign, val), max_val);
+	}
+
+	_mm_storeu_ps(lanes, max_val);
+	for (size_t j = 0; j < 4; j++)
+		max_out = (lanes[j] > max_out) ? lanes[j] : max_out;
+
+	_mm_storeu_ps(lanes, sum_val);
+	sum_out = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+	for (; i < count; i++) {
+		float val = fabsf(src[i]);
+		sum_out += val * val;
+		max_out = (val > max_out) ? val : max_out;
+	}
+
+	*peak = max_out;
+	*sum_squares += sum_out;
+}
+
+/* 4x oversampling filter: a 48 tap Kaiser windowed sinc split into its four
+ * phases, each normalized to unity gain and reversed so that tap 0 applies
+ * to the oldest sample */
+#define TRUE_PEAK_PHASES 4
+#define TRUE_PEAK_TAPS   (AUDIO_TRUE_PEAK_HISTORY + 1)
+#define TRUE_PEAK_CHUNK  256
+
+static const float true_peak_taps[TRUE_PEAK_PHASES][TRUE_PEAK_TAPS] = {
+	{-0.00275295f,  0.00841902f, -0.01982325f,  0.04244147f,
+	 -0.09974254f,  0.97395649f,  0.13251339f, -0.05149853f,
+	  0.02406430f, -0.01060215f,  0.00378627f, -0.00076151f},
+	{-0.00464205f,  0.01590018f, -0.03920221f,  0.08483205f,
+	 -0.18912250f,  0.77774945f,  0.45913633f, -0.15222488f,
+	  0.07027504f, -0.03184379f,  0.01220118f, -0.00305880f},
+	{-0.00305880f,  0.01220118f, -0.03184379f,  0.07027504f,
+	 -0.15222488f,  0.45913633f,  0.77774945f, -0.18912250f,
+	  0.08483205f, -0.03920221f,  0.01590018f, -0.00464205f},
+	{-0.00076151f,  0.00378627f, -0.01060215f,  0.02406430f,
+	 -0.05149853f,  0.13251339f,  0.97395649f, -0.09974254f,
+	  0.04244147f, -0.01982325f,  0.00841902f, -0.00275295f},
+};
+
+void audio_level_true_peak(const float *src, size_t count, float *history,
+		float *peak)
+{
+	float buf[AUDIO_TRUE_PEAK_HISTORY + TRUE_PEAK_CHUNK];
+	__m128 taps[TRUE_PEAK_PHASES][TRUE_PEAK_TAPS];
+	__m128 sign = _mm_set1_ps(-0.0f);
+	__m128 max_val = _mm_setzero_ps();
+	float max_out = *peak;
+	float lanes[4];
+
+	for (size_t phase = 0; phase < TRUE_PEAK_PHASES; phase++) {
+		for (size_t t = 0; t < TRUE_PEAK_TAPS; t++)
+			taps[phase][t] = _mm_set1_ps(true_peak_taps[phase][t]);
+	}
+
+	memcpy(buf, history, AUDIO_TRUE_PEAK_HISTORY * sizeof(float));
+
+	while (count) {
+		size_t frames = (count < TRUE_PEAK_CHUNK) ?
+			count : TRUE_PEAK_CHUNK;
+		size_t i = 0;
+
+		memcpy(buf + AUDIO_TRUE_PEAK_HISTORY, src,
+				frames * sizeof(float));
+
+		/* each tap is applied to four consecutive windows at once,
+		 * giving four output samples per phase */
+		for (; i + 4 <= frames; i += 4) {
+			for (size_t phase = 0; phase < TRUE_PEAK_PHASES;
+			     phase++) {
+				__m128 acc = _mm_setzero_ps();
+
+				for (size_t t = 0; t < TRUE_PEAK_TAPS; t++)
+					acc = _mm_add_ps(acc, _mm_mul_ps(
+						taps[phase][t],
+						_mm_loadu_ps(buf + i + t)));
+
+				max_val = _mm_max_ps(
+						_mm_andnot_ps(sign, acc),
+						max_val);
+			}
+		}
+
+		for (; i < frames; i++) {
+			for (size_t phase = 0; phase < TRUE_PEAK_PHASES;
+			     phase++) {
+				float val = 0.0f;
+
+				for (size_t t = 0; t < TRUE_PEAK_TAPS; t++)
+					val += true_peak_taps[phase][t] *
+						buf[i + t];
+
+				val = fabsf(val);
+				max_out = (val > max_out) ? val : max_out;
+			}
+		}
+
+		memmove(buf, buf + frames,
+				AUDIO_TRUE_PEAK_HISTORY * sizeof(float));
+		src   += frames;
+		count -= frames;
+	}
+
+	memcpy(history, buf, AUDIO_TRUE_PEAK_HISTORY * sizeof(float));
+
+	_mm_storeu_ps(lanes, max_val);
+	for (size_t j = 0; j < 4; j++)
+		max_out = (lanes[j] > max_out) ? lanes[j] : max_out;
+
+	*peak = max_out;
+}
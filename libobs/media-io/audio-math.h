@@ -1,5 +1,5 @@
 /******************************************************************************
-    Copyright (C) 2015 by Hugh Bailey <obs.jim@gmail.com>
+    Copyright (C) 2026 by agent <agent@local>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -41,3 +41,79 @@ static inline float db_to_mul(const float db)
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sample buffer operations used for mixing.  These use SSE, or AVX2 if the
+ * CPU supports it, and produce the same results as the equivalent plain C
+ * loops.  Buffers don't need to be aligned.
+ */
+
+/** dst[i] += src[i] */
+EXPORT void audio_mix_add(float *dst, const float *src, size_t count);
+
+/** dst[i] *= vol */
+EXPORT void audio_mix_scale(float *dst, float vol, size_t count);
+
+/** dst[i] *= vol[i] */
+EXPORT void audio_mix_scale_buf(float *dst, const float *vol, size_t count);
+
+/** dst[i] += src[i] * vol */
+EXPORT void audio_mix_add_scaled(float *dst, const float *src, float vol,
+		size_t count);
+
+/** dst[i] += src[i] * vol[i] */
+EXPORT void audio_mix_add_scaled_buf(float *dst, const float *src,
+		const float *vol, size_t count);
+
+/** Clamps each sample to -1.0..1.0 */
+EXPORT void audio_mix_clamp(float *dst, size_t count);
+
+/**
+ * dst[i] = a[i] * (1 - t) + b[i] * t, where t starts at t_start and increases
+ * by t_step for each sample
+ */
+EXPORT void audio_mix_crossfade(float *dst, const float *a, const float *b,
+		float t_start, float t_step, size_t count);
+
+/*
+ * 16 bit sample conversion, for code that has to hand samples to libraries
+ * working on integer samples.  These use SSE2.
+ */
+
+/** dst[i] = src[i] * 32767, truncated and clamped to the 16 bit range */
+EXPORT void audio_float_to_s16(int16_t *dst, const float *src, size_t count);
+
+/** dst[i] = src[i] / 32768 */
+EXPORT void audio_s16_to_float(float *dst, const int16_t *src, size_t count);
+
+/*
+ * Level metering.  Sums are accumulated in a different order than a plain C
+ * loop would, so they can differ from one in the last bits.
+ */
+
+/** Number of previous samples audio_level_true_peak keeps per channel */
+#define AUDIO_TRUE_PEAK_HISTORY 11
+
+/**
+ * Raises *peak to the largest absolute sample value, and adds the sum of the
+ * squared samples to *sum_squares
+ */
+EXPORT void audio_level_scan(const float *src, size_t count, float *peak,
+		float *sum_squares);
+
+/**
+ * Raises *peak to the largest absolute value of the signal oversampled four
+ * times, which catches peaks that fall between samples.  history holds the
+ * last AUDIO_TRUE_PEAK_HISTORY samples of the previous call, and should
+ * start out zeroed.
+ */
+EXPORT void audio_level_true_peak(const float *src, size_t count,
+		float *history, float *peak);
+
+#ifdef __cplusplus
+}
+#endif
@@ -15,14 +15,21 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <stdlib.h>
+#include <string.h>
 #include "../util/bmem.h"
+#include "../util/threading.h"
 #include "audio-resampler.h"
+#include "audio-resampler-native.h"
 #include "audio-io.h"
 #include <libavutil/avutil.h>
 #include <libavformat/avformat.h>
 #include <libswresample/swresample.h>
 
 struct audio_resampler {
+	/* used instead of the swr context when it supports the conversion */
+	struct native_resampler *native;
+
 	struct SwrContext   *context;
 	bool                opened;
 
@@ -77,12 +84,39 @@ static inline uint64_t convert_speaker_layout(enum speaker_layout layout)
 	return 0;
 }
 
+/* the native resampler is opt in until it's had more testing, either with
+ * audio_resampler_set_native or the OBS_NATIVE_RESAMPLER variable */
+static pthread_once_t native_once = PTHREAD_ONCE_INIT;
+static volatile bool use_native = false;
+
+static void init_use_native(void)
+{
+	const char *env = getenv("OBS_NATIVE_RESAMPLER");
+
+	if (env && *env && strcmp(env, "0") != 0)
+		os_atomic_set_bool(&use_native, true);
+}
+
+void audio_resampler_set_native(bool enable)
+{
+	pthread_once(&native_once, init_use_native);
+	os_atomic_set_bool(&use_native, enable);
+}
+
 audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 		const struct resample_info *src)
 {
 	struct audio_resampler *rs = bzalloc(sizeof(struct audio_resampler));
 	int errcode;
 
+	pthread_once(&native_once, init_use_native);
+
+	if (os_atomic_load_bool(&use_native)) {
+		rs->native = native_resampler_create(dst, src);
+		if (rs->native)
+			return rs;
+	}
+
 	rs->opened        = false;
 	rs->input_freq    = src->samples_per_sec;
 	rs->input_layout  = convert_speaker_layout(src->speakers);
@@ -119,6 +153,7 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 void audio_resampler_destroy(audio_resampler_t *rs)
 {
 	if (rs) {
+		native_resampler_destroy(rs->native);
 		if (rs->context)
 			swr_free(&rs->context);
 		if (rs->output_buffer[0])
@@ -134,6 +169,10 @@ bool audio_resampler_resample(audio_resampler_t *rs,
 {
 	if (!rs) return false;
 
+	if (rs->native)
+		return native_resampler_resample(rs->native, output,
+				out_frames, ts_offset, input, in_frames);
+
 	struct SwrContext *context = rs->context;
 	int ret;
 
@@ -0,0 +1,744 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <xmmintrin.h>
+
+#include "../util/bmem.h"
+#include "../util/threading.h"
+#include "audio-math.h"
+#include "audio-resampler-native.h"
+
+/* filter taps per phase when upsampling, scaled up when downsampling so the
+ * transition band stays the same width relative to the output rate */
+#define RESAMPLE_TAPS       32
+#define MAX_TAPS            256
+#define MAX_PHASES          1024
+
+/* passband edge relative to the lower of the two nyquist frequencies */
+#define RESAMPLE_CUTOFF     0.97
+#define KAISER_BETA         9.0
+
+#define RESAMPLE_PI         3.14159265358979323846
+
+/* gains used when downmixing, the same ones libswresample uses */
+#define MIX_LEVEL_3DB       0.70710678f
+#define MIX_LEVEL_6DB       0.5f
+
+/* ------------------------------------------------------------------------- */
+/* filter banks */
+
+struct filter_bank {
+	uint32_t           phases;
+	uint32_t           step;
+	size_t             taps;
+	float              *coeffs;
+
+	long               refs;
+	struct filter_bank *next;
+};
+
+static pthread_mutex_t bank_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct filter_bank *first_bank = NULL;
+
+static double bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+
+	for (int k = 1; k < 64; k++) {
+		double val = x / (2.0 * k);
+		term *= val * val;
+		sum += term;
+
+		if (term < sum * 1e-12)
+			break;
+	}
+
+	return sum;
+}
+
+/* kaiser windowed sinc, one row of taps per phase.  phase p of the filter
+ * produces the output that lies p/phases of an input sample past the
+ * sample the row is centered on */
+static void compute_filter_bank(struct filter_bank *bank)
+{
+	double half = (double)(bank->taps / 2);
+	double i0_beta = bessel_i0(KAISER_BETA);
+	double cutoff = RESAMPLE_CUTOFF;
+
+	if (bank->step > bank->phases)
+		cutoff *= (double)bank->phases / (double)bank->step;
+
+	for (uint32_t p = 0; p < bank->phases; p++) {
+		float *coeffs = bank->coeffs + p * bank->taps;
+		double sum = 0.0;
+
+		for (size_t k = 0; k < bank->taps; k++) {
+			double t = (double)p / (double)bank->phases +
+				half - 1.0 - (double)k;
+			double x = t / half;
+			double window = 0.0;
+			double val;
+
+			if (x > -1.0 && x < 1.0)
+				window = bessel_i0(KAISER_BETA *
+						sqrt(1.0 - x * x)) / i0_beta;
+
+			if (t == 0.0)
+				val = cutoff;
+			else
+				val = sin(RESAMPLE_PI * cutoff * t) /
+					(RESAMPLE_PI * t);
+
+			val *= window;
+			coeffs[k] = (float)val;
+			sum += val;
+		}
+
+		/* unity gain at DC for every phase */
+		for (size_t k = 0; k < bank->taps; k++)
+			coeffs[k] = (float)(coeffs[k] / sum);
+	}
+}
+
+static struct filter_bank *get_filter_bank(uint32_t phases, uint32_t step,
+		size_t taps)
+{
+	struct filter_bank *bank;
+
+	pthread_mutex_lock(&bank_mutex);
+
+	bank = first_bank;
+	while (bank) {
+		if (bank->phases == phases && bank->step == step &&
+		    bank->taps == taps) {
+			bank->refs++;
+			goto exit;
+		}
+
+		bank = bank->next;
+	}
+
+	bank = bzalloc(sizeof(struct filter_bank));
+	bank->phases = phases;
+	bank->step   = step;
+	bank->taps   = taps;
+	bank->coeffs = bmalloc(sizeof(float) * phases * taps);
+	bank->refs   = 1;
+	compute_filter_bank(bank);
+
+	bank->next = first_bank;
+	first_bank = bank;
+
+exit:
+	pthread_mutex_unlock(&bank_mutex);
+	return bank;
+}
+
+static void release_filter_bank(struct filter_bank *bank)
+{
+	struct filter_bank **p_bank;
+
+	if (!bank)
+		return;
+
+	pthread_mutex_lock(&bank_mutex);
+
+	if (--bank->refs == 0) {
+		p_bank = &first_bank;
+		while (*p_bank != bank)
+			p_bank = &(*p_bank)->next;
+		*p_bank = bank->next;
+
+		bfree(bank->coeffs);
+		bfree(bank);
+	}
+
+	pthread_mutex_unlock(&bank_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* channel layouts */
+
+struct speaker_gain {
+	float left;
+	float right;
+};
+
+#define FL  {1.0f,            0.0f}
+#define FR  {0.0f,            1.0f}
+#define FC  {MIX_LEVEL_3DB,   MIX_LEVEL_3DB}
+#define LFE {0.0f,            0.0f}
+#define SL  {MIX_LEVEL_3DB,   0.0f}
+#define SR  {0.0f,            MIX_LEVEL_3DB}
+#define BC  {MIX_LEVEL_6DB,   MIX_LEVEL_6DB}
+
+/* how much each channel contributes to a stereo downmix, in the channel
+ * order of each layout.  SPEAKERS_SURROUND is left to libswresample, as its
+ * channel count doesn't match its ffmpeg layout */
+static const struct speaker_gain mono_gains[]     = {FC};
+static const struct speaker_gain stereo_gains[]   = {FL, FR};
+static const struct speaker_gain gains_2point1[]  = {FL, FR, LFE};
+static const struct speaker_gain quad_gains[]     = {FL, FR, SL, SR};
+static const struct speaker_gain gains_4point1[]  = {FL, FR, FC, LFE, BC};
+static const struct speaker_gain gains_5point1[]  = {FL, FR, FC, LFE, SL, SR};
+static const struct speaker_gain gains_7point1[]  =
+	{FL, FR, FC, LFE, SL, SR, SL, SR};
+static const struct speaker_gain gains_7point1_wide[] =
+	{FL, FR, FC, LFE, SL, SR, FL, FR};
+
+#undef FL
+#undef FR
+#undef FC
+#undef LFE
+#undef SL
+#undef SR
+#undef BC
+
+static const struct speaker_gain *get_speaker_gains(
+		enum speaker_layout speakers)
+{
+	switch (speakers) {
+	case SPEAKERS_MONO:             return mono_gains;
+	case SPEAKERS_STEREO:           return stereo_gains;
+	case SPEAKERS_2POINT1:          return gains_2point1;
+	case SPEAKERS_QUAD:             return quad_gains;
+	case SPEAKERS_4POINT1:          return gains_4point1;
+	case SPEAKERS_5POINT1:
+	case SPEAKERS_5POINT1_SURROUND: return gains_5point1;
+	case SPEAKERS_7POINT1:          return gains_7point1;
+	case SPEAKERS_7POINT1_SURROUND: return gains_7point1_wide;
+	case SPEAKERS_SURROUND:
+	case SPEAKERS_UNKNOWN:          return NULL;
+	}
+
+	return NULL;
+}
+
+/* builds the out_ch x in_ch mixing matrix.  like libswresample, rows are
+ * only normalized for integer output, float output is allowed to exceed
+ * 1.0 */
+static float *create_mix_matrix(const struct resample_info *dst,
+		const struct resample_info *src)
+{
+	const struct speaker_gain *gains = get_speaker_gains(src->speakers);
+	size_t in_ch = get_audio_channels(src->speakers);
+	size_t out_ch = get_audio_channels(dst->speakers);
+	float *matrix = bzalloc(sizeof(float) * in_ch * out_ch);
+	float max_sum = 0.0f;
+
+	for (size_t i = 0; i < in_ch; i++) {
+		if (out_ch == 1) {
+			matrix[i] = (gains[i].left + gains[i].right) *
+				MIX_LEVEL_3DB;
+		} else {
+			matrix[i] = gains[i].left;
+			matrix[in_ch + i] = gains[i].right;
+		}
+	}
+
+	for (size_t o = 0; o < out_ch; o++) {
+		float sum = 0.0f;
+
+		for (size_t i = 0; i < in_ch; i++)
+			sum += matrix[o * in_ch + i];
+
+		if (sum > max_sum)
+			max_sum = sum;
+	}
+
+	if (dst->format != AUDIO_FORMAT_FLOAT &&
+	    dst->format != AUDIO_FORMAT_FLOAT_PLANAR && max_sum > 1.0f) {
+		for (size_t i = 0; i < in_ch * out_ch; i++)
+			matrix[i] /= max_sum;
+	}
+
+	return matrix;
+}
+
+/* ------------------------------------------------------------------------- */
+/* sample conversion */
+
+static void convert_to_float(float *const dst[], const uint8_t *const src[],
+		enum audio_format format, size_t channels, size_t frames)
+{
+	bool planar = is_audio_planar(format);
+	size_t stride = planar ? 1 : channels;
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		const uint8_t *in = planar ? src[ch] : src[0];
+		size_t offset = planar ? 0 : ch;
+		float *out = dst[ch];
+
+		switch (format) {
+		case AUDIO_FORMAT_U8BIT:
+		case AUDIO_FORMAT_U8BIT_PLANAR:
+			for (size_t i = 0; i < frames; i++)
+				out[i] = ((float)in[i * stride + offset] -
+						128.0f) * (1.0f / 128.0f);
+			break;
+
+		case AUDIO_FORMAT_16BIT:
+		case AUDIO_FORMAT_16BIT_PLANAR: {
+			const int16_t *s16 = (const int16_t*)in + offset;
+			for (size_t i = 0; i < frames; i++)
+				out[i] = (float)s16[i * stride] *
+					(1.0f / 32768.0f);
+			break;
+		}
+
+		case AUDIO_FORMAT_32BIT:
+		case AUDIO_FORMAT_32BIT_PLANAR: {
+			const int32_t *s32 = (const int32_t*)in + offset;
+			for (size_t i = 0; i < frames; i++)
+				out[i] = (float)((double)s32[i * stride] *
+						(1.0 / 2147483648.0));
+			break;
+		}
+
+		case AUDIO_FORMAT_FLOAT:
+		case AUDIO_FORMAT_FLOAT_PLANAR: {
+			const float *flt = (const float*)in + offset;
+			if (stride == 1) {
+				memcpy(out, flt, frames * sizeof(float));
+			} else {
+				for (size_t i = 0; i < frames; i++)
+					out[i] = flt[i * stride];
+			}
+			break;
+		}
+
+		case AUDIO_FORMAT_UNKNOWN:
+			break;
+		}
+	}
+}
+
+static inline float clamp_sample(float val)
+{
+	return (val > 1.0f) ? 1.0f : ((val < -1.0f) ? -1.0f : val);
+}
+
+static void convert_from_float(uint8_t *const dst[], const float *const src[],
+		enum audio_format format, size_t channels, size_t frames)
+{
+	bool planar = is_audio_planar(format);
+	size_t stride = planar ? 1 : channels;
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		uint8_t *out = planar ? dst[ch] : dst[0];
+		size_t offset = planar ? 0 : ch;
+		const float *in = src[ch];
+
+		switch (format) {
+		case AUDIO_FORMAT_U8BIT:
+		case AUDIO_FORMAT_U8BIT_PLANAR:
+			for (size_t i = 0; i < frames; i++)
+				out[i * stride + offset] = (uint8_t)lrintf(
+						clamp_sample(in[i]) * 127.0f +
+						128.0f);
+			break;
+
+		case AUDIO_FORMAT_16BIT:
+		case AUDIO_FORMAT_16BIT_PLANAR: {
+			int16_t *s16 = (int16_t*)out + offset;
+			for (size_t i = 0; i < frames; i++)
+				s16[i * stride] = (int16_t)lrintf(
+						clamp_sample(in[i]) * 32767.0f);
+			break;
+		}
+
+		case AUDIO_FORMAT_32BIT:
+		case AUDIO_FORMAT_32BIT_PLANAR: {
+			int32_t *s32 = (int32_t*)out + offset;
+			for (size_t i = 0; i < frames; i++)
+				s32[i * stride] = (int32_t)lrint(
+						(double)clamp_sample(in[i]) *
+						2147483647.0);
+			break;
+		}
+
+		case AUDIO_FORMAT_FLOAT:
+		case AUDIO_FORMAT_FLOAT_PLANAR: {
+			float *flt = (float*)out + offset;
+			if (stride == 1) {
+				memcpy(flt, in, frames * sizeof(float));
+			} else {
+				for (size_t i = 0; i < frames; i++)
+					flt[i * stride] = in[i];
+			}
+			break;
+		}
+
+		case AUDIO_FORMAT_UNKNOWN:
+			break;
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct native_resampler {
+	uint32_t            in_rate;
+	enum audio_format   in_format;
+	size_t              in_ch;
+	enum audio_format   out_format;
+	size_t              out_ch;
+
+	/* out_ch x in_ch, NULL if the layout doesn't change */
+	float               *matrix;
+	float               *mix_buf[MAX_AV_PLANES];
+	size_t              mix_size;
+
+	/* NULL if the rate doesn't change */
+	struct filter_bank  *bank;
+	float               *history[MAX_AV_PLANES];
+	size_t              history_size;
+	size_t              buffered;
+	size_t              pos;
+	uint32_t            phase;
+
+	float               *out_float[MAX_AV_PLANES];
+	uint8_t             *out_buf[MAX_AV_PLANES];
+	size_t              out_size;
+};
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+static inline bool format_supported(enum audio_format format)
+{
+	return format != AUDIO_FORMAT_UNKNOWN;
+}
+
+static bool layout_supported(const struct resample_info *dst,
+		const struct resample_info *src)
+{
+	if (!get_speaker_gains(src->speakers) ||
+	    !get_speaker_gains(dst->speakers))
+		return false;
+
+	return src->speakers == dst->speakers ||
+	       dst->speakers == SPEAKERS_MONO ||
+	       dst->speakers == SPEAKERS_STEREO;
+}
+
+static inline bool out_is_float_planar(const struct native_resampler *rs)
+{
+	return rs->out_format == AUDIO_FORMAT_FLOAT_PLANAR;
+}
+
+struct native_resampler *native_resampler_create(
+		const struct resample_info *dst,
+		const struct resample_info *src)
+{
+	struct native_resampler *rs;
+	uint32_t divisor;
+	uint32_t phases;
+	uint32_t step;
+	size_t taps = RESAMPLE_TAPS;
+
+	if (!src->samples_per_sec || !dst->samples_per_sec)
+		return NULL;
+	if (!format_supported(src->format) || !format_supported(dst->format))
+		return NULL;
+	if (!layout_supported(dst, src))
+		return NULL;
+
+	divisor = gcd(dst->samples_per_sec, src->samples_per_sec);
+	phases = dst->samples_per_sec / divisor;
+	step = src->samples_per_sec / divisor;
+
+	if (phases > MAX_PHASES)
+		return NULL;
+
+	if (step > phases) {
+		taps = (RESAMPLE_TAPS * step + phases - 1) / phases;
+		taps = (taps + 3) & ~(size_t)3;
+		if (taps > MAX_TAPS)
+			return NULL;
+	}
+
+	rs = bzalloc(sizeof(struct native_resampler));
+	rs->in_rate    = src->samples_per_sec;
+	rs->in_format  = src->format;
+	rs->in_ch      = get_audio_channels(src->speakers);
+	rs->out_format = dst->format;
+	rs->out_ch     = get_audio_channels(dst->speakers);
+
+	if (src->speakers != dst->speakers)
+		rs->matrix = create_mix_matrix(dst, src);
+
+	if (phases != step) {
+		rs->bank = get_filter_bank(phases, step, taps);
+
+		/* starts out with silence up to where the first output is
+		 * centered, so there's no delay to begin with */
+		rs->pos = rs->bank->taps / 2 - 1;
+		rs->buffered = rs->pos;
+	}
+
+	return rs;
+}
+
+void native_resampler_destroy(struct native_resampler *rs)
+{
+	if (!rs)
+		return;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		bfree(rs->mix_buf[i]);
+		bfree(rs->history[i]);
+		bfree(rs->out_float[i]);
+		bfree(rs->out_buf[i]);
+	}
+
+	release_filter_bank(rs->bank);
+	bfree(rs->matrix);
+	bfree(rs);
+}
+
+static void ensure_history(struct native_resampler *rs, size_t frames)
+{
+	if (frames <= rs->history_size)
+		return;
+
+	rs->history_size = frames * 2;
+
+	for (size_t ch = 0; ch < rs->out_ch; ch++) {
+		bool first = !rs->history[ch];
+
+		rs->history[ch] = brealloc(rs->history[ch],
+				rs->history_size * sizeof(float));
+		if (first)
+			memset(rs->history[ch], 0,
+					rs->buffered * sizeof(float));
+	}
+}
+
+static void ensure_output(struct native_resampler *rs, size_t frames)
+{
+	size_t bytes_per_frame;
+
+	/* the output pointers are expected to be valid even without output */
+	if (!frames)
+		frames = 1;
+	if (frames <= rs->out_size)
+		return;
+
+	rs->out_size = frames;
+	bytes_per_frame = get_audio_bytes_per_channel(rs->out_format);
+
+	for (size_t ch = 0; ch < rs->out_ch; ch++) {
+		bfree(rs->out_float[ch]);
+		rs->out_float[ch] = bmalloc(frames * sizeof(float));
+	}
+
+	if (out_is_float_planar(rs))
+		return;
+
+	if (is_audio_planar(rs->out_format)) {
+		for (size_t ch = 0; ch < rs->out_ch; ch++) {
+			bfree(rs->out_buf[ch]);
+			rs->out_buf[ch] = bmalloc(frames * bytes_per_frame);
+		}
+	} else {
+		bfree(rs->out_buf[0]);
+		rs->out_buf[0] = bmalloc(frames * bytes_per_frame *
+				rs->out_ch);
+	}
+}
+
+/* converts the input to float and applies the mixing matrix, writing out_ch
+ * planes to dst */
+static void mix_input(struct native_resampler *rs, float *const dst[],
+		const uint8_t *const input[], size_t frames)
+{
+	if (!rs->matrix) {
+		convert_to_float(dst, input, rs->in_format, rs->in_ch, frames);
+		return;
+	}
+
+	if (frames > rs->mix_size) {
+		rs->mix_size = frames;
+
+		for (size_t ch = 0; ch < rs->in_ch; ch++) {
+			bfree(rs->mix_buf[ch]);
+			rs->mix_buf[ch] = bmalloc(frames * sizeof(float));
+		}
+	}
+
+	convert_to_float(rs->mix_buf, input, rs->in_format, rs->in_ch,
+			frames);
+
+	for (size_t o = 0; o < rs->out_ch; o++) {
+		const float *gains = rs->matrix + o * rs->in_ch;
+
+		memset(dst[o], 0, frames * sizeof(float));
+
+		for (size_t i = 0; i < rs->in_ch; i++) {
+			if (gains[i] != 0.0f)
+				audio_mix_add_scaled(dst[o], rs->mix_buf[i],
+						gains[i], frames);
+		}
+	}
+}
+
+static inline float dot_product(const float *samples, const float *coeffs,
+		size_t count)
+{
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(samples + i),
+					_mm_loadu_ps(coeffs + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(
+					_mm_loadu_ps(samples + i + 4),
+					_mm_loadu_ps(coeffs + i + 4)));
+	}
+
+	for (; i < count; i += 4)
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(samples + i),
+					_mm_loadu_ps(coeffs + i)));
+
+	sum0 = _mm_add_ps(sum0, sum1);
+	sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+	sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+	return _mm_cvtss_f32(sum0);
+}
+
+/* delay between the next output and the end of the buffered input, which is
+ * where the next input begins */
+static uint64_t get_delay_ns(const struct native_resampler *rs)
+{
+	uint64_t phases = rs->bank->phases;
+	uint64_t delay = (uint64_t)(rs->buffered - rs->pos) * phases -
+		rs->phase;
+
+	return delay * 1000000000ULL / (phases * rs->in_rate);
+}
+
+static size_t estimate_output(const struct native_resampler *rs)
+{
+	size_t half = rs->bank->taps / 2;
+	uint64_t avail;
+
+	if (rs->pos + half >= rs->buffered)
+		return 0;
+
+	avail = (uint64_t)(rs->buffered - half - rs->pos) * rs->bank->phases;
+	return (size_t)(avail / rs->bank->step) + 1;
+}
+
+static size_t filter_output(struct native_resampler *rs)
+{
+	const struct filter_bank *bank = rs->bank;
+	size_t half = bank->taps / 2;
+	size_t pos = rs->pos;
+	uint32_t phase = rs->phase;
+	size_t count = 0;
+	size_t shift;
+
+	while (pos + half < rs->buffered) {
+		const float *coeffs = bank->coeffs + phase * bank->taps;
+		size_t start = pos + 1 - half;
+
+		for (size_t ch = 0; ch < rs->out_ch; ch++)
+			rs->out_float[ch][count] = dot_product(
+					rs->history[ch] + start, coeffs,
+					bank->taps);
+
+		count++;
+		phase += bank->step;
+		pos += phase / bank->phases;
+		phase %= bank->phases;
+	}
+
+	/* drop the input that's no longer under the filter */
+	shift = pos + 1 - half;
+	if (shift) {
+		for (size_t ch = 0; ch < rs->out_ch; ch++)
+			memmove(rs->history[ch], rs->history[ch] + shift,
+					(rs->buffered - shift) * sizeof(float));
+
+		rs->buffered -= shift;
+		pos -= shift;
+	}
+
+	rs->pos = pos;
+	rs->phase = phase;
+	return count;
+}
+
+bool native_resampler_resample(struct native_resampler *rs,
+		uint8_t *output[], uint32_t *out_frames, uint64_t *ts_offset,
+		const uint8_t *const input[], uint32_t in_frames)
+{
+	size_t frames;
+
+	if (!rs->bank) {
+		*ts_offset = 0;
+		ensure_output(rs, in_frames);
+		mix_input(rs, rs->out_float, input, in_frames);
+		frames = in_frames;
+
+	} else {
+		float *dst[MAX_AV_PLANES];
+
+		*ts_offset = get_delay_ns(rs);
+
+		ensure_history(rs, rs->buffered + in_frames);
+		for (size_t ch = 0; ch < rs->out_ch; ch++)
+			dst[ch] = rs->history[ch] + rs->buffered;
+
+		mix_input(rs, dst, input, in_frames);
+		rs->buffered += in_frames;
+
+		ensure_output(rs, estimate_output(rs));
+		frames = filter_output(rs);
+	}
+
+	if (out_is_float_planar(rs)) {
+		for (size_t ch = 0; ch < rs->out_ch; ch++)
+			output[ch] = (uint8_t*)rs->out_float[ch];
+	} else {
+		size_t planes = is_audio_planar(rs->out_format) ?
+			rs->out_ch : 1;
+
+		convert_from_float(rs->out_buf,
+				(const float *const *)rs->out_float,
+				rs->out_format, rs->out_ch, frames);
+
+		for (size_t i = 0; i < planes; i++)
+			output[i] = rs->out_buf[i];
+	}
+
+	*out_frames = (uint32_t)frames;
+	return true;
+}
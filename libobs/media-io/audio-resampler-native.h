@@ -0,0 +1,43 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "audio-resampler.h"
+
+/*
+ * Native resampler
+ *
+ *   Polyphase FIR resampler used by audio_resampler_*, when enabled with
+ * audio_resampler_set_native, in place of libswresample for the conversions
+ * it supports: any sample format, rates whose ratio reduces to a reasonable
+ * number of filter phases, and either the same speaker layout or a downmix
+ * to stereo or mono.  Filter banks are computed once per ratio and shared
+ * between resamplers.
+ */
+
+struct native_resampler;
+
+/** Returns NULL if the conversion isn't supported by the native resampler */
+extern struct native_resampler *native_resampler_create(
+		const struct resample_info *dst,
+		const struct resample_info *src);
+extern void native_resampler_destroy(struct native_resampler *rs);
+
+extern bool native_resampler_resample(struct native_resampler *rs,
+		uint8_t *output[], uint32_t *out_frames, uint64_t *ts_offset,
+		const uint8_t *const input[], uint32_t in_frames);
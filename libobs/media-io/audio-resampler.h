@@ -41,6 +41,13 @@ EXPORT bool audio_resampler_resample(audio_resampler_t *resampler,
 		 uint8_t *output[], uint32_t *out_frames, uint64_t *ts_offset,
 		 const uint8_t *const input[], uint32_t in_frames);
 
+/**
+ * Makes resamplers created after this call use the native resampler instead
+ * of libswresample for the conversions it supports.  Off by default, setting
+ * the OBS_NATIVE_RESAMPLER environment variable to 1 turns it on as well.
+ */
+EXPORT void audio_resampler_set_native(bool enable);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,388 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/* AVX2 versions of the format conversion functions.  This file is compiled
+ * with AVX2 code generation enabled, so nothing in here may be called unless
+ * the CPU has been checked for AVX2 support first (see format-conversion.c).
+ *
+ * Each function processes 8 pixels (or 16 for the decompress functions) per
+ * iteration and finishes the remainder of each row with plain C, and must
+ * produce output identical to the SSE2/C versions. */
+
+#include "../util/c99defs.h"
+#include <immintrin.h>
+
+static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
+{
+	return a < b ? a : b;
+}
+
+/* gathers byte 'idx' of each of the 8 pixels in to the low 8 bytes */
+static FORCE_INLINE __m256i byte_shuffle(char idx)
+{
+	const char z = (char)0x80;
+	return _mm256_setr_epi8(
+			idx, idx+4, idx+8, idx+12, z, z, z, z,
+			z, z, z, z, z, z, z, z,
+			idx, idx+4, idx+8, idx+12, z, z, z, z,
+			z, z, z, z, z, z, z, z);
+}
+
+static FORCE_INLINE void pack_bytes(uint8_t *dst, __m256i line,
+		__m256i shuffle, __m256i lane_join)
+{
+	__m256i val = _mm256_shuffle_epi8(line, shuffle);
+	val = _mm256_permutevar8x32_epi32(val, lane_join);
+	_mm_storel_epi64((__m128i*)dst, _mm256_castsi256_si128(val));
+}
+
+/* averages the U/V values of each 2x2 block; returns U0 V0 U1 V1 .. U3 V3 in
+ * the low 8 bytes */
+static FORCE_INLINE __m128i average_chroma(__m256i line1, __m256i line2,
+		__m256i uv_mask, __m256i pair_join)
+{
+	__m256i sum = _mm256_add_epi16(
+			_mm256_and_si256(line1, uv_mask),
+			_mm256_and_si256(line2, uv_mask));
+	sum = _mm256_add_epi16(sum,
+			_mm256_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	sum = _mm256_srli_epi16(sum, 2);
+	sum = _mm256_permutevar8x32_epi32(sum, pair_join);
+
+	__m128i uv = _mm256_castsi256_si128(sum);
+	return _mm_packus_epi16(uv, uv);
+}
+
+#define avg4(a, b, c, d) \
+	(uint8_t)(((uint32_t)(a) + (uint32_t)(b) + \
+	           (uint32_t)(c) + (uint32_t)(d)) >> 2)
+
+void compress_uyvx_to_i420_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t  *lum_plane   = output[0];
+	uint8_t  *u_plane     = output[1];
+	uint8_t  *v_plane     = output[2];
+	uint32_t width        = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_simd   = width & ~7;
+	uint32_t y;
+
+	__m256i lum_shuffle = byte_shuffle(1);
+	__m256i lane_join   = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+	__m256i pair_join   = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+	__m256i uv_mask     = _mm256_set1_epi16(0x00FF);
+	__m128i uv_split    = _mm_setr_epi8(0, 2, 4, 6, 1, 3, 5, 7,
+			-1, -1, -1, -1, -1, -1, -1, -1);
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *img0 = input + y * in_linesize;
+		const uint8_t *img1 = img0 + in_linesize;
+		uint8_t *lum0 = lum_plane + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *u    = u_plane + (y>>1) * out_linesize[1];
+		uint8_t *v    = v_plane + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x < width_simd; x += 8) {
+			__m256i line1 = _mm256_loadu_si256(
+					(const __m256i*)(img0 + x*4));
+			__m256i line2 = _mm256_loadu_si256(
+					(const __m256i*)(img1 + x*4));
+
+			pack_bytes(lum0 + x, line1, lum_shuffle, lane_join);
+			pack_bytes(lum1 + x, line2, lum_shuffle, lane_join);
+
+			__m128i uv = average_chroma(line1, line2, uv_mask,
+					pair_join);
+			uv = _mm_shuffle_epi8(uv, uv_split);
+
+			*(uint32_t*)(u + (x>>1)) = (uint32_t)_mm_cvtsi128_si32(uv);
+			*(uint32_t*)(v + (x>>1)) = (uint32_t)_mm_cvtsi128_si32(
+					_mm_srli_si128(uv, 4));
+		}
+
+		for (; x < width; x += 2) {
+			const uint8_t *p0 = img0 + x*4;
+			const uint8_t *p1 = img1 + x*4;
+
+			lum0[x]   = p0[1];
+			lum0[x+1] = p0[5];
+			lum1[x]   = p1[1];
+			lum1[x+1] = p1[5];
+			u[x>>1]   = avg4(p0[0], p0[4], p1[0], p1[4]);
+			v[x>>1]   = avg4(p0[2], p0[6], p1[2], p1[6]);
+		}
+	}
+}
+
+void compress_uyvx_to_nv12_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t  *lum_plane    = output[0];
+	uint8_t  *chroma_plane = output[1];
+	uint32_t width         = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_simd    = width & ~7;
+	uint32_t y;
+
+	__m256i lum_shuffle = byte_shuffle(1);
+	__m256i lane_join   = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+	__m256i pair_join   = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+	__m256i uv_mask     = _mm256_set1_epi16(0x00FF);
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *img0 = input + y * in_linesize;
+		const uint8_t *img1 = img0 + in_linesize;
+		uint8_t *lum0   = lum_plane + y * out_linesize[0];
+		uint8_t *lum1   = lum0 + out_linesize[0];
+		uint8_t *chroma = chroma_plane + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x < width_simd; x += 8) {
+			__m256i line1 = _mm256_loadu_si256(
+					(const __m256i*)(img0 + x*4));
+			__m256i line2 = _mm256_loadu_si256(
+					(const __m256i*)(img1 + x*4));
+
+			pack_bytes(lum0 + x, line1, lum_shuffle, lane_join);
+			pack_bytes(lum1 + x, line2, lum_shuffle, lane_join);
+
+			_mm_storel_epi64((__m128i*)(chroma + x),
+					average_chroma(line1, line2, uv_mask,
+						pair_join));
+		}
+
+		for (; x < width; x += 2) {
+			const uint8_t *p0 = img0 + x*4;
+			const uint8_t *p1 = img1 + x*4;
+
+			lum0[x]     = p0[1];
+			lum0[x+1]   = p0[5];
+			lum1[x]     = p1[1];
+			lum1[x+1]   = p1[5];
+			chroma[x]   = avg4(p0[0], p0[4], p1[0], p1[4]);
+			chroma[x+1] = avg4(p0[2], p0[6], p1[2], p1[6]);
+		}
+	}
+}
+
+void convert_uyvx_to_i444_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t  *lum_plane   = output[0];
+	uint8_t  *u_plane     = output[1];
+	uint8_t  *v_plane     = output[2];
+	uint32_t width        = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_simd   = width & ~7;
+	uint32_t y;
+
+	__m256i lum_shuffle = byte_shuffle(1);
+	__m256i u_shuffle   = byte_shuffle(0);
+	__m256i v_shuffle   = byte_shuffle(2);
+	__m256i lane_join   = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+	for (y = start_y; y < end_y; y++) {
+		const uint8_t *img = input + y * in_linesize;
+		uint32_t pos       = y * out_linesize[0];
+		uint32_t x;
+
+		for (x = 0; x < width_simd; x += 8) {
+			__m256i line = _mm256_loadu_si256(
+					(const __m256i*)(img + x*4));
+
+			pack_bytes(lum_plane + pos + x, line, lum_shuffle,
+					lane_join);
+			pack_bytes(u_plane + pos + x, line, u_shuffle,
+					lane_join);
+			pack_bytes(v_plane + pos + x, line, v_shuffle,
+					lane_join);
+		}
+
+		for (; x < width; x++) {
+			const uint8_t *p = img + x*4;
+
+			lum_plane[pos + x] = p[1];
+			u_plane[pos + x]   = p[0];
+			v_plane[pos + x]   = p[2];
+		}
+	}
+}
+
+/* expands 8 packed 16-bit chroma pairs (U | V<<8) in to the chroma bits of
+ * 16 packed pixels */
+static FORCE_INLINE void expand_chroma(__m128i uv, __m256i *lo, __m256i *hi)
+{
+	*lo = _mm256_slli_epi32(_mm256_cvtepu16_epi32(
+				_mm_unpacklo_epi16(uv, uv)), 8);
+	*hi = _mm256_slli_epi32(_mm256_cvtepu16_epi32(
+				_mm_unpackhi_epi16(uv, uv)), 8);
+}
+
+static FORCE_INLINE void store_lum_chroma(uint32_t *output,
+		const uint8_t *lum, __m256i uv_lo, __m256i uv_hi)
+{
+	__m128i l = _mm_loadu_si128((const __m128i*)lum);
+
+	_mm256_storeu_si256((__m256i*)output, _mm256_or_si256(
+				_mm256_cvtepu8_epi32(l), uv_lo));
+	_mm256_storeu_si256((__m256i*)(output + 8), _mm256_or_si256(
+				_mm256_cvtepu8_epi32(_mm_srli_si128(l, 8)),
+				uv_hi));
+}
+
+void decompress_420_avx2(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t start_y_d2 = start_y/2;
+	uint32_t width_d2   = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t width_simd = width_d2 & ~7;
+	uint32_t height_d2  = end_y/2;
+	uint32_t y;
+
+	for (y = start_y_d2; y < height_d2; y++) {
+		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
+		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
+		const uint8_t *lum0    = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1    = lum0 + in_linesize[0];
+		uint32_t *output0 = (uint32_t*)(output + y * 2 * out_linesize);
+		uint32_t *output1 = (uint32_t*)((uint8_t*)output0 +
+				out_linesize);
+		uint32_t x;
+
+		for (x = 0; x < width_simd; x += 8) {
+			__m128i u  = _mm_loadl_epi64(
+					(const __m128i*)(chroma0 + x));
+			__m128i v  = _mm_loadl_epi64(
+					(const __m128i*)(chroma1 + x));
+			__m256i uv_lo, uv_hi;
+
+			expand_chroma(_mm_unpacklo_epi8(u, v), &uv_lo, &uv_hi);
+			store_lum_chroma(output0 + x*2, lum0 + x*2,
+					uv_lo, uv_hi);
+			store_lum_chroma(output1 + x*2, lum1 + x*2,
+					uv_lo, uv_hi);
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t out = (chroma0[x] << 8) | (chroma1[x] << 16);
+
+			output0[x*2]   = lum0[x*2]   | out;
+			output0[x*2+1] = lum0[x*2+1] | out;
+			output1[x*2]   = lum1[x*2]   | out;
+			output1[x*2+1] = lum1[x*2+1] | out;
+		}
+	}
+}
+
+void decompress_nv12_avx2(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t start_y_d2 = start_y/2;
+	uint32_t width_d2   = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t width_simd = width_d2 & ~7;
+	uint32_t height_d2  = end_y/2;
+	uint32_t y;
+
+	for (y = start_y_d2; y < height_d2; y++) {
+		const uint8_t *chroma = input[1] + y * in_linesize[1];
+		const uint8_t *lum0   = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1   = lum0 + in_linesize[0];
+		uint32_t *output0 = (uint32_t*)(output + y * 2 * out_linesize);
+		uint32_t *output1 = (uint32_t*)((uint8_t*)output0 +
+				out_linesize);
+		uint32_t x;
+
+		for (x = 0; x < width_simd; x += 8) {
+			__m128i uv = _mm_loadu_si128(
+					(const __m128i*)(chroma + x*2));
+			__m256i uv_lo, uv_hi;
+
+			expand_chroma(uv, &uv_lo, &uv_hi);
+			store_lum_chroma(output0 + x*2, lum0 + x*2,
+					uv_lo, uv_hi);
+			store_lum_chroma(output1 + x*2, lum1 + x*2,
+					uv_lo, uv_hi);
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t out = (chroma[x*2] << 8) |
+				(chroma[x*2+1] << 16);
+
+			output0[x*2]   = lum0[x*2]   | out;
+			output0[x*2+1] = lum0[x*2+1] | out;
+			output1[x*2]   = lum1[x*2]   | out;
+			output1[x*2+1] = lum1[x*2+1] | out;
+		}
+	}
+}
+
+void decompress_422_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize,
+		bool leading_lum)
+{
+	uint32_t width_d2   = min_uint32(in_linesize, out_linesize)/2;
+	uint32_t width_simd = width_d2 & ~7;
+	uint32_t keep_mask  = leading_lum ? 0xFFFFFF00 : 0xFFFF00FF;
+	uint32_t lum_mask   = leading_lum ? 0x000000FF : 0x0000FF00;
+	uint32_t y;
+
+	__m256i keep = _mm256_set1_epi32((int)keep_mask);
+	__m256i lum  = _mm256_set1_epi32((int)lum_mask);
+
+	for (y = start_y; y < end_y; y++) {
+		const uint32_t *input32 = (const uint32_t*)(input +
+				y * in_linesize);
+		uint32_t *output32 = (uint32_t*)(output + y * out_linesize);
+		uint32_t x;
+
+		for (x = 0; x < width_simd; x += 8) {
+			__m256i in = _mm256_loadu_si256(
+					(const __m256i*)(input32 + x));
+			__m256i second = _mm256_or_si256(
+					_mm256_and_si256(in, keep),
+					_mm256_and_si256(
+						_mm256_srli_epi32(in, 16),
+						lum));
+			__m256i lo = _mm256_unpacklo_epi32(in, second);
+			__m256i hi = _mm256_unpackhi_epi32(in, second);
+
+			_mm256_storeu_si256((__m256i*)(output32 + x*2),
+					_mm256_permute2x128_si256(lo, hi, 0x20));
+			_mm256_storeu_si256((__m256i*)(output32 + x*2 + 8),
+					_mm256_permute2x128_si256(lo, hi, 0x31));
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t dw = input32[x];
+
+			output32[x*2]   = dw;
+			output32[x*2+1] = (dw & keep_mask) |
+				((dw >> 16) & lum_mask);
+		}
+	}
+}
@@ -16,6 +16,7 @@
 ******************************************************************************/
 
 #include "format-conversion.h"
+#include "../util/platform.h"
 #include <xmmintrin.h>
 #include <emmintrin.h>
 
@@ -89,6 +90,40 @@ static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
 	return a < b ? a : b;
 }
 
+/* ------------------------------------------------------------------------- */
+/* AVX2 versions live in format-conversion-avx2.c, which is the only file
+ * built with AVX2 code generation, and are only called if the CPU and OS
+ * both support it */
+
+extern void compress_uyvx_to_i420_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[]);
+extern void compress_uyvx_to_nv12_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[]);
+extern void convert_uyvx_to_i444_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[]);
+extern void decompress_420_avx2(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize);
+extern void decompress_nv12_avx2(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize);
+extern void decompress_422_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize,
+		bool leading_lum);
+
+/* the result of the check is cached by os_cpu_has_avx2 */
+#define use_avx2() os_cpu_has_avx2()
+
 void compress_uyvx_to_i420(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
@@ -103,6 +138,12 @@ void compress_uyvx_to_i420(
 	__m128i lum_mask = _mm_set1_epi32(0x0000FF00);
 	__m128i uv_mask  = _mm_set1_epi16(0x00FF);
 
+	if (use_avx2()) {
+		compress_uyvx_to_i420_avx2(input, in_linesize, start_y, end_y,
+				output, out_linesize);
+		return;
+	}
+
 	for (y = start_y; y < end_y; y += 2) {
 		uint32_t y_pos        = y      * in_linesize;
 		uint32_t chroma_y_pos = (y>>1) * out_linesize[1];
@@ -140,6 +181,12 @@ void compress_uyvx_to_nv12(
 	__m128i lum_mask = _mm_set1_epi32(0x0000FF00);
 	__m128i uv_mask  = _mm_set1_epi16(0x00FF);
 
+	if (use_avx2()) {
+		compress_uyvx_to_nv12_avx2(input, in_linesize, start_y, end_y,
+				output, out_linesize);
+		return;
+	}
+
 	for (y = start_y; y < end_y; y += 2) {
 		uint32_t y_pos        = y      * in_linesize;
 		uint32_t chroma_y_pos = (y>>1) * out_linesize[1];
@@ -178,6 +225,12 @@ void convert_uyvx_to_i444(
 	__m128i u_mask   = _mm_set1_epi32(0x000000FF);
 	__m128i v_mask   = _mm_set1_epi32(0x00FF0000);
 
+	if (use_avx2()) {
+		convert_uyvx_to_i444_avx2(input, in_linesize, start_y, end_y,
+				output, out_linesize);
+		return;
+	}
+
 	for (y = start_y; y < end_y; y += 2) {
 		uint32_t y_pos        = y      * in_linesize;
 		uint32_t lum_y_pos    = y      * out_linesize[0];
@@ -212,6 +265,12 @@ void decompress_420(
 	uint32_t height_d2  = end_y/2;
 	uint32_t y;
 
+	if (use_avx2()) {
+		decompress_420_avx2(input, in_linesize, start_y, end_y,
+				output, out_linesize);
+		return;
+	}
+
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
 		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
@@ -221,8 +280,8 @@ void decompress_420(
 
 		lum0 = input[0] + y * 2 * in_linesize[0];
 		lum1 = lum0 + in_linesize[0];
-		output0 = (uint32_t*)(output + y * 2 * in_linesize[0]);
-		output1 = (uint32_t*)((uint8_t*)output0 + in_linesize[0]);
+		output0 = (uint32_t*)(output + y * 2 * out_linesize);
+		output1 = (uint32_t*)((uint8_t*)output0 + out_linesize);
 
 		for (x = 0; x < width_d2; x++) {
 			uint32_t out;
@@ -247,6 +306,12 @@ void decompress_nv12(
 	uint32_t height_d2  = end_y/2;
 	uint32_t y;
 
+	if (use_avx2()) {
+		decompress_nv12_avx2(input, in_linesize, start_y, end_y,
+				output, out_linesize);
+		return;
+	}
+
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint16_t *chroma;
 		register const uint8_t *lum0, *lum1;
@@ -284,6 +349,12 @@ void decompress_422(
 	register const uint32_t *input32_end;
 	register uint32_t       *output32;
 
+	if (use_avx2()) {
+		decompress_422_avx2(input, in_linesize, start_y, end_y,
+				output, out_linesize, leading_lum);
+		return;
+	}
+
 	if (leading_lum) {
 		for (y = start_y; y < end_y; y++) {
 			input32     = (const uint32_t*)(input + y*in_linesize);
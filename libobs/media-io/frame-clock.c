@@ -0,0 +1,270 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../util/bmem.h"
+#include "../util/threading.h"
+#include "../util/platform.h"
+#include "frame-clock.h"
+
+/* spin time bounds, in nanoseconds.  the spin covers the wake up latency of
+ * the sleep, so it's kept at twice the recent average oversleep */
+#define MIN_SPIN_TIME 50000ULL
+#define MAX_SPIN_TIME 1000000ULL
+
+static const uint64_t jitter_limits[FRAME_CLOCK_JITTER_BUCKETS] = {
+	10000ULL,
+	25000ULL,
+	50000ULL,
+	100000ULL,
+	250000ULL,
+	500000ULL,
+	1000000ULL,
+	2000000ULL,
+	5000000ULL,
+	UINT64_MAX
+};
+
+struct frame_clock {
+	pthread_mutex_t          mutex;
+	uint64_t                 interval;
+
+	uint64_t                 spin_time;
+	uint64_t                 avg_oversleep;
+
+	uint64_t                 audio_ts;
+	uint64_t                 audio_tick_time;
+	bool                     drift_base_set;
+	int64_t                  drift_base;
+
+	struct frame_clock_stats stats;
+};
+
+frame_clock_t *frame_clock_create(void)
+{
+	struct frame_clock *clock = bzalloc(sizeof(struct frame_clock));
+
+	if (pthread_mutex_init(&clock->mutex, NULL) != 0) {
+		bfree(clock);
+		return NULL;
+	}
+
+	clock->spin_time = MIN_SPIN_TIME;
+	return clock;
+}
+
+void frame_clock_destroy(frame_clock_t *clock)
+{
+	if (clock) {
+		pthread_mutex_destroy(&clock->mutex);
+		bfree(clock);
+	}
+}
+
+void frame_clock_reset(frame_clock_t *clock, uint64_t interval_ns)
+{
+	if (!clock) return;
+
+	pthread_mutex_lock(&clock->mutex);
+	memset(&clock->stats, 0, sizeof(clock->stats));
+	clock->interval             = interval_ns;
+	clock->stats.frame_interval = interval_ns;
+	clock->drift_base_set       = false;
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+void frame_clock_reset_audio(frame_clock_t *clock)
+{
+	if (!clock) return;
+
+	pthread_mutex_lock(&clock->mutex);
+	clock->audio_tick_time       = 0;
+	clock->drift_base_set        = false;
+	clock->stats.audio_drift     = 0;
+	clock->stats.max_audio_drift = 0;
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+void frame_clock_audio_tick(frame_clock_t *clock, uint64_t audio_ts)
+{
+	uint64_t cur_time = os_gettime_ns();
+
+	if (!clock) return;
+
+	pthread_mutex_lock(&clock->mutex);
+	clock->audio_ts        = audio_ts;
+	clock->audio_tick_time = cur_time;
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+static inline void calibrate_spin(struct frame_clock *clock,
+		uint64_t oversleep)
+{
+	uint64_t spin;
+
+	clock->avg_oversleep = (clock->avg_oversleep * 7 + oversleep) / 8;
+
+	spin = clock->avg_oversleep * 2;
+	if (spin < MIN_SPIN_TIME)
+		spin = MIN_SPIN_TIME;
+	else if (spin > MAX_SPIN_TIME)
+		spin = MAX_SPIN_TIME;
+
+	clock->spin_time = spin;
+}
+
+#if defined(_WIN32) || defined(__APPLE__)
+
+/* os_sleepto_ns already finishes its wait by spinning on windows, and there's
+ * no absolute sleep on mac */
+static inline void sleep_until(struct frame_clock *clock, uint64_t target)
+{
+	os_sleepto_ns(target);
+	UNUSED_PARAMETER(clock);
+}
+
+#else
+
+/* os_gettime_ns uses CLOCK_MONOTONIC, so it can be used as an absolute time
+ * for clock_nanosleep */
+static inline void sleep_until(struct frame_clock *clock, uint64_t target)
+{
+	uint64_t cur_time = os_gettime_ns();
+
+	if (target > cur_time + clock->spin_time) {
+		uint64_t sleep_target = target - clock->spin_time;
+		struct timespec ts;
+
+		ts.tv_sec  = (time_t)(sleep_target / 1000000000ULL);
+		ts.tv_nsec = (long)(sleep_target % 1000000000ULL);
+
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+					NULL) == EINTR);
+
+		cur_time = os_gettime_ns();
+		calibrate_spin(clock, cur_time > sleep_target ?
+				cur_time - sleep_target : 0);
+	}
+
+	while (cur_time < target)
+		cur_time = os_gettime_ns();
+}
+
+#endif
+
+static inline void add_jitter(struct frame_clock_stats *stats,
+		uint64_t jitter)
+{
+	for (size_t i = 0; i < FRAME_CLOCK_JITTER_BUCKETS; i++) {
+		if (jitter <= jitter_limits[i]) {
+			stats->jitter[i]++;
+			break;
+		}
+	}
+
+	if (jitter > stats->max_jitter)
+		stats->max_jitter = jitter;
+}
+
+/* the audio clock only ticks once per audio block, so its current position
+ * is estimated from the time that has passed since its last tick */
+static inline void update_audio_drift(struct frame_clock *clock,
+		uint64_t video_ts, uint64_t cur_time)
+{
+	uint64_t audio_ts;
+	int64_t offset;
+	int64_t drift;
+
+	if (!clock->audio_tick_time)
+		return;
+
+	audio_ts = clock->audio_ts + (cur_time - clock->audio_tick_time);
+	offset = (int64_t)(video_ts - audio_ts);
+
+	if (!clock->drift_base_set) {
+		clock->drift_base     = offset;
+		clock->drift_base_set = true;
+	}
+
+	drift = offset - clock->drift_base;
+	clock->stats.audio_drift = drift;
+
+	if (llabs(drift) > llabs(clock->stats.max_audio_drift))
+		clock->stats.max_audio_drift = drift;
+}
+
+int frame_clock_wait(frame_clock_t *clock, uint64_t *p_time)
+{
+	uint64_t interval = clock->interval;
+	uint64_t target = *p_time + interval;
+	uint64_t cur_time = os_gettime_ns();
+	bool render_lagged = cur_time >= target;
+	int count;
+
+	if (!render_lagged) {
+		sleep_until(clock, target);
+		cur_time = os_gettime_ns();
+
+		/* relative sleeps can come back marginally early */
+		if (cur_time < target)
+			cur_time = target;
+	}
+
+	count = (int)((cur_time - *p_time) / interval);
+	*p_time += interval * count;
+
+	pthread_mutex_lock(&clock->mutex);
+
+	clock->stats.total_frames += count;
+	clock->stats.spin_time = clock->spin_time;
+
+	if (render_lagged) {
+		clock->stats.render_lagged_frames += count - 1;
+	} else {
+		clock->stats.sleep_lagged_frames += count - 1;
+		add_jitter(&clock->stats, cur_time - target);
+	}
+
+	update_audio_drift(clock, *p_time, cur_time);
+
+	pthread_mutex_unlock(&clock->mutex);
+
+	return count;
+}
+
+void frame_clock_get_stats(frame_clock_t *clock,
+		struct frame_clock_stats *stats)
+{
+	if (!clock) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	pthread_mutex_lock(&clock->mutex);
+	*stats = clock->stats;
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+uint64_t frame_clock_jitter_limit(size_t bucket)
+{
+	return bucket < FRAME_CLOCK_JITTER_BUCKETS ?
+		jitter_limits[bucket] : UINT64_MAX;
+}
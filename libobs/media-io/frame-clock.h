@@ -0,0 +1,102 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Frame clock
+ *
+ *   Paces a thread to a fixed frame interval.  Waits sleep until shortly
+ * before the next frame and spin for the rest, with the spin time
+ * calibrated from how late recent sleeps woke up.  The clock keeps track of
+ * wake up jitter and of how far it drifts from the audio clock, and tells
+ * apart frames that were missed because rendering ran long from frames that
+ * were missed because the thread woke up late.
+ */
+
+#define FRAME_CLOCK_JITTER_BUCKETS 10
+
+struct frame_clock;
+typedef struct frame_clock frame_clock_t;
+
+struct frame_clock_stats {
+	uint64_t frame_interval;
+	uint64_t total_frames;
+
+	/* frames missed because the previous frame took too long to render */
+	uint64_t render_lagged_frames;
+
+	/* frames missed because the thread woke up too late */
+	uint64_t sleep_lagged_frames;
+
+	/* wake up jitter histogram, see frame_clock_jitter_limit */
+	uint64_t jitter[FRAME_CLOCK_JITTER_BUCKETS];
+	uint64_t max_jitter;
+
+	/* current calibrated spin time, in nanoseconds */
+	uint64_t spin_time;
+
+	/* how far the frame clock has moved ahead of (positive) or behind
+	 * (negative) the audio clock since it was first compared to it, in
+	 * nanoseconds */
+	int64_t  audio_drift;
+	int64_t  max_audio_drift;
+};
+
+EXPORT frame_clock_t *frame_clock_create(void);
+EXPORT void frame_clock_destroy(frame_clock_t *clock);
+
+/** Sets the frame interval and resets the statistics */
+EXPORT void frame_clock_reset(frame_clock_t *clock, uint64_t interval_ns);
+
+/**
+ * Waits for the frame after the one at *p_time and stores the timestamp of
+ * the new frame in *p_time.
+ *
+ * @return  The number of frame intervals that elapsed, which is more than 1
+ *          if frames were missed
+ */
+EXPORT int frame_clock_wait(frame_clock_t *clock, uint64_t *p_time);
+
+/**
+ * Notifies the clock that the audio clock reached the given timestamp.
+ * Called from the audio thread.
+ */
+EXPORT void frame_clock_audio_tick(frame_clock_t *clock, uint64_t audio_ts);
+
+/** Restarts the drift measurement, such as when the audio clock restarts */
+EXPORT void frame_clock_reset_audio(frame_clock_t *clock);
+
+EXPORT void frame_clock_get_stats(frame_clock_t *clock,
+		struct frame_clock_stats *stats);
+
+/**
+ * Returns the upper bound in nanoseconds of a jitter histogram bucket.  A
+ * wake up lands in the first bucket whose limit it doesn't exceed.  The
+ * last bucket has no upper bound and returns UINT64_MAX.
+ */
+EXPORT uint64_t frame_clock_jitter_limit(size_t bucket);
+
+#ifdef __cplusplus
+}
+#endif
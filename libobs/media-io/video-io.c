@@ -30,18 +30,216 @@
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 #define MAX_CONVERT_BUFFERS 3
+#define MAX_INPUT_QUEUE 3
 #define MAX_CACHE_SIZE 16
+#define MAX_RECENT_SCALED (MAX_INPUT_QUEUE * 2)
+
+/* ------------------------------------------------------------------------- */
+/* reference counted frame buffers
+ *
+ * frames are handed to inputs by reference rather than being copied.  each
+ * buffer comes from a pool of same-sized frames, and is returned to the pool
+ * once the last reference is released.  buffers hold a reference to their
+ * pool so that consumers can keep frames past the lifetime of the output */
+
+struct video_frame_pool;
+
+struct video_frame_buffer {
+	struct video_frame         frame;
+	volatile long              refs;
+	struct video_frame_pool    *pool;
+	struct video_frame_buffer  *next;
+};
+
+struct video_frame_pool {
+	pthread_mutex_t            mutex;
+	volatile long              refs;
+	bool                       closed;
+
+	enum video_format          format;
+	uint32_t                   width;
+	uint32_t                   height;
+
+	size_t                     max_free;
+	size_t                     num_free;
+	struct video_frame_buffer  *free_buffers;
+};
+
+static struct video_frame_pool *frame_pool_create(enum video_format format,
+		uint32_t width, uint32_t height, size_t max_free)
+{
+	struct video_frame_pool *pool = bzalloc(sizeof(*pool));
+
+	if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
+		bfree(pool);
+		return NULL;
+	}
+
+	pool->refs     = 1;
+	pool->format   = format;
+	pool->width    = width;
+	pool->height   = height;
+	pool->max_free = max_free;
+	return pool;
+}
+
+static inline void frame_pool_release(struct video_frame_pool *pool)
+{
+	if (os_atomic_dec_long(&pool->refs) == 0) {
+		pthread_mutex_destroy(&pool->mutex);
+		bfree(pool);
+	}
+}
+
+static inline void frame_buffer_free(struct video_frame_buffer *buffer)
+{
+	struct video_frame_pool *pool = buffer->pool;
+
+	video_frame_free(&buffer->frame);
+	bfree(buffer);
+	frame_pool_release(pool);
+}
+
+/* frees all unused buffers; buffers still referenced are freed when they are
+ * released */
+static void frame_pool_close(struct video_frame_pool *pool)
+{
+	struct video_frame_buffer *buffer;
+
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->closed = true;
+	buffer = pool->free_buffers;
+	pool->free_buffers = NULL;
+	pool->num_free = 0;
+	pthread_mutex_unlock(&pool->mutex);
+
+	while (buffer) {
+		struct video_frame_buffer *next = buffer->next;
+		frame_buffer_free(buffer);
+		buffer = next;
+	}
+
+	frame_pool_release(pool);
+}
+
+static struct video_frame_buffer *frame_pool_get(struct video_frame_pool *pool)
+{
+	struct video_frame_buffer *buffer;
+
+	pthread_mutex_lock(&pool->mutex);
+	buffer = pool->free_buffers;
+	if (buffer) {
+		pool->free_buffers = buffer->next;
+		pool->num_free--;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (!buffer) {
+		buffer = bzalloc(sizeof(*buffer));
+		buffer->pool = pool;
+		video_frame_init(&buffer->frame, pool->format, pool->width,
+				pool->height);
+		os_atomic_inc_long(&pool->refs);
+	}
+
+	buffer->refs = 1;
+	buffer->next = NULL;
+	return buffer;
+}
+
+static void frame_buffer_release(struct video_frame_buffer *buffer)
+{
+	struct video_frame_pool *pool;
+
+	if (!buffer || os_atomic_dec_long(&buffer->refs) != 0)
+		return;
+
+	pool = buffer->pool;
+
+	pthread_mutex_lock(&pool->mutex);
+	if (!pool->closed && pool->num_free < pool->max_free) {
+		buffer->next = pool->free_buffers;
+		pool->free_buffers = buffer;
+		pool->num_free++;
+		buffer = NULL;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (buffer)
+		frame_buffer_free(buffer);
+}
+
+static inline void set_frame_buffer(struct video_data *data,
+		struct video_frame_buffer *buffer)
+{
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		data->data[i]     = buffer->frame.data[i];
+		data->linesize[i] = buffer->frame.linesize[i];
+	}
+
+	data->buffer = buffer;
+}
+
+bool video_data_addref(struct video_data *frame)
+{
+	if (!frame || !frame->buffer)
+		return false;
+
+	os_atomic_inc_long(&frame->buffer->refs);
+	return true;
+}
+
+void video_data_release(struct video_data *frame)
+{
+	if (frame && frame->buffer) {
+		frame_buffer_release(frame->buffer);
+		frame->buffer = NULL;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
 
 struct cached_frame_info {
 	struct video_data frame;
 	int count;
 };
 
-struct video_input {
+/* scaled frames are shared between all inputs that use the same conversion,
+ * so each distinct conversion is only scaled once per frame.  the most recent
+ * scaled frames are kept so that inputs further behind in their queues can
+ * still find them */
+struct video_scaled_output {
 	struct video_scale_info   conversion;
 	video_scaler_t            *scaler;
-	struct video_frame        frame[MAX_CONVERT_BUFFERS];
-	int                       cur_frame;
+	struct video_frame_pool   *frames;
+	size_t                    inputs;
+
+	pthread_mutex_t           mutex;
+	struct video_data         recent[MAX_RECENT_SCALED];
+	size_t                    next_recent;
+};
+
+struct video_input {
+	struct video_scale_info   conversion;
+	struct video_scaled_output *scaled;
+
+	/* each input is fed by its own thread so that a slow consumer (such
+	 * as an encoder) cannot hold up the other inputs.  queued frames are
+	 * references to the output's frame buffers, so nothing is copied */
+	struct video_output       *video;
+	pthread_t                 thread;
+	bool                      thread_initialized;
+	volatile bool             stop;
+	bool                      free_on_exit;
+	os_sem_t                  *queue_semaphore;
+	pthread_mutex_t           queue_mutex;
+	struct video_data         queue[MAX_INPUT_QUEUE];
+	size_t                    first_queued;
+	size_t                    num_queued;
+	uint32_t                  skipped_frames;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
@@ -49,9 +247,14 @@ struct video_input {
 
 static inline void video_input_free(struct video_input *input)
 {
-	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
+	for (size_t i = 0; i < input->num_queued; i++) {
+		size_t idx = (input->first_queued + i) % MAX_INPUT_QUEUE;
+		video_data_release(&input->queue[idx]);
+	}
+
+	os_sem_destroy(input->queue_semaphore);
+	pthread_mutex_destroy(&input->queue_mutex);
+	bfree(input);
 }
 
 struct video_output {
@@ -69,47 +272,283 @@ struct video_output {
 	bool                       initialized;
 
 	pthread_mutex_t            input_mutex;
-	DARRAY(struct video_input) inputs;
+	DARRAY(struct video_input*) inputs;
+	DARRAY(struct video_scaled_output*) scaled_outputs;
 
 	size_t                     available_frames;
 	size_t                     first_added;
 	size_t                     last_added;
 	struct cached_frame_info   cache[MAX_CACHE_SIZE];
+	struct video_frame_pool    *frames;
 };
 
 /* ------------------------------------------------------------------------- */
 
+static inline bool scale_info_equal(const struct video_scale_info *a,
+		const struct video_scale_info *b)
+{
+	return a->format     == b->format &&
+	       a->width      == b->width &&
+	       a->height     == b->height &&
+	       a->range      == b->range &&
+	       a->colorspace == b->colorspace;
+}
+
+static void scaled_output_destroy(struct video_scaled_output *scaled)
+{
+	for (size_t i = 0; i < MAX_RECENT_SCALED; i++)
+		video_data_release(&scaled->recent[i]);
+
+	frame_pool_close(scaled->frames);
+	video_scaler_destroy(scaled->scaler);
+	pthread_mutex_destroy(&scaled->mutex);
+	bfree(scaled);
+}
+
+static struct video_scaled_output *scaled_output_create(
+		struct video_output *video,
+		const struct video_scale_info *conversion)
+{
+	struct video_scaled_output *scaled = bzalloc(sizeof(*scaled));
+	struct video_scale_info from = {
+		.format = video->info.format,
+		.width  = video->info.width,
+		.height = video->info.height,
+	};
+
+	scaled->conversion = *conversion;
+
+	if (pthread_mutex_init(&scaled->mutex, NULL) != 0) {
+		bfree(scaled);
+		return NULL;
+	}
+
+	int ret = video_scaler_create(&scaled->scaler, conversion, &from,
+			VIDEO_SCALE_FAST_BILINEAR);
+	if (ret != VIDEO_SCALER_SUCCESS) {
+		if (ret == VIDEO_SCALER_BAD_CONVERSION)
+			blog(LOG_ERROR, "video_input_init: Bad "
+			                "scale conversion type");
+		else
+			blog(LOG_ERROR, "video_input_init: Failed to "
+			                "create scaler");
+
+		scaled_output_destroy(scaled);
+		return NULL;
+	}
+
+	scaled->frames = frame_pool_create(conversion->format,
+			conversion->width, conversion->height,
+			MAX_CONVERT_BUFFERS + MAX_RECENT_SCALED);
+	if (!scaled->frames) {
+		scaled_output_destroy(scaled);
+		return NULL;
+	}
+
+	return scaled;
+}
+
+/* call with input_mutex locked */
+static struct video_scaled_output *scaled_output_get(
+		struct video_output *video,
+		const struct video_scale_info *conversion)
+{
+	struct video_scaled_output *scaled;
+
+	for (size_t i = 0; i < video->scaled_outputs.num; i++) {
+		scaled = video->scaled_outputs.array[i];
+
+		if (scale_info_equal(&scaled->conversion, conversion)) {
+			scaled->inputs++;
+			return scaled;
+		}
+	}
+
+	scaled = scaled_output_create(video, conversion);
+	if (scaled) {
+		scaled->inputs = 1;
+		da_push_back(video->scaled_outputs, &scaled);
+	}
+
+	return scaled;
+}
+
+/* call with input_mutex locked */
+static void scaled_output_release(struct video_output *video,
+		struct video_scaled_output *scaled)
+{
+	if (!scaled || --scaled->inputs != 0)
+		return;
+
+	da_erase_item(video->scaled_outputs, &scaled);
+	scaled_output_destroy(scaled);
+}
+
 static inline bool scale_video_output(struct video_input *input,
 		struct video_data *data)
 {
+	struct video_scaled_output *scaled = input->scaled;
+	struct video_frame_buffer *buffer;
 	bool success = true;
 
-	if (input->scaler) {
-		struct video_frame *frame;
-
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+	if (!scaled)
+		return true;
 
-		frame = &input->frame[input->cur_frame];
+	pthread_mutex_lock(&scaled->mutex);
 
-		success = video_scaler_scale(input->scaler,
-				frame->data, frame->linesize,
-				(const uint8_t * const*)data->data,
-				data->linesize);
+	for (size_t i = 0; i < MAX_RECENT_SCALED; i++) {
+		struct video_data *recent = &scaled->recent[i];
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i]     = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
-			}
-		} else {
-			blog(LOG_WARNING, "video-io: Could not scale frame!");
+		if (recent->buffer && recent->timestamp == data->timestamp) {
+			video_data_release(data);
+			*data = *recent;
+			video_data_addref(data);
+			goto unlock;
 		}
 	}
 
+	buffer = frame_pool_get(scaled->frames);
+
+	success = video_scaler_scale(scaled->scaler,
+			buffer->frame.data, buffer->frame.linesize,
+			(const uint8_t * const*)data->data,
+			data->linesize);
+
+	video_data_release(data);
+
+	if (success) {
+		struct video_data *recent = &scaled->recent[scaled->next_recent];
+
+		set_frame_buffer(data, buffer);
+
+		video_data_release(recent);
+		*recent = *data;
+		video_data_addref(recent);
+
+		if (++scaled->next_recent == MAX_RECENT_SCALED)
+			scaled->next_recent = 0;
+	} else {
+		frame_buffer_release(buffer);
+		blog(LOG_WARNING, "video-io: Could not scale frame!");
+	}
+
+unlock:
+	pthread_mutex_unlock(&scaled->mutex);
 	return success;
 }
 
+static void video_input_cur_frame(struct video_input *input)
+{
+	struct video_data frame;
+
+	pthread_mutex_lock(&input->queue_mutex);
+	frame = input->queue[input->first_queued];
+	if (++input->first_queued == MAX_INPUT_QUEUE)
+		input->first_queued = 0;
+	input->num_queued--;
+	pthread_mutex_unlock(&input->queue_mutex);
+
+	if (scale_video_output(input, &frame))
+		input->callback(input->param, &frame);
+
+	video_data_release(&frame);
+}
+
+static void *input_thread(void *param)
+{
+	struct video_input *input = param;
+
+	os_set_thread_name("video-io: input thread");
+
+	const char *input_thread_name =
+		profile_store_name(obs_get_profiler_name_store(),
+				"video_input_thread(%s)",
+				input->video->info.name);
+
+	while (os_sem_wait(input->queue_semaphore) == 0) {
+		if (input->stop)
+			break;
+
+		profile_start(input_thread_name);
+		video_input_cur_frame(input);
+		profile_end(input_thread_name);
+
+		profile_reenable_thread();
+	}
+
+	/* the input was disconnected from within its own callback */
+	if (input->free_on_exit)
+		video_input_free(input);
+
+	return NULL;
+}
+
+/* returns false if the input is being stopped from its own thread, in which
+ * case the thread frees the input once the current callback returns */
+static bool video_input_stop(struct video_input *input)
+{
+	void *thread_ret;
+
+	if (!input->thread_initialized)
+		return true;
+
+	input->thread_initialized = false;
+	input->stop = true;
+	os_sem_post(input->queue_semaphore);
+
+	if (pthread_equal(pthread_self(), input->thread)) {
+		input->free_on_exit = true;
+		pthread_detach(input->thread);
+		return false;
+	}
+
+	pthread_join(input->thread, &thread_ret);
+	return true;
+}
+
+/* the input must already be removed from video->inputs, and input_mutex
+ * must not be held: the input's thread may be blocked on input_mutex (e.g.
+ * an encoder disconnecting itself after an error), so joining it with the
+ * lock held would never return */
+static void video_input_destroy(struct video_input *input)
+{
+	struct video_output *video = input->video;
+	bool stopped = video_input_stop(input);
+
+	/* if stopped from its own thread, the input is inside its callback
+	 * and will no longer use the scaler */
+	pthread_mutex_lock(&video->input_mutex);
+	scaled_output_release(video, input->scaled);
+	input->scaled = NULL;
+	pthread_mutex_unlock(&video->input_mutex);
+
+	if (stopped)
+		video_input_free(input);
+}
+
+static void video_input_push_frame(struct video_input *input,
+		const struct video_data *data)
+{
+	size_t idx;
+
+	pthread_mutex_lock(&input->queue_mutex);
+
+	if (input->num_queued == MAX_INPUT_QUEUE) {
+		input->skipped_frames++;
+		pthread_mutex_unlock(&input->queue_mutex);
+		return;
+	}
+
+	idx = (input->first_queued + input->num_queued) % MAX_INPUT_QUEUE;
+	input->queue[idx] = *data;
+	video_data_addref(&input->queue[idx]);
+	input->num_queued++;
+
+	pthread_mutex_unlock(&input->queue_mutex);
+
+	os_sem_post(input->queue_semaphore);
+}
+
 static inline bool video_output_cur_frame(struct video_output *video)
 {
 	struct cached_frame_info *frame_info;
@@ -127,13 +566,9 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 	pthread_mutex_lock(&video->input_mutex);
 
-	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array+i;
-		struct video_data frame = frame_info->frame;
-
-		if (scale_video_output(input, &frame))
-			input->callback(input->param, &frame);
-	}
+	for (size_t i = 0; i < video->inputs.num; i++)
+		video_input_push_frame(video->inputs.array[i],
+				&frame_info->frame);
 
 	pthread_mutex_unlock(&video->input_mutex);
 
@@ -145,6 +580,8 @@ static inline bool video_output_cur_frame(struct video_output *video)
 	complete = --frame_info->count == 0;
 
 	if (complete) {
+		video_data_release(&frame_info->frame);
+
 		if (++video->first_added == video->info.cache_size)
 			video->first_added = 0;
 
@@ -195,20 +632,19 @@ static inline bool valid_video_params(const struct video_output_info *info)
 	       info->fps_num != 0;
 }
 
-static inline void init_cache(struct video_output *video)
+static inline bool init_cache(struct video_output *video)
 {
 	if (video->info.cache_size > MAX_CACHE_SIZE)
 		video->info.cache_size = MAX_CACHE_SIZE;
 
-	for (size_t i = 0; i < video->info.cache_size; i++) {
-		struct video_frame *frame;
-		frame = (struct video_frame*)&video->cache[i];
-
-		video_frame_init(frame, video->info.format,
-				video->info.width, video->info.height);
-	}
+	/* frame buffers are only allocated as they are needed, so keep
+	 * enough around for a full cache plus a full input queue */
+	video->frames = frame_pool_create(video->info.format,
+			video->info.width, video->info.height,
+			video->info.cache_size + MAX_INPUT_QUEUE);
 
 	video->available_frames = video->info.cache_size;
+	return video->frames != NULL;
 }
 
 int video_output_open(video_t **video, struct video_output_info *info)
@@ -238,11 +674,11 @@ int video_output_open(video_t **video, struct video_output_info *info)
 		goto fail;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
 		goto fail;
+	if (!init_cache(out))
+		goto fail;
 	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
 		goto fail;
 
-	init_cache(out);
-
 	out->initialized = true;
 	*video = out;
 	return VIDEO_OUTPUT_SUCCESS;
@@ -260,11 +696,13 @@ void video_output_close(video_t *video)
 	video_output_stop(video);
 
 	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+		video_input_destroy(video->inputs.array[i]);
 	da_free(video->inputs);
+	da_free(video->scaled_outputs);
 
 	for (size_t i = 0; i < video->info.cache_size; i++)
-		video_frame_free((struct video_frame*)&video->cache[i]);
+		video_data_release(&video->cache[i].frame);
+	frame_pool_close(video->frames);
 
 	os_sem_destroy(video->update_semaphore);
 	pthread_mutex_destroy(&video->data_mutex);
@@ -277,7 +715,7 @@ static size_t video_get_input_idx(const video_t *video,
 		void *param)
 {
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array+i;
+		struct video_input *input = video->inputs.array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -291,33 +729,22 @@ static inline bool video_input_init(struct video_input *input,
 	if (input->conversion.width  != video->info.width ||
 	    input->conversion.height != video->info.height ||
 	    input->conversion.format != video->info.format) {
-		struct video_scale_info from = {
-			.format = video->info.format,
-			.width  = video->info.width,
-			.height = video->info.height,
-		};
-
-		int ret = video_scaler_create(&input->scaler,
-				&input->conversion, &from,
-				VIDEO_SCALE_FAST_BILINEAR);
-		if (ret != VIDEO_SCALER_SUCCESS) {
-			if (ret == VIDEO_SCALER_BAD_CONVERSION)
-				blog(LOG_ERROR, "video_input_init: Bad "
-				                "scale conversion type");
-			else
-				blog(LOG_ERROR, "video_input_init: Failed to "
-				                "create scaler");
-
+		input->scaled = scaled_output_get(video, &input->conversion);
+		if (!input->scaled)
 			return false;
-		}
+	}
 
-		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i],
-					input->conversion.format,
-					input->conversion.width,
-					input->conversion.height);
+	if (pthread_mutex_init(&input->queue_mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&input->queue_semaphore, 0) != 0)
+		return false;
+	if (pthread_create(&input->thread, NULL, input_thread, input) != 0) {
+		blog(LOG_ERROR, "video_input_init: Failed to create input "
+		                "thread");
+		return false;
 	}
 
+	input->thread_initialized = true;
 	return true;
 }
 
@@ -326,6 +753,7 @@ bool video_output_connect(video_t *video,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param)
 {
+	struct video_input *input = NULL;
 	bool success = false;
 
 	if (!video || !callback)
@@ -334,32 +762,36 @@ bool video_output_connect(video_t *video,
 	pthread_mutex_lock(&video->input_mutex);
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		input = bzalloc(sizeof(*input));
 
-		input.callback = callback;
-		input.param    = param;
+		pthread_mutex_init_value(&input->queue_mutex);
+		input->video    = video;
+		input->callback = callback;
+		input->param    = param;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format    = video->info.format;
-			input.conversion.width     = video->info.width;
-			input.conversion.height    = video->info.height;
+			input->conversion.format    = video->info.format;
+			input->conversion.width     = video->info.width;
+			input->conversion.height    = video->info.height;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
 
-		success = video_input_init(&input, video);
+		success = video_input_init(input, video);
 		if (success)
 			da_push_back(video->inputs, &input);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
 
+	if (input && !success)
+		video_input_destroy(input);
+
 	return success;
 }
 
@@ -370,15 +802,20 @@ void video_output_disconnect(video_t *video,
 	if (!video || !callback)
 		return;
 
+	struct video_input *input = NULL;
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array+idx);
+		input = video->inputs.array[idx];
 		da_erase(video->inputs, idx);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
+
+	if (input)
+		video_input_destroy(input);
 }
 
 bool video_output_active(const video_t *video)
@@ -416,6 +853,7 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 		cfi = &video->cache[video->last_added];
 		cfi->frame.timestamp = timestamp;
 		cfi->count = count;
+		set_frame_buffer(&cfi->frame, frame_pool_get(video->frames));
 
 		memcpy(frame, &cfi->frame, sizeof(*frame));
 
@@ -499,3 +937,23 @@ uint32_t video_output_get_total_frames(const video_t *video)
 {
 	return video->total_frames;
 }
+
+uint32_t video_output_get_input_skipped_frames(video_t *video,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param)
+{
+	uint32_t skipped = 0;
+
+	if (!video || !callback)
+		return 0;
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	size_t idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID)
+		skipped = video->inputs.array[idx]->skipped_frames;
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return skipped;
+}
@@ -24,6 +24,7 @@ extern "C" {
 #endif
 
 struct video_frame;
+struct video_frame_buffer;
 
 /* Base video output component.  Use this to create a video output track. */
 
@@ -68,6 +69,9 @@ struct video_data {
 	uint8_t           *data[MAX_AV_PLANES];
 	uint32_t          linesize[MAX_AV_PLANES];
 	uint64_t          timestamp;
+
+	/* reference counted buffer that owns the data, if any */
+	struct video_frame_buffer *buffer;
 };
 
 struct video_output_info {
@@ -169,6 +173,14 @@ EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 		int count, uint64_t timestamp);
 EXPORT void video_output_unlock_frame(video_t *video);
 EXPORT uint64_t video_output_get_frame_time(const video_t *video);
+
+/* Frames passed to output callbacks are reference counted and must be treated
+ * as read-only.  To use a frame after the callback returns, call
+ * video_data_addref on a copy of the frame and video_data_release once done
+ * with it.  video_data_addref returns false if the frame is not reference
+ * counted, in which case the data must be copied instead. */
+EXPORT bool video_data_addref(struct video_data *frame);
+EXPORT void video_data_release(struct video_data *frame);
 EXPORT void video_output_stop(video_t *video);
 EXPORT bool video_output_stopped(video_t *video);
 
@@ -180,6 +192,12 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+/* Gets the number of frames that were not delivered to a connected input
+ * because it was still busy processing previous frames */
+EXPORT uint32_t video_output_get_input_skipped_frames(video_t *video,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param);
+
 
 #ifdef __cplusplus
 }
@@ -265,28 +265,6 @@ static void volmeter_source_destroyed(void *vptr, calldata_t *calldata)
 	obs_volmeter_detach_source(volmeter);
 }
 
-/* TODO: Separate for individual channels */
-static void volmeter_sum_and_max(float *data[MAX_AV_PLANES], size_t frames,
-		float *sum, float *max)
-{
-	float s  = *sum;
-	float m  = *max;
-
-	for (size_t plane = 0; plane < MAX_AV_PLANES; plane++) {
-		if (!data[plane])
-			break;
-
-		for (float *c = data[plane]; c < data[plane] + frames; ++c) {
-			const float pow = *c * *c;
-			s += pow;
-			m  = (m > pow) ? m : pow;
-		}
-	}
-
-	*sum = s;
-	*max = m;
-}
-
 /**
  * @todo The IIR low pass filter has a different behavior depending on the
  *       update interval and sample rate, it should be replaced with something
@@ -323,48 +301,31 @@ static void volmeter_calc_ival_levels(obs_volmeter_t *volmeter)
 	volmeter->ival_max    = 0.0f;
 }
 
-static bool volmeter_process_audio_data(obs_volmeter_t *volmeter,
-		const struct audio_data *data)
+/* the levels are measured once per packet by libobs and shared by every meter
+ * of the source, so the meter only has to combine them over its interval */
+static bool volmeter_process_levels(obs_volmeter_t *volmeter,
+		const struct obs_audio_levels *levels)
 {
-	bool updated   = false;
-	size_t frames  = 0;
-	size_t left    = data->frames;
-	float *adata[MAX_AV_PLANES];
-
-	for (size_t i = 0; i < MAX_AV_PLANES; i++)
-		adata[i] = (float*)data->data[i];
-
-	while (left) {
-		frames  = (volmeter->ival_frames + left >
-				volmeter->update_frames)
-			? volmeter->update_frames - volmeter->ival_frames
-			: left;
+	for (size_t ch = 0; ch < levels->channels; ch++) {
+		const float peak = levels->peak[ch] * levels->peak[ch];
+		const float rms  = levels->rms[ch];
 
-		volmeter_sum_and_max(adata, frames, &volmeter->ival_sum,
-				&volmeter->ival_max);
-
-		volmeter->ival_frames += (unsigned int)frames;
-		left                  -= frames;
-
-		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-			if (!adata[i])
-				break;
-			adata[i] += frames;
-		}
+		volmeter->ival_sum += rms * rms * (float)levels->frames;
+		if (peak > volmeter->ival_max)
+			volmeter->ival_max = peak;
+	}
 
-		/* break if we did not reach the end of the interval */
-		if (volmeter->ival_frames != volmeter->update_frames)
-			break;
+	volmeter->ival_frames += levels->frames;
 
-		volmeter_calc_ival_levels(volmeter);
-		updated = true;
-	}
+	if (volmeter->ival_frames < volmeter->update_frames)
+		return false;
 
-	return updated;
+	volmeter_calc_ival_levels(volmeter);
+	return true;
 }
 
-static void volmeter_source_data_received(void *vptr, obs_source_t *source,
-		const struct audio_data *data, bool muted)
+static void volmeter_source_levels_received(void *vptr, obs_source_t *source,
+		const struct obs_audio_levels *levels)
 {
 	struct obs_volmeter *volmeter = (struct obs_volmeter *) vptr;
 	bool updated = false;
@@ -372,7 +333,7 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source,
 
 	pthread_mutex_lock(&volmeter->mutex);
 
-	updated = volmeter_process_audio_data(volmeter, data);
+	updated = volmeter_process_levels(volmeter, levels);
 
 	if (updated) {
 		mul   = db_to_mul(volmeter->cur_db);
@@ -386,7 +347,8 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source,
 	pthread_mutex_unlock(&volmeter->mutex);
 
 	if (updated)
-		signal_levels_updated(volmeter, level, mag, peak, muted);
+		signal_levels_updated(volmeter, level, mag, peak,
+				levels->muted);
 
 	UNUSED_PARAMETER(source);
 }
@@ -691,8 +653,8 @@ bool obs_volmeter_attach_source(obs_volmeter_t *volmeter, obs_source_t *source)
 			volmeter_source_volume_changed, volmeter);
 	signal_handler_connect(sh, "destroy",
 			volmeter_source_destroyed, volmeter);
-	obs_source_add_audio_capture_callback(source,
-			volmeter_source_data_received, volmeter);
+	obs_source_add_audio_levels_callback(source,
+			volmeter_source_levels_received, volmeter);
 	vol = obs_source_get_volume(source);
 
 	pthread_mutex_lock(&volmeter->mutex);
@@ -726,8 +688,8 @@ void obs_volmeter_detach_source(obs_volmeter_t *volmeter)
 			volmeter_source_volume_changed, volmeter);
 	signal_handler_disconnect(sh, "destroy",
 			volmeter_source_destroyed, volmeter);
-	obs_source_remove_audio_capture_callback(source,
-			volmeter_source_data_received, volmeter);
+	obs_source_remove_audio_levels_callback(source,
+			volmeter_source_levels_received, volmeter);
 }
 
 void obs_volmeter_set_update_interval(obs_volmeter_t *volmeter,
@@ -16,6 +16,7 @@
 ******************************************************************************/
 
 #include <inttypes.h>
+#include "media-io/audio-math.h"
 #include "obs-internal.h"
 
 struct ts_info {
@@ -24,7 +25,6 @@ struct ts_info {
 };
 
 #define DEBUG_AUDIO 0
-#define MAX_BUFFERING_TICKS 45
 
 static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 {
@@ -38,16 +38,203 @@ static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 	UNUSED_PARAMETER(parent);
 }
 
+void obs_audio_tree_changed(void)
+{
+	if (obs)
+		os_atomic_set_bool(&obs->audio.tree_changed, true);
+}
+
+static void clear_cached_tree(struct obs_core_audio *audio)
+{
+	for (size_t i = 0; i < audio->cached_render_order.num; i++)
+		obs_weak_source_release(audio->cached_render_order.array[i]);
+	for (size_t i = 0; i < audio->cached_root_nodes.num; i++)
+		obs_weak_source_release(audio->cached_root_nodes.array[i]);
+
+	da_resize(audio->cached_render_order, 0);
+	da_resize(audio->cached_root_nodes, 0);
+}
+
+/* walks the whole tree, which takes the lock of every scene and transition
+ * in it, and caches the result for the following ticks */
+static void build_audio_tree(struct obs_core_audio *audio)
+{
+	struct obs_core_data *data = &obs->data;
+	struct obs_source *source;
+
+	/* cleared first, so a change made while walking the tree is picked up
+	 * on the next tick */
+	os_atomic_set_bool(&audio->tree_changed, false);
+	audio->tree_age_ticks = 0;
+
+	clear_cached_tree(audio);
+
+	/* NOTE: these are source channels, not audio channels */
+	for (uint32_t i = 0; i < MAX_CHANNELS; i++) {
+		obs_source_t *source = obs_get_output_source(i);
+		if (source) {
+			obs_source_enum_active_tree(source, push_audio_tree,
+					audio);
+			push_audio_tree(NULL, source, audio);
+			da_push_back(audio->root_nodes, &source);
+			obs_source_release(source);
+		}
+	}
+
+	pthread_mutex_lock(&data->audio_sources_mutex);
+
+	source = data->first_audio_source;
+	while (source) {
+		push_audio_tree(NULL, source, audio);
+		source = (struct obs_source*)source->next_audio_source;
+	}
+
+	pthread_mutex_unlock(&data->audio_sources_mutex);
+
+	da_reserve(audio->cached_render_order, audio->render_order.num);
+	da_reserve(audio->cached_root_nodes, audio->root_nodes.num);
+
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_weak_source_t *weak = obs_source_get_weak_source(
+				audio->render_order.array[i]);
+		da_push_back(audio->cached_render_order, &weak);
+	}
+
+	for (size_t i = 0; i < audio->root_nodes.num; i++) {
+		obs_weak_source_t *weak = obs_source_get_weak_source(
+				audio->root_nodes.array[i]);
+		da_push_back(audio->cached_root_nodes, &weak);
+	}
+}
+
+/* takes a reference to every source in the cached render order.  a source
+ * that's being destroyed can no longer be referenced, it's skipped and the
+ * tree is rebuilt next tick */
+static void load_audio_tree(struct obs_core_audio *audio)
+{
+	for (size_t i = 0; i < audio->cached_render_order.num; i++) {
+		obs_source_t *source = obs_weak_source_get_source(
+				audio->cached_render_order.array[i]);
+
+		if (source)
+			da_push_back(audio->render_order, &source);
+		else
+			obs_audio_tree_changed();
+	}
+
+	/* root nodes are in the render order as well, so they don't need a
+	 * reference of their own */
+	for (size_t i = 0; i < audio->cached_root_nodes.num; i++) {
+		obs_source_t *source = obs_weak_source_get_source(
+				audio->cached_root_nodes.array[i]);
+
+		if (source) {
+			da_push_back(audio->root_nodes, &source);
+			obs_source_release(source);
+		}
+	}
+
+	audio->tree_age_ticks++;
+}
+
+struct audio_render_job {
+	obs_source_t **sources;
+	uint32_t     mixers;
+	size_t       channels;
+	size_t       sample_rate;
+	size_t       size;
+};
+
+static inline void render_audio_source(obs_source_t *source,
+		const struct audio_render_job *job)
+{
+	const char *name = source->audio_render_name;
+
+	if (name)
+		profile_start(name);
+
+	obs_source_audio_render(source, job->mixers, job->channels,
+			job->sample_rate, job->size);
+
+	if (name)
+		profile_end(name);
+}
+
+/* every source with a realtime ring is drained each tick, not just the ones
+ * in the render tree, so the ring of a source that isn't currently shown
+ * doesn't fill up and start dropping packets */
+static void flush_rt_audio(struct obs_core_data *data)
+{
+	struct obs_source *source;
+
+	pthread_mutex_lock(&data->audio_sources_mutex);
+
+	source = data->first_audio_source;
+	while (source) {
+		if (source->rt_audio_buf)
+			obs_source_flush_audio_rt(source);
+
+		source = (struct obs_source*)source->next_audio_source;
+	}
+
+	pthread_mutex_unlock(&data->audio_sources_mutex);
+}
+
+static void render_audio_task(void *param, size_t idx)
+{
+	struct audio_render_job *job = param;
+	render_audio_source(job->sources[idx], job);
+}
+
+/* sources without a custom audio_render callback only read their own input
+ * and write their own output, so they're rendered in parallel first.
+ * composite sources mix their children, so they're rendered afterwards in
+ * render order, which puts children before their parents */
+static void render_audio_sources(struct obs_core_audio *audio, uint32_t mixers,
+		size_t channels, size_t sample_rate, size_t size)
+{
+	struct audio_render_job job = {NULL, mixers, channels, sample_rate,
+		size};
+
+	da_resize(audio->parallel_sources, 0);
+
+	if (audio->render_pool) {
+		for (size_t i = 0; i < audio->render_order.num; i++) {
+			obs_source_t *source = audio->render_order.array[i];
+
+			if (!source->info.audio_render)
+				da_push_back(audio->parallel_sources, &source);
+		}
+	}
+
+	if (audio->parallel_sources.num > 1) {
+		job.sources = audio->parallel_sources.array;
+		task_pool_run(audio->render_pool, render_audio_task, &job,
+				audio->parallel_sources.num);
+	} else {
+		da_resize(audio->parallel_sources, 0);
+	}
+
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+
+		if (audio->parallel_sources.num && !source->info.audio_render)
+			continue;
+
+		render_audio_source(source, &job);
+	}
+}
+
 static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 {
 	return (size_t)(t * (uint64_t)sample_rate / 1000000000ULL);
 }
 
 static inline void mix_audio(struct audio_output_data *mixes,
-		obs_source_t *source, size_t channels, size_t sample_rate,
-		struct ts_info *ts)
+		obs_source_t *source, uint32_t mixers, size_t channels,
+		size_t sample_rate, size_t frames, struct ts_info *ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
+	size_t total_floats = frames;
 	size_t start_point = 0;
 
 	if (source->audio_ts < ts->start || ts->end <= source->audio_ts)
@@ -56,25 +243,24 @@ static inline void mix_audio(struct audio_output_data *mixes,
 	if (source->audio_ts != ts->start) {
 		start_point = convert_time_to_frames(sample_rate,
 				source->audio_ts - ts->start);
-		if (start_point == AUDIO_OUTPUT_FRAMES)
+		if (start_point == frames)
 			return;
 
 		total_floats -= start_point;
 	}
 
-	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud =
-				source->audio_output_buf[mix_idx][ch];
-			register float *end;
+	/* only mixes that are both active and enabled on the source have
+	 * anything to add */
+	mixers &= source->audio_mixers;
 
-			mix += start_point;
-			end = aud + total_floats;
+	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			while (aud < end)
-				*(mix++) += *(aud++);
-		}
+		for (size_t ch = 0; ch < channels; ch++)
+			audio_mix_add(mixes[mix_idx].data[ch] + start_point,
+					source->audio_output_buf[mix_idx][ch],
+					total_floats);
 	}
 }
 
@@ -84,6 +270,8 @@ static void ignore_audio(obs_source_t *source, size_t channels,
 	size_t num_floats = source->audio_input_buf[0].size / sizeof(float);
 
 	if (num_floats) {
+		source->audio_discarded_frames += num_floats;
+
 		for (size_t ch = 0; ch < channels; ch++)
 			circlebuf_pop_front(&source->audio_input_buf[ch], NULL,
 					source->audio_input_buf[ch].size);
@@ -108,6 +296,8 @@ static bool discard_if_stopped(obs_source_t *source, size_t channels)
 	/* if perpetually pending data, it means the audio has stopped,
 	 * so clear the audio data */
 	if (last_size == size) {
+		source->audio_discarded_frames += size / sizeof(float);
+
 		for (size_t ch = 0; ch < channels; ch++)
 			circlebuf_pop_front(&source->audio_input_buf[ch], NULL,
 					source->audio_input_buf[ch].size);
@@ -125,13 +315,11 @@ static bool discard_if_stopped(obs_source_t *source, size_t channels)
 	}
 }
 
-#define MAX_AUDIO_SIZE (AUDIO_OUTPUT_FRAMES * sizeof(float))
-
 static inline void discard_audio(struct obs_core_audio *audio,
 		obs_source_t *source, size_t channels, size_t sample_rate,
 		struct ts_info *ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
+	size_t total_floats = audio->block_frames;
 	size_t size;
 
 #if DEBUG_AUDIO == 1
@@ -155,7 +343,8 @@ static inline void discard_audio(struct obs_core_audio *audio,
 
 	if (source->audio_ts < (ts->start - 1)) {
 		if (source->audio_pending &&
-		    source->audio_input_buf[0].size < MAX_AUDIO_SIZE &&
+		    source->audio_input_buf[0].size <
+				audio->block_frames * sizeof(float) &&
 		    discard_if_stopped(source, channels))
 			return;
 
@@ -167,7 +356,7 @@ static inline void discard_audio(struct obs_core_audio *audio,
 					source->audio_ts, ts->start);
 		}
 #endif
-		if (audio->total_buffering_ticks == MAX_BUFFERING_TICKS)
+		if (audio->total_buffering_ticks == audio->max_buffering_ticks)
 			ignore_audio(source, channels, sample_rate);
 		return;
 	}
@@ -176,7 +365,7 @@ static inline void discard_audio(struct obs_core_audio *audio,
 	    source->audio_ts != (ts->start - 1)) {
 		size_t start_point = convert_time_to_frames(sample_rate,
 				source->audio_ts - ts->start);
-		if (start_point == AUDIO_OUTPUT_FRAMES) {
+		if (start_point == audio->block_frames) {
 #if DEBUG_AUDIO == 1
 			if (is_audio_source)
 				blog(LOG_DEBUG, "can't dicard, start point is "
@@ -218,6 +407,7 @@ static inline void discard_audio(struct obs_core_audio *audio,
 static void add_audio_buffering(struct obs_core_audio *audio,
 		size_t sample_rate, struct ts_info *ts, uint64_t min_ts)
 {
+	size_t block_frames = audio->block_frames;
 	struct ts_info new_ts;
 	uint64_t offset;
 	uint64_t frames;
@@ -225,7 +415,7 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	size_t ms;
 	int ticks;
 
-	if (audio->total_buffering_ticks == MAX_BUFFERING_TICKS)
+	if (audio->total_buffering_ticks == audio->max_buffering_ticks)
 		return;
 
 	if (!audio->buffering_wait_ticks)
@@ -233,18 +423,23 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 
 	offset = ts->start - min_ts;
 	frames = ns_to_audio_frames(sample_rate, offset);
-	ticks = (int)((frames + AUDIO_OUTPUT_FRAMES - 1) / AUDIO_OUTPUT_FRAMES);
+	ticks = (int)((frames + block_frames - 1) / block_frames);
 
 	audio->total_buffering_ticks += ticks;
-
-	if (audio->total_buffering_ticks >= MAX_BUFFERING_TICKS) {
-		ticks -= audio->total_buffering_ticks - MAX_BUFFERING_TICKS;
-		audio->total_buffering_ticks = MAX_BUFFERING_TICKS;
+	audio->stable_ticks = 0;
+	audio->min_headroom = SIZE_MAX;
+	os_atomic_inc_long(&audio->buffering_increases);
+
+	if (audio->total_buffering_ticks >= audio->max_buffering_ticks) {
+		ticks -= audio->total_buffering_ticks -
+			audio->max_buffering_ticks;
+		audio->total_buffering_ticks = audio->max_buffering_ticks;
+		os_atomic_inc_long(&audio->max_buffering_reached);
 		blog(LOG_WARNING, "Max audio buffering reached!");
 	}
 
-	ms = ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
-	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
+	ms = ticks * block_frames * 1000 / sample_rate;
+	total_ms = audio->total_buffering_ticks * block_frames * 1000 /
 		sample_rate;
 
 	blog(LOG_INFO, "adding %d milliseconds of audio buffering, total "
@@ -258,7 +453,7 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 #endif
 
 	new_ts.start = audio->buffered_ts - audio_frames_to_ns(sample_rate,
-			audio->buffering_wait_ticks * AUDIO_OUTPUT_FRAMES);
+			audio->buffering_wait_ticks * block_frames);
 
 	while (ticks--) {
 		int cur_ticks = ++audio->buffering_wait_ticks;
@@ -266,7 +461,7 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 		new_ts.end = new_ts.start;
 		new_ts.start = audio->buffered_ts - audio_frames_to_ns(
 				sample_rate,
-				cur_ticks * AUDIO_OUTPUT_FRAMES);
+				cur_ticks * block_frames);
 
 #if DEBUG_AUDIO == 1
 		blog(LOG_DEBUG, "add buffered ts: %"PRIu64"-%"PRIu64,
@@ -280,10 +475,104 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	*ts = new_ts;
 }
 
+/* how long sources have to keep enough audio queued before buffering is
+ * reduced in low latency mode, in seconds */
+#define STABLE_BUFFERING_SECONDS 5
+
+/* headroom is how much audio a source still has queued after the data for
+ * the next block.  a source that isn't lined up with the next block has no
+ * headroom, as it can't have a block skipped */
+static inline void check_headroom(struct obs_core_audio *audio,
+		obs_source_t *source, uint64_t next_ts)
+{
+	size_t block_size = audio->block_frames * sizeof(float);
+	size_t headroom = 0;
+
+	if (source->info.audio_render || !source->audio_ts)
+		return;
+
+	if (source->audio_ts == next_ts &&
+	    source->audio_input_buf[0].size > block_size)
+		headroom = source->audio_input_buf[0].size - block_size;
+
+	if (headroom < audio->min_headroom)
+		audio->min_headroom = headroom;
+}
+
+static void skip_source_block(obs_source_t *source, size_t channels,
+		size_t size, uint64_t new_ts)
+{
+	if (source->info.audio_render || !source->audio_ts)
+		return;
+
+	pthread_mutex_lock(&source->audio_buf_mutex);
+
+	source->audio_discarded_frames += size / sizeof(float);
+
+	for (size_t ch = 0; ch < channels; ch++)
+		circlebuf_pop_front(&source->audio_input_buf[ch], NULL, size);
+
+	source->last_audio_input_buf_size = 0;
+	source->audio_ts = new_ts;
+
+	pthread_mutex_unlock(&source->audio_buf_mutex);
+}
+
+/* in low latency mode, buffering is taken back down a block at a time once
+ * every source has had at least a block of headroom for a while.  the
+ * skipped block is dropped from both the sources and the output timeline,
+ * so the next output timestamp jumps ahead by a block.  audio encoders fill
+ * that gap with silence to stay in sync with video */
+static void reduce_audio_buffering(struct obs_core_audio *audio,
+		struct obs_core_data *data, size_t channels,
+		size_t sample_rate)
+{
+	size_t block_size = audio->block_frames * sizeof(float);
+	int window = (int)(sample_rate * STABLE_BUFFERING_SECONDS /
+			audio->block_frames);
+	struct obs_source *source;
+	struct ts_info skip_ts;
+	size_t total_ms;
+	size_t ms;
+
+	if (++audio->stable_ticks < window)
+		return;
+
+	audio->stable_ticks = 0;
+
+	if (audio->min_headroom < block_size ||
+	    audio->buffered_timestamps.size < sizeof(skip_ts)) {
+		audio->min_headroom = SIZE_MAX;
+		return;
+	}
+
+	audio->min_headroom = SIZE_MAX;
+
+	circlebuf_pop_front(&audio->buffered_timestamps, &skip_ts,
+			sizeof(skip_ts));
+
+	source = data->first_audio_source;
+	while (source) {
+		skip_source_block(source, channels, block_size, skip_ts.end);
+		source = (struct obs_source*)source->next_audio_source;
+	}
+
+	audio->total_buffering_ticks--;
+	os_atomic_inc_long(&audio->buffering_reductions);
+
+	ms = audio->block_frames * 1000 / sample_rate;
+	total_ms = audio->total_buffering_ticks * audio->block_frames * 1000 /
+		sample_rate;
+
+	blog(LOG_INFO, "removing %d milliseconds of audio buffering, total "
+			"audio buffering is now %d milliseconds",
+			(int)ms, (int)total_ms);
+}
+
 static bool audio_buffer_insuffient(struct obs_source *source,
-		size_t sample_rate, uint64_t min_ts)
+		size_t sample_rate, size_t frames, uint64_t min_ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
+	size_t total_floats = frames;
 	size_t size;
 
 	if (source->info.audio_render || source->audio_pending ||
@@ -295,7 +584,7 @@ static bool audio_buffer_insuffient(struct obs_source *source,
 	    source->audio_ts != (min_ts - 1)) {
 		size_t start_point = convert_time_to_frames(sample_rate,
 				source->audio_ts - min_ts);
-		if (start_point >= AUDIO_OUTPUT_FRAMES)
+		if (start_point >= frames)
 			return false;
 
 		total_floats -= start_point;
@@ -325,14 +614,14 @@ static inline void find_min_ts(struct obs_core_data *data,
 }
 
 static inline bool mark_invalid_sources(struct obs_core_data *data,
-		size_t sample_rate, uint64_t min_ts)
+		size_t sample_rate, size_t frames, uint64_t min_ts)
 {
 	bool recalculate = false;
 
 	struct obs_source *source = data->first_audio_source;
 	while (source) {
 		recalculate |= audio_buffer_insuffient(source, sample_rate,
-				min_ts);
+				frames, min_ts);
 		source = (struct obs_source*)source->next_audio_source;
 	}
 
@@ -340,10 +629,10 @@ static inline bool mark_invalid_sources(struct obs_core_data *data,
 }
 
 static inline void calc_min_ts(struct obs_core_data *data,
-		size_t sample_rate, uint64_t *min_ts)
+		size_t sample_rate, size_t frames, uint64_t *min_ts)
 {
 	find_min_ts(data, min_ts);
-	if (mark_invalid_sources(data, sample_rate, *min_ts))
+	if (mark_invalid_sources(data, sample_rate, frames, *min_ts))
 		find_min_ts(data, min_ts);
 }
 
@@ -365,6 +654,9 @@ bool audio_callback(void *param,
 	struct ts_info ts = {start_ts_in, end_ts_in};
 	size_t audio_size;
 	uint64_t min_ts;
+	bool can_reduce;
+
+	frame_clock_audio_tick(obs->video.frame_clock, end_ts_in);
 
 	da_resize(audio->render_order, 0);
 	da_resize(audio->root_nodes, 0);
@@ -373,48 +665,31 @@ bool audio_callback(void *param,
 	circlebuf_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
 	min_ts = ts.start;
 
-	audio_size = AUDIO_OUTPUT_FRAMES * sizeof(float);
+	audio_size = audio->block_frames * sizeof(float);
 
 #if DEBUG_AUDIO == 1
 	blog(LOG_DEBUG, "ts %llu-%llu", ts.start, ts.end);
 #endif
 
 	/* ------------------------------------------------ */
-	/* build audio render order
-	 * NOTE: these are source channels, not audio channels */
-	for (uint32_t i = 0; i < MAX_CHANNELS; i++) {
-		obs_source_t *source = obs_get_output_source(i);
-		if (source) {
-			obs_source_enum_active_tree(source, push_audio_tree,
-					audio);
-			push_audio_tree(NULL, source, audio);
-			da_push_back(audio->root_nodes, &source);
-			obs_source_release(source);
-		}
-	}
-
-	pthread_mutex_lock(&data->audio_sources_mutex);
-
-	source = data->first_audio_source;
-	while (source) {
-		push_audio_tree(NULL, source, audio);
-		source = (struct obs_source*)source->next_audio_source;
-	}
-
-	pthread_mutex_unlock(&data->audio_sources_mutex);
+	/* get audio render order.  the tree is also rebuilt every so often in
+	 * case a source changes its active children without letting libobs
+	 * know */
+	if (os_atomic_load_bool(&audio->tree_changed) ||
+	    (size_t)audio->tree_age_ticks >= sample_rate / audio->block_frames)
+		build_audio_tree(audio);
+	else
+		load_audio_tree(audio);
 
 	/* ------------------------------------------------ */
 	/* render audio data */
-	for (size_t i = 0; i < audio->render_order.num; i++) {
-		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate,
-				audio_size);
-	}
+	flush_rt_audio(data);
+	render_audio_sources(audio, mixers, channels, sample_rate, audio_size);
 
 	/* ------------------------------------------------ */
 	/* get minimum audio timestamp */
 	pthread_mutex_lock(&data->audio_sources_mutex);
-	calc_min_ts(data, sample_rate, &min_ts);
+	calc_min_ts(data, sample_rate, audio->block_frames, &min_ts);
 	pthread_mutex_unlock(&data->audio_sources_mutex);
 
 	/* ------------------------------------------------ */
@@ -434,7 +709,8 @@ bool audio_callback(void *param,
 			pthread_mutex_lock(&source->audio_buf_mutex);
 
 			if (source->audio_output_buf[0][0] && source->audio_ts)
-				mix_audio(mixes, source, channels, sample_rate,
+				mix_audio(mixes, source, mixers, channels,
+						sample_rate, audio->block_frames,
 						&ts);
 
 			pthread_mutex_unlock(&source->audio_buf_mutex);
@@ -443,25 +719,38 @@ bool audio_callback(void *param,
 
 	/* ------------------------------------------------ */
 	/* discard audio */
+	can_reduce = audio->low_latency && audio->total_buffering_ticks &&
+		!audio->buffering_wait_ticks;
+
+	if (!can_reduce) {
+		audio->stable_ticks = 0;
+		audio->min_headroom = SIZE_MAX;
+	}
+
 	pthread_mutex_lock(&data->audio_sources_mutex);
 
 	source = data->first_audio_source;
 	while (source) {
 		pthread_mutex_lock(&source->audio_buf_mutex);
 		discard_audio(audio, source, channels, sample_rate, &ts);
+		if (can_reduce)
+			check_headroom(audio, source, ts.end);
 		pthread_mutex_unlock(&source->audio_buf_mutex);
 
 		source = (struct obs_source*)source->next_audio_source;
 	}
 
+	circlebuf_pop_front(&audio->buffered_timestamps, NULL, sizeof(ts));
+
+	if (can_reduce)
+		reduce_audio_buffering(audio, data, channels, sample_rate);
+
 	pthread_mutex_unlock(&data->audio_sources_mutex);
 
 	/* ------------------------------------------------ */
 	/* release audio sources */
 	release_audio_sources(audio);
 
-	circlebuf_pop_front(&audio->buffered_timestamps, NULL, sizeof(ts));
-
 	*out_ts = ts.start;
 
 	if (audio->buffering_wait_ticks) {
@@ -43,6 +43,7 @@ bool obs_display_init(struct obs_display *display,
 
 	display->background_color = 0x4C4C4C;
 	display->enabled = true;
+	display->visible = true;
 	return true;
 }
 
@@ -208,3 +209,31 @@ void obs_display_set_background_color(obs_display_t *display, uint32_t color)
 	if (display)
 		display->background_color = color;
 }
+
+void obs_display_set_refresh_rate(obs_display_t *display, double fps)
+{
+	if (!display) return;
+
+	display->refresh_interval = fps > 0.0 ?
+		(uint64_t)(1000000000.0 / fps) : 0;
+	display->next_render_time = 0;
+}
+
+double obs_display_get_refresh_rate(obs_display_t *display)
+{
+	if (!display || !display->refresh_interval)
+		return 0.0;
+
+	return 1000000000.0 / (double)display->refresh_interval;
+}
+
+void obs_display_set_visible(obs_display_t *display, bool visible)
+{
+	if (display)
+		display->visible = visible;
+}
+
+bool obs_display_visible(obs_display_t *display)
+{
+	return display ? display->visible : false;
+}
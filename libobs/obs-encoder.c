@@ -15,6 +15,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <inttypes.h>
 #include "obs.h"
 #include "obs-internal.h"
 
@@ -177,6 +178,27 @@ static inline bool has_scaling(const struct obs_encoder *encoder)
 		 video_height != encoder->scaled_height);
 }
 
+/* if only the size differs from the main video, the frames can be scaled on
+ * the GPU rather than by the CPU scaler */
+static inline bool can_scale_on_gpu(const struct obs_encoder *encoder,
+		const struct video_scale_info *info)
+{
+	const struct video_output_info *voi;
+	voi = video_output_get_info(encoder->media);
+
+	return encoder->media == obs->video.video &&
+		info->format     == voi->format &&
+		info->colorspace == voi->colorspace &&
+		info->range      == voi->range &&
+		(info->width != voi->width || info->height != voi->height);
+}
+
+static inline video_t *get_encoder_video(const struct obs_encoder *encoder)
+{
+	return encoder->scaled_video ?
+		encoder->scaled_video->video : encoder->media;
+}
+
 static void add_connection(struct obs_encoder *encoder)
 {
 	if (encoder->info.type == OBS_ENCODER_AUDIO) {
@@ -189,21 +211,41 @@ static void add_connection(struct obs_encoder *encoder)
 		struct video_scale_info info = {0};
 		get_video_info(encoder, &info);
 
-		video_output_connect(encoder->media, &info, receive_video,
-			encoder);
+		if (can_scale_on_gpu(encoder, &info))
+			encoder->scaled_video = obs_video_target_acquire(
+					info.width, info.height);
+
+		video_output_connect(get_encoder_video(encoder), &info,
+				receive_video, encoder);
 	}
 
 	set_encoder_active(encoder, true);
 }
 
+static inline void log_busy_skipped_frames(struct obs_encoder *encoder)
+{
+	uint32_t skipped = video_output_get_input_skipped_frames(
+			get_encoder_video(encoder), receive_video, encoder);
+
+	if (skipped)
+		blog(LOG_INFO, "Encoder '%s': Number of frames skipped because "
+				"the encoder was busy: %"PRIu32,
+				encoder->context.name, skipped);
+}
+
 static void remove_connection(struct obs_encoder *encoder)
 {
-	if (encoder->info.type == OBS_ENCODER_AUDIO)
+	if (encoder->info.type == OBS_ENCODER_AUDIO) {
 		audio_output_disconnect(encoder->media, encoder->mixer_idx,
 				receive_audio, encoder);
-	else
-		video_output_disconnect(encoder->media, receive_video,
-				encoder);
+	} else {
+		log_busy_skipped_frames(encoder);
+		video_output_disconnect(get_encoder_video(encoder),
+				receive_video, encoder);
+
+		obs_video_target_release(encoder->scaled_video);
+		encoder->scaled_video = NULL;
+	}
 
 	obs_encoder_shutdown(encoder);
 	set_encoder_active(encoder, false);
@@ -813,10 +855,19 @@ static inline void do_encode(struct obs_encoder *encoder,
 
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
-		for (size_t i = encoder->callbacks.num; i > 0; i--) {
-			struct encoder_callback *cb;
-			cb = encoder->callbacks.array+(i-1);
-			send_packet(encoder, cb, &pkt);
+		/* the data is copied once here and every output that keeps
+		 * the packet only adds a reference to it */
+		if (encoder->callbacks.num) {
+			struct encoder_packet shared;
+			obs_duplicate_encoder_packet(&shared, &pkt);
+
+			for (size_t i = encoder->callbacks.num; i > 0; i--) {
+				struct encoder_callback *cb;
+				cb = encoder->callbacks.array+(i-1);
+				send_packet(encoder, cb, &shared);
+			}
+
+			obs_free_encoder_packet(&shared);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
@@ -911,6 +962,36 @@ static void start_from_buffer(struct obs_encoder *encoder, uint64_t v_start_ts)
 		bfree(audio.data[i]);
 }
 
+/* when audio buffering is reduced, a block is skipped and the next packet's
+ * timestamp jumps ahead of where the last one ended.  encoded audio is timed
+ * by its sample count, so silence is inserted to keep it in sync with video.
+ * small differences are resampler rounding and are left alone */
+static void fill_audio_gap(struct obs_encoder *encoder,
+		struct audio_data *data)
+{
+	uint64_t gap_frames;
+	size_t gap_size;
+
+	if (data->timestamp <= encoder->next_audio_ts)
+		return;
+
+	gap_frames = ns_to_audio_frames(encoder->samplerate,
+			data->timestamp - encoder->next_audio_ts);
+	if (gap_frames < (uint64_t)data->frames / 2)
+		return;
+
+	gap_size = (size_t)gap_frames * encoder->blocksize;
+
+	for (size_t i = 0; i < encoder->planes; i++) {
+		struct circlebuf *buf = &encoder->audio_input_buffer[i];
+		circlebuf_upsize(buf, buf->size + gap_size);
+	}
+
+	blog(LOG_DEBUG, "encoder '%s': filled %"PRIu64" frame audio "
+			"timestamp gap with silence",
+			encoder->context.name, gap_frames);
+}
+
 static const char *buffer_audio_name = "buffer_audio";
 static bool buffer_audio(struct obs_encoder *encoder, struct audio_data *data)
 {
@@ -956,12 +1037,18 @@ static bool buffer_audio(struct obs_encoder *encoder, struct audio_data *data)
 
 	} else if (!encoder->start_ts && !encoder->paired_encoder) {
 		encoder->start_ts = data->timestamp;
+
+	} else if (encoder->start_ts) {
+		fill_audio_gap(encoder, data);
 	}
 
 fail:
 	push_back_audio(encoder, data, size, offset_size);
 
 skip_push:
+	encoder->next_audio_ts = data->timestamp +
+		audio_frames_to_ns(encoder->samplerate, data->frames);
+
 	profile_end(buffer_audio_name);
 	return success;
 }
@@ -1034,16 +1121,44 @@ void obs_encoder_remove_output(struct obs_encoder *encoder,
 	pthread_mutex_unlock(&encoder->outputs_mutex);
 }
 
+/* shared packet data is stored right after its reference count.  outputs
+ * sometimes copy a packet and replace its data with their own, so the data
+ * is only treated as shared if it still points into the shared buffer */
+#define SHARED_DATA_OFFSET 16
+
+static inline bool packet_data_shared(const struct encoder_packet *packet)
+{
+	return packet->shared_buf && packet->data ==
+		(uint8_t*)packet->shared_buf + SHARED_DATA_OFFSET;
+}
+
 void obs_duplicate_encoder_packet(struct encoder_packet *dst,
 		const struct encoder_packet *src)
 {
 	*dst = *src;
-	dst->data = bmemdup(src->data, src->size);
+
+	if (packet_data_shared(src)) {
+		os_atomic_inc_long((volatile long*)src->shared_buf);
+		return;
+	}
+
+	dst->shared_buf = bmalloc(SHARED_DATA_OFFSET + src->size);
+	dst->data = (uint8_t*)dst->shared_buf + SHARED_DATA_OFFSET;
+	*(volatile long*)dst->shared_buf = 1;
+
+	if (src->size)
+		memcpy(dst->data, src->data, src->size);
 }
 
 void obs_free_encoder_packet(struct encoder_packet *packet)
 {
-	bfree(packet->data);
+	if (packet_data_shared(packet)) {
+		if (os_atomic_dec_long((volatile long*)packet->shared_buf) == 0)
+			bfree(packet->shared_buf);
+	} else {
+		bfree(packet->data);
+	}
+
 	memset(packet, 0, sizeof(struct encoder_packet));
 }
 
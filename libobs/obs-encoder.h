@@ -30,6 +30,7 @@ extern "C" {
 #endif
 
 #define OBS_ENCODER_CAP_DEPRECATED             (1<<0)
+#define OBS_ENCODER_CAP_DYN_BITRATE            (1<<1)
 
 /** Specifies the encoder type */
 enum obs_encoder_type {
@@ -82,6 +83,22 @@ struct encoder_packet {
 
 	/** Encoder from which the track originated from */
 	obs_encoder_t         *encoder;
+
+	/**
+	 * Reference counted buffer the data is stored in once the packet has
+	 * been duplicated with obs_duplicate_encoder_packet.  Only libobs may
+	 * set it.
+	 *
+	 * The data is only shared while data points into this buffer.  A packet
+	 * built by a plugin must zero this field, and a copy whose data is
+	 * replaced (e.g. by obs_parse_avc_packet) owns that data instead, so
+	 * obs_free_encoder_packet releases a reference if the data is shared
+	 * and bfree's the data otherwise.
+	 *
+	 * Adding this field changed the size of the structure, so plugins that
+	 * allocate or copy packets must be rebuilt against this header.
+	 */
+	void                  *shared_buf;
 };
 
 /** Encoder input frame */
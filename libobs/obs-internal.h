@@ -24,6 +24,7 @@
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/profiler.h"
+#include "util/task-pool.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
 
@@ -31,13 +32,21 @@
 #include "graphics/matrix4.h"
 
 #include "media-io/audio-resampler.h"
+#include "media-io/audio-math.h"
 #include "media-io/video-io.h"
 #include "media-io/audio-io.h"
+#include "media-io/frame-clock.h"
 
 #include "obs.h"
 
 #define NUM_TEXTURES 2
+#define MAX_NUM_TEXTURES 8
+#define MAX_CONVERT_BANDS 4
+#define MAX_TICK_THREADS 4
+#define MAX_AUDIO_RENDER_THREADS 4
+#define MAX_BUFFERING_FRAMES (45 * 1024)
 #define MICROSECOND_DEN 1000000
+#define INTERLEAVE_QUEUES (MAX_AUDIO_MIXES + 1)
 
 
 	static inline int64_t packet_dts_usec(struct encoder_packet *packet)
@@ -196,12 +205,17 @@
 	struct obs_display {
 		bool                            size_changed;
 		bool                            enabled;
+		bool                            visible;
 		uint32_t                        cx, cy;
 		uint32_t                        background_color;
 		gs_swapchain_t                  *swap;
 		pthread_mutex_t                 draw_callbacks_mutex;
 		DARRAY(struct draw_callback)    draw_callbacks;
 
+		/* 0 renders on every output frame */
+		uint64_t                        refresh_interval;
+		uint64_t                        next_render_time;
+
 		struct obs_display              *next;
 		struct obs_display              **prev_next;
 	};
@@ -219,16 +233,43 @@
 		int count;
 	};
 
+	/* the main texture scaled (and converted, if GPU conversion is used) to
+	 * a specific output size and read back to its own video output.  the
+	 * main output is one, and video encoders that are scaled to a different
+	 * size get their own so that they don't need the CPU scaler */
+	struct obs_video_target {
+		video_t                         *video;
+		uint32_t                        width;
+		uint32_t                        height;
+		long                            refs;
+
+		gs_stagesurf_t                  *copy_surfaces[MAX_NUM_TEXTURES];
+		gs_texture_t                    *output_textures[MAX_NUM_TEXTURES];
+		gs_texture_t                    *convert_textures[MAX_NUM_TEXTURES];
+		bool                            textures_output[MAX_NUM_TEXTURES];
+		bool                            textures_copied[MAX_NUM_TEXTURES];
+		bool                            textures_converted[MAX_NUM_TEXTURES];
+		gs_stagesurf_t                  *mapped_surface;
+
+		bool                            gpu_conversion;
+		const char                      *conversion_tech;
+		uint32_t                        conversion_height;
+		uint32_t                        plane_offsets[3];
+		uint32_t                        plane_sizes[3];
+		uint32_t                        plane_linewidth[3];
+
+		/* frame mapped for the current output (scaled targets only) */
+		struct video_data               frame;
+		bool                            frame_ready;
+	};
+
 	struct obs_core_video {
 		graphics_t                      *graphics;
-		gs_stagesurf_t                  *copy_surfaces[NUM_TEXTURES];
-		gs_texture_t                    *render_textures[NUM_TEXTURES];
-		gs_texture_t                    *output_textures[NUM_TEXTURES];
-		gs_texture_t                    *convert_textures[NUM_TEXTURES];
-		bool                            textures_rendered[NUM_TEXTURES];
-		bool                            textures_output[NUM_TEXTURES];
-		bool                            textures_copied[NUM_TEXTURES];
-		bool                            textures_converted[NUM_TEXTURES];
+		gs_texture_t                    *render_textures[MAX_NUM_TEXTURES];
+		bool                            textures_rendered[MAX_NUM_TEXTURES];
+		struct obs_video_target         main_target;
+		pthread_mutex_t                 scaled_targets_mutex;
+		DARRAY(struct obs_video_target*) scaled_targets;
 		struct circlebuf                vframe_info_buffer;
 		gs_effect_t                     *default_effect;
 		gs_effect_t                     *default_rect_effect;
@@ -240,10 +281,11 @@
 		gs_effect_t                     *bilinear_lowres_effect;
 		gs_effect_t                     *premultiplied_alpha_effect;
 		gs_samplerstate_t               *point_sampler;
-		gs_stagesurf_t                  *mapped_surface;
 		int                             cur_texture;
+		int                             num_textures;
 
 		uint64_t                        video_time;
+		frame_clock_t                   *frame_clock;
 		video_t                         *video;
 		pthread_t                       video_thread;
 		uint32_t                        total_frames;
@@ -251,11 +293,13 @@
 		bool                            thread_initialized;
 
 		bool                            gpu_conversion;
-		const char                      *conversion_tech;
-		uint32_t                        conversion_height;
-		uint32_t                        plane_offsets[3];
-		uint32_t                        plane_sizes[3];
-		uint32_t                        plane_linewidth[3];
+
+		task_pool_t                     *tick_pool;
+		DARRAY(struct obs_source*)      threaded_ticks;
+
+		task_pool_t                     *convert_pool;
+		size_t                          convert_bands;
+		const char                      *convert_band_names[MAX_CONVERT_BANDS];
 
 		uint32_t                        output_width;
 		uint32_t                        output_height;
@@ -283,10 +327,33 @@
 		DARRAY(struct obs_source*)      render_order;
 		DARRAY(struct obs_source*)      root_nodes;
 
+		/* the render order only changes when the audio tree does, so
+		 * it's kept between ticks as weak references and only rebuilt
+		 * once something calls obs_audio_tree_changed */
+		DARRAY(obs_weak_source_t*)      cached_render_order;
+		DARRAY(obs_weak_source_t*)      cached_root_nodes;
+		volatile bool                   tree_changed;
+		int                             tree_age_ticks;
+
+		task_pool_t                     *render_pool;
+		DARRAY(struct obs_source*)      parallel_sources;
+
 		uint64_t                        buffered_ts;
 		struct circlebuf                buffered_timestamps;
 		int                             buffering_wait_ticks;
 		int                             total_buffering_ticks;
+		int                             max_buffering_ticks;
+
+		size_t                          block_frames;
+		bool                            low_latency;
+		size_t                          render_threads;
+		int                             stable_ticks;
+		size_t                          min_headroom;
+
+		/* stats, only written by the audio thread */
+		volatile long                   buffering_increases;
+		volatile long                   buffering_reductions;
+		volatile long                   max_buffering_reached;
 
 		float                           user_volume;
 	};
@@ -383,6 +450,13 @@
 
 	extern void *obs_video_thread(void *param);
 
+	/* gets a reference to a GPU-scaled copy of the main video at the
+	 * given size, creating it if it doesn't exist yet.  returns NULL if the
+	 * size can't be scaled on the GPU */
+	extern struct obs_video_target *obs_video_target_acquire(
+		uint32_t width, uint32_t height);
+	extern void obs_video_target_release(struct obs_video_target *target);
+
 	extern gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file);
 
 	extern bool audio_callback(void *param,
@@ -509,6 +583,30 @@
 		void *param;
 	};
 
+	struct audio_levels_cb_info {
+		obs_source_audio_levels_t callback;
+		void *param;
+	};
+
+	/* levels of the audio received during one slot of AUDIO_LEVEL_SLOT_MS.
+	 * a packet counts towards the slot it starts in.  seq is odd while the
+	 * slot is being written */
+	struct audio_level_slot {
+		volatile long seq;
+		uint64_t slot;
+		uint32_t frames;
+		bool     muted;
+		float    peak[MAX_AUDIO_CHANNELS];
+		float    true_peak[MAX_AUDIO_CHANNELS];
+		float    sum_squares[MAX_AUDIO_CHANNELS];
+	};
+
+	/* the history is sized by time rather than by packets, so that small
+	 * packets don't shorten it: obs_source_get_audio_levels can look back
+	 * over the last second whatever the packet size */
+	#define AUDIO_LEVEL_SLOT_MS 10
+	#define AUDIO_LEVEL_HISTORY 100
+
 	struct obs_source {
 		struct obs_context_data         context;
 		struct obs_source_info          info;
@@ -563,6 +661,7 @@
 		size_t                          last_audio_input_buf_size;
 		DARRAY(struct audio_action)     audio_actions;
 		float                           *audio_output_buf[MAX_AUDIO_MIXES][MAX_AUDIO_CHANNELS];
+		const char                      *audio_render_name;
 		struct resample_info            sample_info;
 		audio_resampler_t               *resampler;
 		pthread_mutex_t                 audio_actions_mutex;
@@ -572,6 +671,32 @@
 		DARRAY(struct audio_cb_info)    audio_cb_list;
 		struct obs_audio_data           audio_data;
 		size_t                          audio_storage_size;
+
+		/* audio stats, counted under audio_buf_mutex */
+		uint64_t                        audio_ts_jumps;
+		uint64_t                        audio_discarded_frames;
+		uint64_t                        audio_resampler_resets;
+
+		/* realtime audio handoff, see obs_source_output_audio_rt.  the
+		 * realtime thread only ever moves rt_audio_write and the audio
+		 * thread only ever moves rt_audio_read */
+		uint8_t                         *rt_audio_buf;
+		size_t                          rt_audio_capacity;
+		volatile long                   rt_audio_read;
+		volatile long                   rt_audio_write;
+		volatile long                   rt_audio_dropped;
+		pthread_mutex_t                 rt_audio_mutex;
+
+		/* audio levels, metered once as each packet of audio is
+		 * received.  audio_level_cur is the index of the slot being
+		 * filled, readers only read the slots before it, and skip any
+		 * that have been reused meanwhile instead of waiting */
+		struct audio_level_slot         audio_levels[AUDIO_LEVEL_HISTORY];
+		uint64_t                        audio_level_frames;
+		volatile long                   audio_level_cur;
+		float                           audio_true_peak_history[MAX_AUDIO_CHANNELS][AUDIO_TRUE_PEAK_HISTORY];
+		DARRAY(struct audio_levels_cb_info) audio_levels_cb_list;
+
 		uint32_t                        audio_mixers;
 		float                           user_volume;
 		float                           volume;
@@ -602,6 +727,8 @@
 		uint32_t                        async_cache_height;
 		uint32_t                        async_convert_width;
 		uint32_t                        async_convert_height;
+		int64_t                         async_av_offset;
+		bool                            async_av_offset_valid;
 
 		/* async video deinterlacing */
 		uint64_t                        deinterlace_offset;
@@ -726,12 +853,28 @@
 	extern void obs_source_activate(obs_source_t *source, enum view_type type);
 	extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 	extern void obs_source_video_tick(obs_source_t *source, float seconds);
+
+	/* everything obs_source_video_tick does besides calling the source's
+	 * own video_tick callback */
+	extern void obs_source_prepare_video_tick(obs_source_t *source);
 	extern float obs_source_get_target_volume(obs_source_t *source,
 		obs_source_t *target);
 
 	extern void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 		size_t channels, size_t sample_rate, size_t size);
 
+	/* passes on audio queued with obs_source_output_audio_rt, called from
+	 * the audio thread */
+	extern void obs_source_flush_audio_rt(obs_source_t *source);
+
+	/* marks the audio render order as out of date, must be called after
+	 * any change to what obs_source_enum_active_tree would return for a
+	 * source in the audio tree */
+	extern void obs_audio_tree_changed(void);
+
+	/* passes the levels metered during the last tick on to the audio levels
+	 * callbacks, called from the audio thread once rendering is done */
+
 	extern void add_alignment(struct vec2 *v, uint32_t align, int cx, int cy);
 
 	extern struct obs_source_frame *filter_async_video(obs_source_t *source,
@@ -773,6 +916,19 @@
 		struct obs_output *output;
 	};
 
+	/* encoded packets waiting to be interleaved.  each track has its own
+	 * queue sorted by dts, and the queues are merged through a heap
+	 * ordered by the packet at the front of each queue */
+	struct interleaved_packet {
+		struct encoder_packet           packet;
+		uint64_t                        order;
+	};
+
+	struct interleave_queue {
+		DARRAY(struct interleaved_packet) packets;
+		size_t                          start;
+	};
+
 	struct obs_output {
 		struct obs_context_data         context;
 		struct obs_output_info          info;
@@ -792,7 +948,10 @@
 		pthread_t                       end_data_capture_thread;
 		os_event_t                      *stopping_event;
 		pthread_mutex_t                 interleaved_mutex;
-		DARRAY(struct encoder_packet)   interleaved_packets;
+		struct interleave_queue         interleave_queues[INTERLEAVE_QUEUES];
+		size_t                          interleave_heap[INTERLEAVE_QUEUES];
+		size_t                          interleave_heap_size;
+		uint64_t                        interleave_order;
 		int                             stop_code;
 
 		int                             reconnect_retry_sec;
@@ -850,6 +1009,23 @@
 		calldata_free(&params);
 	}
 
+	static inline size_t get_track_index(const struct obs_output *output,
+			struct encoder_packet *pkt)
+	{
+		for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+			struct obs_encoder *encoder = output->audio_encoders[i];
+
+			if (pkt->encoder == encoder)
+				return i;
+		}
+
+		assert(false);
+		return 0;
+	}
+
+	extern void interleave_packets(void *data, struct encoder_packet *packet);
+	extern void free_interleaved_packets(struct obs_output *output);
+
 	extern void process_delay(void *data, struct encoder_packet *packet);
 	extern void obs_output_cleanup_delay(obs_output_t *output);
 	extern bool obs_output_delay_start(obs_output_t *output);
@@ -924,6 +1100,10 @@
 		uint64_t                        first_raw_ts;
 		uint64_t                        start_ts;
 
+		/* where the next audio packet is expected to start, used to
+		 * fill timestamp gaps left by audio buffering reductions */
+		uint64_t                        next_audio_ts;
+
 		pthread_mutex_t                 outputs_mutex;
 		DARRAY(obs_output_t*)            outputs;
 
@@ -932,6 +1112,9 @@
 		/* stores the video/audio media output pointer.  video_t *or audio_t **/
 		void                            *media;
 
+		/* GPU-scaled video the encoder is connected to instead of media */
+		struct obs_video_target         *scaled_video;
+
 		pthread_mutex_t                 callbacks_mutex;
 		DARRAY(struct encoder_callback) callbacks;
 
@@ -978,6 +1161,42 @@
 		struct obs_output               *output;
 	};
 
+	static inline bool service_supports_multitrack(
+		const struct obs_output *output)
+	{
+		const struct obs_service *service = output->service;
+
+		if (!service || !service->info.supports_multitrack) {
+			return false;
+		}
+
+		return service->info.supports_multitrack(service->context.data);
+	}
+
+	static inline size_t num_audio_mixes(const struct obs_output *output)
+	{
+		size_t mix_count = 1;
+
+		if ((output->info.flags & OBS_OUTPUT_SERVICE) != 0) {
+			if (!service_supports_multitrack(output)) {
+				return 1;
+			}
+		}
+
+		if ((output->info.flags & OBS_OUTPUT_MULTI_TRACK) != 0) {
+			mix_count = 0;
+
+			for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+				if (!output->audio_encoders[i])
+					break;
+
+				mix_count++;
+			}
+		}
+
+		return mix_count;
+	}
+
 	extern const struct obs_service_info *find_service(const char *id);
 
 	extern void obs_service_activate(struct obs_service *service);
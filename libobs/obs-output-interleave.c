@@ -0,0 +1,650 @@
+/******************************************************************************
+    Copyright (C) 2013-2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+
+static inline bool active(const struct obs_output *output)
+{
+	return os_atomic_load_bool(&output->active);
+}
+
+static inline void check_received(struct obs_output *output,
+		struct encoder_packet *out)
+{
+	if (out->type == OBS_ENCODER_VIDEO) {
+		if (!output->received_video)
+			output->received_video = true;
+	} else {
+		if (!output->received_audio)
+			output->received_audio = true;
+	}
+}
+
+static inline void apply_interleaved_packet_offset(struct obs_output *output,
+		struct encoder_packet *out)
+{
+	int64_t offset;
+
+	/* audio and video need to start at timestamp 0, and the encoders
+	 * may not currently be at 0 when we get data.  so, we store the
+	 * current dts as offset and subtract that value from the dts/pts
+	 * of the output packet. */
+	offset = (out->type == OBS_ENCODER_VIDEO) ?
+		output->video_offset : output->audio_offsets[out->track_idx];
+
+	out->dts -= offset;
+	out->pts -= offset;
+
+	/* convert the newly adjusted dts to relative dts time to ensure proper
+	 * interleaving.  if we're using an audio encoder that's already been
+	 * started on another output, then the first audio packet may not be
+	 * quite perfectly synced up in terms of system time (and there's
+	 * nothing we can really do about that), but it will always at least be
+	 * within a 23ish millisecond threshold (at least for AAC) */
+	out->dts_usec = packet_dts_usec(out);
+}
+
+static inline bool has_higher_opposing_ts(struct obs_output *output,
+		struct encoder_packet *packet)
+{
+	if (packet->type == OBS_ENCODER_VIDEO)
+		return output->highest_audio_ts > packet->dts_usec;
+	else
+		return output->highest_video_ts > packet->dts_usec;
+}
+
+/* ------------------------------------------------------------------------- */
+/* interleave queues */
+
+/* packets are interleaved by dts, and packets with the same dts are kept in
+ * the order they were received */
+static inline bool packet_before(const struct interleaved_packet *a,
+		const struct interleaved_packet *b)
+{
+	if (a->packet.dts_usec != b->packet.dts_usec)
+		return a->packet.dts_usec < b->packet.dts_usec;
+	return a->order < b->order;
+}
+
+static inline struct interleave_queue *get_queue(struct obs_output *output,
+		enum obs_encoder_type type, size_t audio_idx)
+{
+	return &output->interleave_queues[type == OBS_ENCODER_VIDEO ?
+		0 : audio_idx + 1];
+}
+
+static inline size_t queue_size(const struct interleave_queue *queue)
+{
+	return queue->packets.num - queue->start;
+}
+
+static inline struct interleaved_packet *queue_at(
+		struct interleave_queue *queue, size_t idx)
+{
+	return queue->packets.array + queue->start + idx;
+}
+
+static inline struct interleaved_packet *queue_front(
+		struct interleave_queue *queue)
+{
+	return queue_size(queue) ? queue_at(queue, 0) : NULL;
+}
+
+static inline struct interleaved_packet *queue_back(
+		struct interleave_queue *queue)
+{
+	return queue_size(queue) ? da_end(queue->packets) : NULL;
+}
+
+static void queue_pop_front(struct interleave_queue *queue)
+{
+	queue->start++;
+
+	/* only move the remaining packets down once at least half of the
+	 * array has been popped, so popping stays cheap */
+	if (queue->start == queue->packets.num) {
+		da_resize(queue->packets, 0);
+		queue->start = 0;
+	} else if (queue->start >= 32 &&
+	           queue->start * 2 >= queue->packets.num) {
+		da_erase_range(queue->packets, 0, queue->start);
+		queue->start = 0;
+	}
+}
+
+static inline bool heap_before(struct obs_output *output, size_t a, size_t b)
+{
+	return packet_before(
+		queue_front(&output->interleave_queues[output->interleave_heap[a]]),
+		queue_front(&output->interleave_queues[output->interleave_heap[b]]));
+}
+
+static inline void heap_swap(struct obs_output *output, size_t a, size_t b)
+{
+	size_t temp = output->interleave_heap[a];
+	output->interleave_heap[a] = output->interleave_heap[b];
+	output->interleave_heap[b] = temp;
+}
+
+static void heap_sift_up(struct obs_output *output, size_t pos)
+{
+	while (pos > 0) {
+		size_t parent = (pos - 1) / 2;
+		if (!heap_before(output, pos, parent))
+			break;
+
+		heap_swap(output, pos, parent);
+		pos = parent;
+	}
+}
+
+static void heap_sift_down(struct obs_output *output, size_t pos)
+{
+	size_t size = output->interleave_heap_size;
+
+	for (;;) {
+		size_t child = pos * 2 + 1;
+		if (child >= size)
+			break;
+
+		if (child + 1 < size && heap_before(output, child + 1, child))
+			child++;
+		if (!heap_before(output, child, pos))
+			break;
+
+		heap_swap(output, pos, child);
+		pos = child;
+	}
+}
+
+static void rebuild_interleave_heap(struct obs_output *output)
+{
+	output->interleave_heap_size = 0;
+
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		if (queue_size(&output->interleave_queues[i])) {
+			size_t pos = output->interleave_heap_size++;
+			output->interleave_heap[pos] = i;
+			heap_sift_up(output, pos);
+		}
+	}
+}
+
+static inline struct interleaved_packet *first_interleaved_packet(
+		struct obs_output *output)
+{
+	if (!output->interleave_heap_size)
+		return NULL;
+
+	return queue_front(
+		&output->interleave_queues[output->interleave_heap[0]]);
+}
+
+static void pop_first_interleaved_packet(struct obs_output *output)
+{
+	struct interleave_queue *queue =
+		&output->interleave_queues[output->interleave_heap[0]];
+
+	queue_pop_front(queue);
+
+	if (!queue_size(queue))
+		heap_swap(output, 0, --output->interleave_heap_size);
+	heap_sift_down(output, 0);
+}
+
+void free_interleaved_packets(struct obs_output *output)
+{
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &output->interleave_queues[i];
+
+		for (size_t j = 0; j < queue_size(queue); j++)
+			obs_free_encoder_packet(&queue_at(queue, j)->packet);
+
+		da_free(queue->packets);
+		queue->start = 0;
+	}
+
+	output->interleave_heap_size = 0;
+	output->interleave_order = 0;
+}
+
+/* frees every packet that comes before the given dts and order */
+static void discard_interleaved_packets(struct obs_output *output,
+		int64_t dts_usec, uint64_t order)
+{
+	struct interleaved_packet boundary;
+	boundary.packet.dts_usec = dts_usec;
+	boundary.order = order;
+
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &output->interleave_queues[i];
+		struct interleaved_packet *packet;
+
+		while ((packet = queue_front(queue)) != NULL &&
+		       packet_before(packet, &boundary)) {
+			obs_free_encoder_packet(&packet->packet);
+			queue_pop_front(queue);
+		}
+	}
+
+	rebuild_interleave_heap(output);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void send_interleaved(struct obs_output *output)
+{
+	struct encoder_packet out = first_interleaved_packet(output)->packet;
+
+	/* do not send an interleaved packet if there's no packet of the
+	 * opposing type of a higher timstamp in the interleave buffer.
+	 * this ensures that the timestamps are monotonic */
+	if (!has_higher_opposing_ts(output, &out))
+		return;
+
+	if (out.type == OBS_ENCODER_VIDEO)
+		output->total_frames++;
+
+	pop_first_interleaved_packet(output);
+	output->info.encoded_packet(output->context.data, &out);
+	obs_free_encoder_packet(&out);
+}
+
+static inline void set_higher_ts(struct obs_output *output,
+		struct encoder_packet *packet)
+{
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		if (output->highest_video_ts < packet->dts_usec)
+			output->highest_video_ts = packet->dts_usec;
+	} else {
+		if (output->highest_audio_ts < packet->dts_usec)
+			output->highest_audio_ts = packet->dts_usec;
+	}
+}
+
+static inline struct interleaved_packet *find_first_packet_type(
+		struct obs_output *output, enum obs_encoder_type type,
+		size_t audio_idx)
+{
+	return queue_front(get_queue(output, type, audio_idx));
+}
+
+static inline struct interleaved_packet *find_last_packet_type(
+		struct obs_output *output, enum obs_encoder_type type,
+		size_t audio_idx)
+{
+	return queue_back(get_queue(output, type, audio_idx));
+}
+
+/* gets the point where audio and video are closest together */
+static struct interleaved_packet *get_interleaved_start(
+		struct obs_output *output)
+{
+	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
+	struct interleaved_packet *first_video = find_first_packet_type(output,
+			OBS_ENCODER_VIDEO, 0);
+	struct interleaved_packet *closest = NULL;
+
+	for (size_t i = 1; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &output->interleave_queues[i];
+
+		for (size_t j = 0; j < queue_size(queue); j++) {
+			struct interleaved_packet *packet = queue_at(queue, j);
+			int64_t diff = llabs(packet->packet.dts_usec -
+					first_video->packet.dts_usec);
+
+			if (diff < closest_diff || (diff == closest_diff &&
+			    packet_before(packet, closest))) {
+				closest_diff = diff;
+				closest = packet;
+			}
+		}
+	}
+
+	return (!closest || packet_before(first_video, closest)) ?
+		first_video : closest;
+}
+
+/* returns 1 and the last of the first packets of each track if video starts
+ * too far ahead of audio, so that everything up to it can be pruned */
+static int prune_premature_packets(struct obs_output *output,
+		struct interleaved_packet **p_last)
+{
+	size_t audio_mixes = num_audio_mixes(output);
+	struct interleaved_packet *video;
+	struct interleaved_packet *last;
+	int64_t duration_usec;
+	int64_t max_diff = 0;
+	int64_t diff = 0;
+
+	video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
+	if (!video) {
+		output->received_video = false;
+		return -1;
+	}
+
+	last = video;
+	duration_usec = video->packet.timebase_num * 1000000LL /
+		video->packet.timebase_den;
+
+	for (size_t i = 0; i < audio_mixes; i++) {
+		struct interleaved_packet *audio;
+
+		audio = find_first_packet_type(output, OBS_ENCODER_AUDIO, i);
+		if (!audio) {
+			output->received_audio = false;
+			return -1;
+		}
+
+		if (packet_before(last, audio))
+			last = audio;
+
+		diff = audio->packet.dts_usec - video->packet.dts_usec;
+		if (diff > max_diff)
+			max_diff = diff;
+	}
+
+	*p_last = last;
+	return diff > duration_usec ? 1 : 0;
+}
+
+#define DEBUG_STARTING_PACKETS 0
+
+static bool prune_interleaved_packets(struct obs_output *output)
+{
+	struct interleaved_packet *start;
+	int prune_start = prune_premature_packets(output, &start);
+
+#if DEBUG_STARTING_PACKETS == 1
+	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &output->interleave_queues[i];
+
+		for (size_t j = 0; j < queue_size(queue); j++) {
+			struct encoder_packet *packet =
+				&queue_at(queue, j)->packet;
+			blog(LOG_DEBUG, "packet: %s %d, ts: %lld",
+					packet->type == OBS_ENCODER_AUDIO ?
+					"audio" : "video",
+					(int)packet->track_idx,
+					packet->dts_usec);
+		}
+	}
+#endif
+
+	/* prunes the first video packet if it's too far away from audio */
+	if (prune_start == -1)
+		return false;
+	else if (prune_start != 0)
+		discard_interleaved_packets(output, start->packet.dts_usec,
+				start->order + 1);
+	else {
+		start = get_interleaved_start(output);
+		discard_interleaved_packets(output, start->packet.dts_usec,
+				start->order);
+	}
+
+	return true;
+}
+
+static bool get_audio_and_video_packets(struct obs_output *output,
+		struct interleaved_packet **video,
+		struct interleaved_packet **audio, size_t audio_mixes)
+{
+	*video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
+	if (!*video)
+		output->received_video = false;
+
+	for (size_t i = 0; i < audio_mixes; i++) {
+		audio[i] = find_first_packet_type(output, OBS_ENCODER_AUDIO, i);
+		if (!audio[i]) {
+			output->received_audio = false;
+			return false;
+		}
+	}
+
+	if (!*video) {
+		return false;
+	}
+
+	return true;
+}
+
+/* numbers the packets in the order they're currently interleaved in, so
+ * packets that end up with the same dts once the offsets are applied keep
+ * their current order */
+static void renumber_interleaved_packets(struct obs_output *output)
+{
+	size_t pos[INTERLEAVE_QUEUES] = {0};
+	uint64_t order = 0;
+
+	for (;;) {
+		struct interleaved_packet *next = NULL;
+		size_t next_queue = 0;
+
+		for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+			struct interleave_queue *queue =
+				&output->interleave_queues[i];
+			struct interleaved_packet *packet;
+
+			if (pos[i] == queue_size(queue))
+				continue;
+
+			packet = queue_at(queue, pos[i]);
+			if (!next || packet_before(packet, next)) {
+				next = packet;
+				next_queue = i;
+			}
+		}
+
+		if (!next)
+			break;
+
+		next->order = order++;
+		pos[next_queue]++;
+	}
+
+	output->interleave_order = order;
+}
+
+static bool initialize_interleaved_packets(struct obs_output *output)
+{
+	struct interleaved_packet *video;
+	struct interleaved_packet *audio[MAX_AUDIO_MIXES];
+	struct interleaved_packet *last_audio[MAX_AUDIO_MIXES];
+	struct interleaved_packet *start;
+	size_t audio_mixes = num_audio_mixes(output);
+
+	if (!get_audio_and_video_packets(output, &video, audio, audio_mixes))
+		return false;
+
+	for (size_t i = 0; i < audio_mixes; i++)
+		last_audio[i] = find_last_packet_type(output, OBS_ENCODER_AUDIO,
+				i);
+
+	/* ensure that there is audio past the first video packet */
+	for (size_t i = 0; i < audio_mixes; i++) {
+		if (last_audio[i]->packet.dts_usec < video->packet.dts_usec) {
+			output->received_audio = false;
+			return false;
+		}
+	}
+
+	/* clear out excess starting audio if it hasn't been already */
+	start = get_interleaved_start(output);
+	if (start != first_interleaved_packet(output)) {
+		discard_interleaved_packets(output, start->packet.dts_usec,
+				start->order);
+		if (!get_audio_and_video_packets(output, &video, audio,
+					audio_mixes))
+			return false;
+	}
+
+	/* get new offsets */
+	output->video_offset = video->packet.dts;
+	for (size_t i = 0; i < audio_mixes; i++)
+		output->audio_offsets[i] = audio[i]->packet.dts;
+
+#if DEBUG_STARTING_PACKETS == 1
+	int64_t v = video->packet.dts_usec;
+	int64_t a = audio[0]->packet.dts_usec;
+	int64_t diff = v - a;
+
+	blog(LOG_DEBUG, "output '%s' offset for video: %lld, audio: %lld, "
+			"diff: %lldms", output->context.name, v, a,
+			diff / 1000LL);
+#endif
+
+	/* subtract offsets from highest TS offset variables */
+	output->highest_audio_ts -= audio[0]->packet.dts_usec;
+	output->highest_video_ts -= video->packet.dts_usec;
+
+	renumber_interleaved_packets(output);
+
+	/* apply new offsets to all existing packet DTS/PTS values */
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &output->interleave_queues[i];
+
+		for (size_t j = 0; j < queue_size(queue); j++)
+			apply_interleaved_packet_offset(output,
+					&queue_at(queue, j)->packet);
+	}
+
+	return true;
+}
+
+/* inserts from the back, as packets almost always arrive in order */
+static inline void insert_interleaved_packet(struct obs_output *output,
+		struct encoder_packet *out)
+{
+	struct interleave_queue *queue = get_queue(output, out->type,
+			out->track_idx);
+	struct interleaved_packet new_packet = {*out,
+		output->interleave_order++};
+	size_t idx = queue_size(queue);
+	bool was_empty = idx == 0;
+
+	while (idx > 0 && packet_before(&new_packet, queue_at(queue, idx - 1)))
+		idx--;
+
+	da_insert(queue->packets, queue->start + idx, &new_packet);
+
+	if (was_empty) {
+		size_t pos = output->interleave_heap_size++;
+		output->interleave_heap[pos] =
+			(size_t)(queue - output->interleave_queues);
+		heap_sift_up(output, pos);
+
+	} else if (idx == 0) {
+		for (size_t pos = 0; pos < output->interleave_heap_size; pos++) {
+			if (&output->interleave_queues[
+					output->interleave_heap[pos]] == queue) {
+				heap_sift_up(output, pos);
+				break;
+			}
+		}
+	}
+}
+
+/* the offsets only shift each queue as a whole, but packets can still end
+ * up out of order between queues, and rarely within one */
+static void resort_interleaved_packets(struct obs_output *output)
+{
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &output->interleave_queues[i];
+
+		for (size_t j = 1; j < queue_size(queue); j++) {
+			struct interleaved_packet packet = *queue_at(queue, j);
+			size_t k = j;
+
+			while (k > 0 && packet_before(&packet,
+						queue_at(queue, k - 1))) {
+				*queue_at(queue, k) = *queue_at(queue, k - 1);
+				k--;
+			}
+
+			*queue_at(queue, k) = packet;
+		}
+	}
+
+	rebuild_interleave_heap(output);
+}
+
+static void discard_unused_audio_packets(struct obs_output *output,
+		int64_t dts_usec)
+{
+	discard_interleaved_packets(output, dts_usec, 0);
+}
+
+void interleave_packets(void *data, struct encoder_packet *packet)
+{
+	struct obs_output     *output = data;
+	struct encoder_packet out;
+	bool                  was_started;
+
+	if (!active(output))
+		return;
+
+	if (packet->type == OBS_ENCODER_AUDIO)
+		packet->track_idx = get_track_index(output, packet);
+
+	pthread_mutex_lock(&output->interleaved_mutex);
+
+	/* if first video frame is not a keyframe, discard until received */
+	if (!output->received_video &&
+	    packet->type == OBS_ENCODER_VIDEO &&
+	    !packet->keyframe) {
+		discard_unused_audio_packets(output, packet->dts_usec);
+		pthread_mutex_unlock(&output->interleaved_mutex);
+
+		if (output->active_delay_ns)
+			obs_free_encoder_packet(packet);
+		return;
+	}
+
+	was_started = output->received_audio && output->received_video;
+
+	if (output->active_delay_ns)
+		out = *packet;
+	else
+		obs_duplicate_encoder_packet(&out, packet);
+
+	if (was_started)
+		apply_interleaved_packet_offset(output, &out);
+	else
+		check_received(output, packet);
+
+	insert_interleaved_packet(output, &out);
+	set_higher_ts(output, &out);
+
+	/* when both video and audio have been received, we're ready
+	 * to start sending out packets (one at a time) */
+	if (output->received_audio && output->received_video) {
+		if (!was_started) {
+			if (prune_interleaved_packets(output)) {
+				if (initialize_interleaved_packets(output)) {
+					resort_interleaved_packets(output);
+					send_interleaved(output);
+				}
+			}
+		} else {
+			send_interleaved(output);
+		}
+	}
+
+	pthread_mutex_unlock(&output->interleaved_mutex);
+}
@@ -154,13 +154,6 @@ fail:
 	return NULL;
 }
 
-static inline void free_packets(struct obs_output *output)
-{
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_free_encoder_packet(output->interleaved_packets.array+i);
-	da_free(output->interleaved_packets);
-}
-
 void obs_output_destroy(obs_output_t *output)
 {
 	if (output) {
@@ -180,7 +173,7 @@ void obs_output_destroy(obs_output_t *output)
 		if (output->context.data)
 			output->info.destroy(output->context.data);
 
-		free_packets(output);
+		free_interleaved_packets(output);
 
 		if (output->video_encoder) {
 			obs_encoder_remove_output(output->video_encoder,
@@ -758,41 +751,6 @@ void obs_output_set_audio_conversion(obs_output_t *output,
 	output->audio_conversion_set = true;
 }
 
-static inline bool service_supports_multitrack(const struct obs_output *output)
-{
-	const struct obs_service *service = output->service;
-
-	if (!service || !service->info.supports_multitrack) {
-		return false;
-	}
-
-	return service->info.supports_multitrack(service->context.data);
-}
-
-static inline size_t num_audio_mixes(const struct obs_output *output)
-{
-	size_t mix_count = 1;
-
-	if ((output->info.flags & OBS_OUTPUT_SERVICE) != 0) {
-		if (!service_supports_multitrack(output)) {
-			return 1;
-		}
-	}
-
-	if ((output->info.flags & OBS_OUTPUT_MULTI_TRACK) != 0) {
-		mix_count = 0;
-
-		for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
-			if (!output->audio_encoders[i])
-				break;
-
-			mix_count++;
-		}
-	}
-
-	return mix_count;
-}
-
 static inline bool audio_valid(const struct obs_output *output, bool encoded)
 {
 	if (encoded) {
@@ -883,463 +841,6 @@ static inline struct audio_convert_info *get_audio_conversion(
 	return output->audio_conversion_set ? &output->audio_conversion : NULL;
 }
 
-static size_t get_track_index(const struct obs_output *output,
-		struct encoder_packet *pkt)
-{
-	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
-		struct obs_encoder *encoder = output->audio_encoders[i];
-
-		if (pkt->encoder == encoder)
-			return i;
-	}
-
-	assert(false);
-	return 0;
-}
-
-static inline void check_received(struct obs_output *output,
-		struct encoder_packet *out)
-{
-	if (out->type == OBS_ENCODER_VIDEO) {
-		if (!output->received_video)
-			output->received_video = true;
-	} else {
-		if (!output->received_audio)
-			output->received_audio = true;
-	}
-}
-
-static inline void apply_interleaved_packet_offset(struct obs_output *output,
-		struct encoder_packet *out)
-{
-	int64_t offset;
-
-	/* audio and video need to start at timestamp 0, and the encoders
-	 * may not currently be at 0 when we get data.  so, we store the
-	 * current dts as offset and subtract that value from the dts/pts
-	 * of the output packet. */
-	offset = (out->type == OBS_ENCODER_VIDEO) ?
-		output->video_offset : output->audio_offsets[out->track_idx];
-
-	out->dts -= offset;
-	out->pts -= offset;
-
-	/* convert the newly adjusted dts to relative dts time to ensure proper
-	 * interleaving.  if we're using an audio encoder that's already been
-	 * started on another output, then the first audio packet may not be
-	 * quite perfectly synced up in terms of system time (and there's
-	 * nothing we can really do about that), but it will always at least be
-	 * within a 23ish millisecond threshold (at least for AAC) */
-	out->dts_usec = packet_dts_usec(out);
-}
-
-static inline bool has_higher_opposing_ts(struct obs_output *output,
-		struct encoder_packet *packet)
-{
-	if (packet->type == OBS_ENCODER_VIDEO)
-		return output->highest_audio_ts > packet->dts_usec;
-	else
-		return output->highest_video_ts > packet->dts_usec;
-}
-
-static inline void send_interleaved(struct obs_output *output)
-{
-	struct encoder_packet out = output->interleaved_packets.array[0];
-
-	/* do not send an interleaved packet if there's no packet of the
-	 * opposing type of a higher timstamp in the interleave buffer.
-	 * this ensures that the timestamps are monotonic */
-	if (!has_higher_opposing_ts(output, &out))
-		return;
-
-	if (out.type == OBS_ENCODER_VIDEO)
-		output->total_frames++;
-
-	da_erase(output->interleaved_packets, 0);
-	output->info.encoded_packet(output->context.data, &out);
-	obs_free_encoder_packet(&out);
-}
-
-static inline void set_higher_ts(struct obs_output *output,
-		struct encoder_packet *packet)
-{
-	if (packet->type == OBS_ENCODER_VIDEO) {
-		if (output->highest_video_ts < packet->dts_usec)
-			output->highest_video_ts = packet->dts_usec;
-	} else {
-		if (output->highest_audio_ts < packet->dts_usec)
-			output->highest_audio_ts = packet->dts_usec;
-	}
-}
-
-static inline struct encoder_packet *find_first_packet_type(
-		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx);
-static int find_first_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx);
-
-/* gets the point where audio and video are closest together */
-static size_t get_interleaved_start_idx(struct obs_output *output)
-{
-	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
-	struct encoder_packet *first_video = find_first_packet_type(output,
-			OBS_ENCODER_VIDEO, 0);
-	size_t video_idx = DARRAY_INVALID;
-	size_t idx = 0;
-
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		int64_t diff;
-
-		if (packet->type != OBS_ENCODER_AUDIO) {
-			if (packet == first_video)
-				video_idx = i;
-			continue;
-		}
-
-		diff = llabs(packet->dts_usec - first_video->dts_usec);
-		if (diff < closest_diff) {
-			closest_diff = diff;
-			idx = i;
-		}
-	}
-
-	return video_idx < idx ? video_idx : idx;
-}
-
-static int prune_premature_packets(struct obs_output *output)
-{
-	size_t audio_mixes = num_audio_mixes(output);
-	struct encoder_packet *video;
-	int video_idx;
-	int max_idx;
-	int64_t duration_usec;
-	int64_t max_diff = 0;
-	int64_t diff = 0;
-
-	video_idx = find_first_packet_type_idx(output, OBS_ENCODER_VIDEO, 0);
-	if (video_idx == -1) {
-		output->received_video = false;
-		return -1;
-	}
-
-	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
-	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
-
-	for (size_t i = 0; i < audio_mixes; i++) {
-		struct encoder_packet *audio;
-		int audio_idx;
-
-		audio_idx = find_first_packet_type_idx(output,
-				OBS_ENCODER_AUDIO, i);
-		if (audio_idx == -1) {
-			output->received_audio = false;
-			return -1;
-		}
-
-		audio = &output->interleaved_packets.array[audio_idx];
-		if (audio_idx > max_idx)
-			max_idx = audio_idx;
-
-		diff = audio->dts_usec - video->dts_usec;
-		if (diff > max_diff)
-			max_diff = diff;
-	}
-
-	return diff > duration_usec ? max_idx + 1 : 0;
-}
-
-static void discard_to_idx(struct obs_output *output, size_t idx)
-{
-	for (size_t i = 0; i < idx; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		obs_free_encoder_packet(packet);
-	}
-
-	da_erase_range(output->interleaved_packets, 0, idx);
-}
-
-#define DEBUG_STARTING_PACKETS 0
-
-static bool prune_interleaved_packets(struct obs_output *output)
-{
-	size_t start_idx = 0;
-	int prune_start = prune_premature_packets(output);
-
-#if DEBUG_STARTING_PACKETS == 1
-	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
-				packet->type == OBS_ENCODER_AUDIO ?
-				"audio" : "video", (int)packet->track_idx,
-				packet->dts_usec,
-				(int)i < prune_start ? "true" : "false");
-	}
-#endif
-
-	/* prunes the first video packet if it's too far away from audio */
-	if (prune_start == -1)
-		return false;
-	else if (prune_start != 0)
-		start_idx = (size_t)prune_start;
-	else
-		start_idx = get_interleaved_start_idx(output);
-
-	if (start_idx)
-		discard_to_idx(output, start_idx);
-
-	return true;
-}
-
-static int find_first_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx)
-{
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-
-		if (packet->type == type) {
-			if (type == OBS_ENCODER_AUDIO &&
-			    packet->track_idx != audio_idx) {
-				continue;
-			}
-
-			return (int)i;
-		}
-	}
-
-	return -1;
-}
-
-static int find_last_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx)
-{
-	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i - 1];
-
-		if (packet->type == type) {
-			if (type == OBS_ENCODER_AUDIO &&
-			    packet->track_idx != audio_idx) {
-				continue;
-			}
-
-			return (int)(i - 1);
-		}
-	}
-
-	return -1;
-}
-
-static inline struct encoder_packet *find_first_packet_type(
-		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx)
-{
-	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
-static inline struct encoder_packet *find_last_packet_type(
-		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx)
-{
-	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
-static bool get_audio_and_video_packets(struct obs_output *output,
-		struct encoder_packet **video,
-		struct encoder_packet **audio, size_t audio_mixes)
-{
-	*video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
-	if (!*video)
-		output->received_video = false;
-
-	for (size_t i = 0; i < audio_mixes; i++) {
-		audio[i] = find_first_packet_type(output, OBS_ENCODER_AUDIO, i);
-		if (!audio[i]) {
-			output->received_audio = false;
-			return false;
-		}
-	}
-
-	if (!*video) {
-		return false;
-	}
-
-	return true;
-}
-
-static bool initialize_interleaved_packets(struct obs_output *output)
-{
-	struct encoder_packet *video;
-	struct encoder_packet *audio[MAX_AUDIO_MIXES];
-	struct encoder_packet *last_audio[MAX_AUDIO_MIXES];
-	size_t audio_mixes = num_audio_mixes(output);
-	size_t start_idx;
-
-	if (!get_audio_and_video_packets(output, &video, audio, audio_mixes))
-		return false;
-
-	for (size_t i = 0; i < audio_mixes; i++)
-		last_audio[i] = find_last_packet_type(output, OBS_ENCODER_AUDIO,
-				i);
-
-	/* ensure that there is audio past the first video packet */
-	for (size_t i = 0; i < audio_mixes; i++) {
-		if (last_audio[i]->dts_usec < video->dts_usec) {
-			output->received_audio = false;
-			return false;
-		}
-	}
-
-	/* clear out excess starting audio if it hasn't been already */
-	start_idx = get_interleaved_start_idx(output);
-	if (start_idx) {
-		discard_to_idx(output, start_idx);
-		if (!get_audio_and_video_packets(output, &video, audio,
-					audio_mixes))
-			return false;
-	}
-
-	/* get new offsets */
-	output->video_offset = video->dts;
-	for (size_t i = 0; i < audio_mixes; i++)
-		output->audio_offsets[i] = audio[i]->dts;
-
-#if DEBUG_STARTING_PACKETS == 1
-	int64_t v = video->dts_usec;
-	int64_t a = audio[0]->dts_usec;
-	int64_t diff = v - a;
-
-	blog(LOG_DEBUG, "output '%s' offset for video: %lld, audio: %lld, "
-			"diff: %lldms", output->context.name, v, a,
-			diff / 1000LL);
-#endif
-
-	/* subtract offsets from highest TS offset variables */
-	output->highest_audio_ts -= audio[0]->dts_usec;
-	output->highest_video_ts -= video->dts_usec;
-
-	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		apply_interleaved_packet_offset(output, packet);
-	}
-
-	return true;
-}
-
-static inline void insert_interleaved_packet(struct obs_output *output,
-		struct encoder_packet *out)
-{
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
-
-		if (out->dts_usec < cur_packet->dts_usec)
-			break;
-	}
-
-	da_insert(output->interleaved_packets, idx, out);
-}
-
-static void resort_interleaved_packets(struct obs_output *output)
-{
-	DARRAY(struct encoder_packet) old_array;
-
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0,
-			sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++)
-		insert_interleaved_packet(output, &old_array.array[i]);
-
-	da_free(old_array);
-}
-
-static void discard_unused_audio_packets(struct obs_output *output,
-		int64_t dts_usec)
-{
-	size_t idx = 0;
-
-	for (; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *p =
-			&output->interleaved_packets.array[idx];
-
-		if (p->dts_usec >= dts_usec)
-			break;
-	}
-
-	if (idx)
-		discard_to_idx(output, idx);
-}
-
-static void interleave_packets(void *data, struct encoder_packet *packet)
-{
-	struct obs_output     *output = data;
-	struct encoder_packet out;
-	bool                  was_started;
-
-	if (!active(output))
-		return;
-
-	if (packet->type == OBS_ENCODER_AUDIO)
-		packet->track_idx = get_track_index(output, packet);
-
-	pthread_mutex_lock(&output->interleaved_mutex);
-
-	/* if first video frame is not a keyframe, discard until received */
-	if (!output->received_video &&
-	    packet->type == OBS_ENCODER_VIDEO &&
-	    !packet->keyframe) {
-		discard_unused_audio_packets(output, packet->dts_usec);
-		pthread_mutex_unlock(&output->interleaved_mutex);
-
-		if (output->active_delay_ns)
-			obs_free_encoder_packet(packet);
-		return;
-	}
-
-	was_started = output->received_audio && output->received_video;
-
-	if (output->active_delay_ns)
-		out = *packet;
-	else
-		obs_duplicate_encoder_packet(&out, packet);
-
-	if (was_started)
-		apply_interleaved_packet_offset(output, &out);
-	else
-		check_received(output, packet);
-
-	insert_interleaved_packet(output, &out);
-	set_higher_ts(output, &out);
-
-	/* when both video and audio have been received, we're ready
-	 * to start sending out packets (one at a time) */
-	if (output->received_audio && output->received_video) {
-		if (!was_started) {
-			if (prune_interleaved_packets(output)) {
-				if (initialize_interleaved_packets(output)) {
-					resort_interleaved_packets(output);
-					send_interleaved(output);
-				}
-			}
-		} else {
-			send_interleaved(output);
-		}
-	}
-
-	pthread_mutex_unlock(&output->interleaved_mutex);
-}
 
 static void default_encoded_callback(void *param, struct encoder_packet *packet)
 {
@@ -1401,7 +902,7 @@ static void reset_packet_data(obs_output_t *output)
 	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
 		output->audio_offsets[0] = 0;
 
-	free_packets(output);
+	free_interleaved_packets(output);
 }
 
 static inline bool preserve_active(struct obs_output *output)
@@ -18,6 +18,7 @@
 
 #include "util/threading.h"
 #include "graphics/math-defs.h"
+#include "media-io/audio-math.h"
 #include "obs-scene.h"
 
 /* NOTE: For proper mutex lock order (preventing mutual cross-locks), never
@@ -196,6 +197,8 @@ static inline void detach_sceneitem(struct obs_scene_item *item)
 		item->next->prev = item->prev;
 
 	item->parent = NULL;
+
+	obs_audio_tree_changed();
 }
 
 static inline void attach_sceneitem(struct obs_scene *parent,
@@ -215,6 +218,8 @@ static inline void attach_sceneitem(struct obs_scene *parent,
 			parent->first_item->prev = item;
 		parent->first_item = item;
 	}
+
+	obs_audio_tree_changed();
 }
 
 void add_alignment(struct vec2 *v, uint32_t align, int cx, int cy)
@@ -565,6 +570,8 @@ static void set_visibility(struct obs_scene_item *item, bool vis)
 	item->user_visible = vis;
 
 	pthread_mutex_unlock(&item->actions_mutex);
+
+	obs_audio_tree_changed();
 }
 
 static void scene_load_item(struct obs_scene *scene, obs_data_t *item_data)
@@ -739,6 +746,7 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item,
 		float **p_buf, uint64_t ts, size_t sample_rate)
 {
 	bool cur_visible = item->visible;
+	uint64_t frames = obs->audio.block_frames;
 	uint64_t frame_num = 0;
 	size_t deref_count = 0;
 	float *buf;
@@ -760,7 +768,7 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item,
 		new_frame_num = (timestamp - ts) * (uint64_t)sample_rate /
 			1000000000ULL;
 
-		if (new_frame_num >= AUDIO_OUTPUT_FRAMES)
+		if (new_frame_num >= frames)
 			break;
 
 		da_erase(item->audio_actions, i--);
@@ -777,7 +785,7 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item,
 		cur_visible = item->visible;
 	}
 
-	for (; frame_num < AUDIO_OUTPUT_FRAMES; frame_num++)
+	for (; frame_num < frames; frame_num++)
 		buf[frame_num] = cur_visible ? 1.0f : 0.0f;
 
 	pthread_mutex_unlock(&item->actions_mutex);
@@ -805,7 +813,7 @@ static inline bool apply_scene_item_volume(struct obs_scene_item *item,
 	pthread_mutex_unlock(&item->actions_mutex);
 
 	if (actions_pending) {
-		uint64_t duration = (uint64_t)AUDIO_OUTPUT_FRAMES *
+		uint64_t duration = (uint64_t)obs->audio.block_frames *
 			1000000000ULL / (uint64_t)sample_rate;
 
 		if (action.timestamp < (ts + duration)) {
@@ -821,24 +829,13 @@ static inline bool apply_scene_item_volume(struct obs_scene_item *item,
 static void mix_audio_with_buf(float *p_out, float *p_in, float *buf_in,
 		size_t pos, size_t count)
 {
-	register float *out = p_out;
-	register float *buf = buf_in + pos;
-	register float *in = p_in + pos;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++) * *(buf++);
+	audio_mix_add_scaled_buf(p_out, p_in + pos, buf_in + pos, count);
 }
 
 static inline void mix_audio(float *p_out, float *p_in,
 		size_t pos, size_t count)
 {
-	register float *out = p_out;
-	register float *in = p_in + pos;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++);
+	audio_mix_add(p_out, p_in + pos, count);
 }
 
 static bool scene_audio_render(void *data, uint64_t *ts_out,
@@ -874,6 +871,7 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 	item = scene->first_item;
 	while (item) {
 		uint64_t source_ts;
+		uint32_t child_mixers;
 		size_t pos, count;
 		bool apply_buf;
 
@@ -888,16 +886,20 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 		source_ts = obs_source_get_audio_timestamp(item->source);
 		pos = (size_t)ns_to_audio_frames(sample_rate,
 				source_ts - timestamp);
-		count = AUDIO_OUTPUT_FRAMES - pos;
+		count = obs->audio.block_frames - pos;
 
 		if (!apply_buf && !item->visible) {
 			item = item->next;
 			continue;
 		}
 
+		/* mixes the child has disabled are silent */
+		child_mixers = mixers &
+			obs_source_get_audio_mixers(item->source);
+
 		obs_source_get_audio_mix(item->source, &child_audio);
 		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-			if ((mixers & (1 << mix)) == 0)
+			if ((child_mixers & (1 << mix)) == 0)
 				continue;
 
 			for (size_t ch = 0; ch < channels; ch++) {
@@ -928,7 +930,8 @@ const struct obs_source_info scene_info =
 	.type          = OBS_SOURCE_TYPE_SCENE,
 	.output_flags  = OBS_SOURCE_VIDEO |
 	                 OBS_SOURCE_CUSTOM_DRAW |
-	                 OBS_SOURCE_COMPOSITE,
+	                 OBS_SOURCE_COMPOSITE |
+	                 OBS_SOURCE_THREADED_TICK,
 	.get_name      = scene_getname,
 	.create        = scene_create,
 	.destroy       = scene_destroy,
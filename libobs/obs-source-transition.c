@@ -15,6 +15,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include "media-io/audio-math.h"
 #include "obs-internal.h"
 
 #define lock_transition(transition) \
@@ -256,6 +257,8 @@ static void set_source(obs_source_t *transition,
 
 	unlock_transition(transition);
 
+	obs_audio_tree_changed();
+
 	if (add_success) {
 		if (transition->transition_cx == 0 ||
 		    transition->transition_cy == 0) {
@@ -411,6 +414,8 @@ void obs_transition_set(obs_source_t *transition, obs_source_t *source)
 	transition->transitioning_audio = false;
 	unlock_transition(transition);
 
+	obs_audio_tree_changed();
+
 	for (size_t i = 0; i < 2; i++) {
 		if (s[i] && active[i])
 			obs_source_remove_active_child(transition, s[i]);
@@ -562,6 +567,8 @@ void obs_transition_load(obs_source_t *tr, obs_data_t *data)
 	tr->transition_cy = (uint32_t)cy;
 	unlock_transition(tr);
 
+	obs_audio_tree_changed();
+
 	recalculate_transition_size(tr);
 	recalculate_transition_matrices(tr);
 }
@@ -643,6 +650,8 @@ static void obs_transition_stop(obs_source_t *transition)
 	transition->transition_source_active[1] = false;
 	transition->transition_sources[0] = transition->transition_sources[1];
 	transition->transition_sources[1] = NULL;
+
+	obs_audio_tree_changed();
 }
 
 void obs_transition_video_render(obs_source_t *transition,
@@ -741,7 +750,9 @@ static inline float get_sample_time(obs_source_t *transition,
 	return calc_time(transition, i_ts);
 }
 
-static inline void mix_child(obs_source_t *transition, float *out, float *in,
+/* the mix volume only depends on the sample time, so it's calculated once
+ * and shared by every mix and channel of the child */
+static inline void get_mix_volumes(obs_source_t *transition, float *vol,
 		size_t count, size_t sample_rate, uint64_t ts,
 		obs_transition_audio_mix_callback_t mix)
 {
@@ -749,7 +760,7 @@ static inline void mix_child(obs_source_t *transition, float *out, float *in,
 
 	for (size_t i = 0; i < count; i++) {
 		float t = get_sample_time(transition, sample_rate, i, ts);
-		out[i] += in[i] * mix(context_data, t);
+		vol[i] = mix(context_data, t);
 	}
 }
 
@@ -760,6 +771,8 @@ static void process_audio(obs_source_t *transition, obs_source_t *child,
 {
 	bool valid = child && !child->audio_pending;
 	struct obs_source_audio_mix child_audio;
+	float vol[AUDIO_OUTPUT_FRAMES];
+	size_t frames = obs->audio.block_frames;
 	uint64_t ts;
 	size_t pos;
 
@@ -770,9 +783,12 @@ static void process_audio(obs_source_t *transition, obs_source_t *child,
 	obs_source_get_audio_mix(child, &child_audio);
 	pos = (size_t)ns_to_audio_frames(sample_rate, ts - min_ts);
 
-	if (pos > AUDIO_OUTPUT_FRAMES)
+	if (pos > frames)
 		return;
 
+	get_mix_volumes(transition, vol, frames - pos,
+			sample_rate, ts, mix);
+
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_output_data *output = &audio->output[mix_idx];
 		struct audio_output_data *input = &child_audio.output[mix_idx];
@@ -784,9 +800,8 @@ static void process_audio(obs_source_t *transition, obs_source_t *child,
 			float *out = output->data[ch];
 			float *in = input->data[ch];
 
-			mix_child(transition, out + pos, in,
-					AUDIO_OUTPUT_FRAMES - pos,
-					sample_rate, ts, mix);
+			audio_mix_add_scaled_buf(out + pos, in, vol,
+					frames - pos);
 		}
 	}
 }
@@ -805,9 +820,20 @@ static inline uint64_t calc_min_ts(obs_source_t *sources[2])
 	return min_ts;
 }
 
-#define TOTAL_AUDIO_SIZE \
-	(MAX_AUDIO_MIXES * MAX_AUDIO_CHANNELS * \
-	 AUDIO_OUTPUT_FRAMES * sizeof(float))
+static inline void copy_audio(struct obs_source_audio_mix *audio,
+		obs_source_t *child, uint32_t mixers, size_t channels)
+{
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((mixers & (1 << mix)) == 0)
+			continue;
+
+		for (size_t ch = 0; ch < channels; ch++)
+			memcpy(audio->output[mix].data[ch],
+					child->audio_output_buf[mix][ch],
+					obs->audio.block_frames *
+					sizeof(float));
+	}
+}
 
 static inline bool stop_audio(obs_source_t *transition)
 {
@@ -872,9 +898,7 @@ bool obs_transition_audio_render(obs_source_t *transition,
 						min_ts, mixers, channels,
 						sample_rate, mix_b);
 		} else if (state.s[0]) {
-			memcpy(audio->output[0].data[0],
-					state.s[0]->audio_output_buf[0][0],
-					TOTAL_AUDIO_SIZE);
+			copy_audio(audio, state.s[0], mixers, channels);
 		}
 
 		obs_source_release(state.s[0]);
@@ -922,6 +946,8 @@ static inline obs_source_t *copy_source_state(obs_source_t *tr_dest,
 		obs_source_add_active_child(tr_dest, new_child);
 	obs_source_addref(new_child);
 
+	obs_audio_tree_changed();
+
 	return old_child;
 }
 
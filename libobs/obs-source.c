@@ -20,6 +20,7 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-math.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "callback/calldata.h"
@@ -98,6 +99,16 @@ const char *obs_source_get_display_name(const char *id)
 	return (info != NULL) ? info->get_name(info->type_data) : NULL;
 }
 
+/* names are stored when the source is created or renamed so the audio
+ * thread never has to read the source name */
+static void set_audio_render_name(struct obs_source *source)
+{
+	source->audio_render_name = profile_store_name(
+			obs_get_profiler_name_store(),
+			"audio_render(%s)",
+			source->context.name ? source->context.name : "");
+}
+
 static void allocate_audio_output_buffer(struct obs_source *source)
 {
 	size_t size = sizeof(float) *
@@ -145,6 +156,7 @@ bool obs_source_init(struct obs_source *source)
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
+	pthread_mutex_init_value(&source->rt_audio_mutex);
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		return false;
@@ -162,9 +174,13 @@ bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init(&source->async_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&source->rt_audio_mutex, NULL) != 0)
+		return false;
 
-	if (is_audio_source(source) || is_composite_source(source))
+	if (is_audio_source(source) || is_composite_source(source)) {
 		allocate_audio_output_buffer(source);
+		set_audio_render_name(source);
+	}
 
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION) {
 		if (!obs_transition_init(source))
@@ -188,6 +204,8 @@ bool obs_source_init(struct obs_source *source)
 		obs->data.first_audio_source = source;
 
 		pthread_mutex_unlock(&obs->data.audio_sources_mutex);
+
+		obs_audio_tree_changed();
 	}
 
 	obs_context_data_insert(&source->context,
@@ -527,12 +545,19 @@ void obs_source_destroy(struct obs_source *source)
 		circlebuf_free(&source->audio_input_buf[i]);
 	audio_resampler_destroy(source->resampler);
 	bfree(source->audio_output_buf[0][0]);
+	bfree(source->rt_audio_buf);
+
+	if (source->rt_audio_dropped)
+		blog(LOG_WARNING, "Source '%s' dropped %ld realtime audio "
+				"packets", source->context.name,
+				source->rt_audio_dropped);
 
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_free(source);
 
 	da_free(source->audio_actions);
 	da_free(source->audio_cb_list);
+	da_free(source->audio_levels_cb_list);
 	da_free(source->async_cache);
 	da_free(source->async_frames);
 	da_free(source->filters);
@@ -542,6 +567,7 @@ void obs_source_destroy(struct obs_source *source)
 	pthread_mutex_destroy(&source->audio_cb_mutex);
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
+	pthread_mutex_destroy(&source->rt_audio_mutex);
 	obs_context_data_free(&source->context);
 
 	if (source->owns_info_id)
@@ -920,13 +946,10 @@ void obs_source_deactivate(obs_source_t *source, enum view_type type)
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 		uint64_t sys_time);
 
-void obs_source_video_tick(obs_source_t *source, float seconds)
+void obs_source_prepare_video_tick(obs_source_t *source)
 {
 	bool now_showing, now_active;
 
-	if (!obs_source_valid(source, "obs_source_video_tick"))
-		return;
-
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source);
 
@@ -983,13 +1006,21 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		source->active = now_active;
 	}
 
-	if (source->context.data && source->info.video_tick)
-		source->info.video_tick(source->context.data, seconds);
-
 	source->async_rendered = false;
 	source->deinterlace_rendered = false;
 }
 
+void obs_source_video_tick(obs_source_t *source, float seconds)
+{
+	if (!obs_source_valid(source, "obs_source_video_tick"))
+		return;
+
+	obs_source_prepare_video_tick(source);
+
+	if (source->context.data && source->info.video_tick)
+		source->info.video_tick(source->context.data, seconds);
+}
+
 /* unless the value is 3+ hours worth of frames, this won't overflow */
 static inline uint64_t conv_frames_to_time(const size_t sample_rate,
 		const size_t frames)
@@ -1015,6 +1046,9 @@ static inline void reset_audio_timing(obs_source_t *source, uint64_t timestamp,
 
 static void reset_audio_data(obs_source_t *source, uint64_t os_time)
 {
+	source->audio_discarded_frames +=
+		source->audio_input_buf[0].size / sizeof(float);
+
 	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 		if (source->audio_input_buf[i].size)
 			circlebuf_pop_front(&source->audio_input_buf[i], NULL,
@@ -1034,6 +1068,7 @@ static void handle_ts_jump(obs_source_t *source, uint64_t expected,
 
 	pthread_mutex_lock(&source->audio_buf_mutex);
 	reset_audio_timing(source, ts, os_time);
+	source->audio_ts_jumps++;
 	pthread_mutex_unlock(&source->audio_buf_mutex);
 }
 
@@ -1085,8 +1120,10 @@ static void source_output_audio_place(obs_source_t *source,
 #endif
 
 	/* do not allow the circular buffers to become too big */
-	if ((buf_placement + size) > MAX_BUF_SIZE)
+	if ((buf_placement + size) > MAX_BUF_SIZE) {
+		source->audio_discarded_frames += in->frames;
 		return;
+	}
 
 	for (size_t i = 0; i < channels; i++) {
 		circlebuf_place(&source->audio_input_buf[i], buf_placement,
@@ -1107,8 +1144,10 @@ static inline void source_output_audio_push_back(obs_source_t *source,
 	size_t size = in->frames * sizeof(float);
 
 	/* do not allow the circular buffers to become too big */
-	if ((source->audio_input_buf[0].size + size) > MAX_BUF_SIZE)
+	if ((source->audio_input_buf[0].size + size) > MAX_BUF_SIZE) {
+		source->audio_discarded_frames += in->frames;
 		return;
+	}
 
 	for (size_t i = 0; i < channels; i++)
 		circlebuf_push_back(&source->audio_input_buf[i],
@@ -1139,6 +1178,91 @@ static inline bool source_muted(obs_source_t *source, uint64_t os_time)
 			(source->push_to_talk_enabled && !push_to_talk_active);
 }
 
+/* slots that were skipped over, because a packet covered more than one
+ * slot, keep their old slot number and are skipped by readers */
+static struct audio_level_slot *start_audio_level_slot(obs_source_t *source,
+		uint64_t slot_num)
+{
+	long idx = (long)(slot_num % AUDIO_LEVEL_HISTORY);
+	struct audio_level_slot *slot = &source->audio_levels[idx];
+
+	os_atomic_inc_long(&slot->seq);
+	slot->slot   = slot_num;
+	slot->frames = 0;
+	slot->muted  = false;
+	memset(slot->peak, 0, sizeof(slot->peak));
+	memset(slot->true_peak, 0, sizeof(slot->true_peak));
+	memset(slot->sum_squares, 0, sizeof(slot->sum_squares));
+	os_atomic_inc_long(&slot->seq);
+
+	os_atomic_set_long(&source->audio_level_cur, idx);
+	return slot;
+}
+
+/* levels are metered once here as the audio is received, for every meter of
+ * the source, so sources that aren't being mixed are metered as well */
+static void meter_audio_data(obs_source_t *source,
+		const struct audio_data *in, bool muted)
+{
+	size_t channels = audio_output_get_channels(obs->audio.audio);
+	size_t sample_rate = audio_output_get_sample_rate(obs->audio.audio);
+	uint64_t slot_frames = sample_rate * AUDIO_LEVEL_SLOT_MS / 1000;
+	uint64_t slot_num = source->audio_level_frames / slot_frames;
+	struct audio_level_slot *slot =
+		&source->audio_levels[source->audio_level_cur];
+	struct obs_audio_levels levels;
+	float sum_squares[MAX_AUDIO_CHANNELS];
+
+	if (slot->slot != slot_num)
+		slot = start_audio_level_slot(source, slot_num);
+
+	memset(&levels, 0, sizeof(levels));
+	levels.ticks    = slot_num;
+	levels.frames   = in->frames;
+	levels.channels = (uint32_t)channels;
+	levels.muted    = muted;
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		const float *data = (const float*)in->data[ch];
+
+		audio_level_scan(data, in->frames, &levels.peak[ch],
+				&sum_squares[ch]);
+		audio_level_true_peak(data, in->frames,
+				source->audio_true_peak_history[ch],
+				&levels.true_peak[ch]);
+
+		if (in->frames)
+			levels.rms[ch] = sqrtf(sum_squares[ch] /
+					(float)in->frames);
+	}
+
+	os_atomic_inc_long(&slot->seq);
+	for (size_t ch = 0; ch < channels; ch++) {
+		if (levels.peak[ch] > slot->peak[ch])
+			slot->peak[ch] = levels.peak[ch];
+		if (levels.true_peak[ch] > slot->true_peak[ch])
+			slot->true_peak[ch] = levels.true_peak[ch];
+		slot->sum_squares[ch] += sum_squares[ch];
+	}
+	slot->frames += in->frames;
+	slot->muted   = muted;
+	os_atomic_inc_long(&slot->seq);
+
+	source->audio_level_frames += in->frames;
+
+	pthread_mutex_lock(&source->audio_cb_mutex);
+
+	if (source->audio_levels_cb_list.num) {
+		for (size_t i = source->audio_levels_cb_list.num; i > 0; i--) {
+			struct audio_levels_cb_info info =
+				source->audio_levels_cb_list.array[i - 1];
+			info.callback(info.param, source, &levels);
+		}
+	}
+
+	pthread_mutex_unlock(&source->audio_cb_mutex);
+}
+
 static void source_output_audio_data(obs_source_t *source,
 		const struct audio_data *data)
 {
@@ -1149,6 +1273,7 @@ static void source_output_audio_data(obs_source_t *source,
 	int64_t sync_offset;
 	bool using_direct_ts = false;
 	bool push_back = false;
+	bool muted;
 
 	/* detects 'directly' set timestamps as long as they're within
 	 * a certain threshold */
@@ -1197,6 +1322,7 @@ static void source_output_audio_data(obs_source_t *source,
 		} else if (diff > MAX_TS_VAR) {
 			reset_audio_timing(source, data->timestamp,
 					os_time);
+			source->audio_ts_jumps++;
 			in.timestamp = data->timestamp + source->timing_adjust;
 		}
 	}
@@ -1221,7 +1347,9 @@ static void source_output_audio_data(obs_source_t *source,
 
 	pthread_mutex_unlock(&source->audio_buf_mutex);
 
-	source_signal_audio_data(source, &in, source_muted(source, os_time));
+	muted = source_muted(source, os_time);
+	meter_audio_data(source, &in, muted);
+	source_signal_audio_data(source, &in, muted);
 }
 
 enum convert_type {
@@ -2283,6 +2411,13 @@ static inline void reset_resampler(obs_source_t *source,
 	output_info.samples_per_sec  = obs_info->samples_per_sec;
 	output_info.speakers         = obs_info->speakers;
 
+	/* the first format a source outputs isn't a reset */
+	if (source->sample_info.samples_per_sec) {
+		pthread_mutex_lock(&source->audio_buf_mutex);
+		source->audio_resampler_resets++;
+		pthread_mutex_unlock(&source->audio_buf_mutex);
+	}
+
 	source->sample_info.format          = audio->format;
 	source->sample_info.samples_per_sec = audio->samples_per_sec;
 	source->sample_info.speakers        = audio->speakers;
@@ -2421,6 +2556,173 @@ void obs_source_output_audio(obs_source_t *source,
 	pthread_mutex_unlock(&source->filter_mutex);
 }
 
+/* realtime audio packets are stored back to back in the source's ring, each
+ * one a header followed by its planes.  a header with no frames means the
+ * writer wrapped around, as does less than a header of space at the end */
+struct rt_audio_packet {
+	uint64_t            timestamp;
+	uint32_t            frames;
+	uint32_t            size;
+	uint32_t            samples_per_sec;
+	uint32_t            plane_size;
+	enum audio_format   format;
+	enum speaker_layout speakers;
+};
+
+#define RT_AUDIO_ALIGN 16
+
+static inline size_t rt_audio_align(size_t size)
+{
+	return (size + RT_AUDIO_ALIGN - 1) & ~(size_t)(RT_AUDIO_ALIGN - 1);
+}
+
+void obs_source_reserve_audio_rt(obs_source_t *source, size_t frames,
+		enum audio_format format, enum speaker_layout speakers)
+{
+	size_t capacity;
+
+	if (!obs_source_valid(source, "obs_source_reserve_audio_rt"))
+		return;
+
+	/* twice the audio itself leaves room for headers and for space lost
+	 * at the end of the ring when wrapping around */
+	capacity = rt_audio_align(get_audio_size(format, speakers,
+				(uint32_t)frames) *
+			get_audio_planes(format, speakers) * 2);
+
+	pthread_mutex_lock(&source->rt_audio_mutex);
+
+	if (capacity > source->rt_audio_capacity) {
+		bfree(source->rt_audio_buf);
+		source->rt_audio_buf      = bmalloc(capacity);
+		source->rt_audio_capacity = capacity;
+		os_atomic_set_long(&source->rt_audio_read, 0);
+		os_atomic_set_long(&source->rt_audio_write, 0);
+	}
+
+	pthread_mutex_unlock(&source->rt_audio_mutex);
+}
+
+/* finds room for a packet of the given size, returning false if the reader
+ * hasn't freed up enough yet.  the write position is never allowed to catch
+ * up to the read position, as that would look like an empty ring */
+static inline bool rt_audio_find_space(obs_source_t *source, size_t size,
+		size_t *p_pos)
+{
+	size_t capacity = source->rt_audio_capacity;
+	size_t read_pos = (size_t)os_atomic_load_long(&source->rt_audio_read);
+	size_t write_pos = (size_t)source->rt_audio_write;
+	size_t tail = capacity - write_pos;
+
+	if (read_pos > write_pos) {
+		if (write_pos + size >= read_pos)
+			return false;
+
+	} else if (size > tail || (size == tail && read_pos == 0)) {
+		struct rt_audio_packet *padding;
+
+		if (size >= read_pos)
+			return false;
+
+		if (tail >= sizeof(struct rt_audio_packet)) {
+			padding = (void*)(source->rt_audio_buf + write_pos);
+			padding->frames = 0;
+		}
+
+		write_pos = 0;
+	}
+
+	*p_pos = write_pos;
+	return true;
+}
+
+bool obs_source_output_audio_rt(obs_source_t *source,
+		const struct obs_source_audio *audio)
+{
+	struct rt_audio_packet *packet;
+	size_t planes;
+	size_t plane_size;
+	size_t size;
+	size_t pos;
+	uint8_t *data;
+
+	if (!source || !audio || !source->rt_audio_buf || !audio->frames)
+		return false;
+
+	planes = get_audio_planes(audio->format, audio->speakers);
+	plane_size = get_audio_size(audio->format, audio->speakers,
+			audio->frames);
+	size = rt_audio_align(sizeof(*packet) + plane_size * planes);
+
+	if (!rt_audio_find_space(source, size, &pos)) {
+		os_atomic_inc_long(&source->rt_audio_dropped);
+		return false;
+	}
+
+	packet = (void*)(source->rt_audio_buf + pos);
+	packet->timestamp       = audio->timestamp;
+	packet->frames          = audio->frames;
+	packet->size            = (uint32_t)size;
+	packet->samples_per_sec = audio->samples_per_sec;
+	packet->plane_size      = (uint32_t)plane_size;
+	packet->format          = audio->format;
+	packet->speakers        = audio->speakers;
+
+	data = (uint8_t*)(packet + 1);
+	for (size_t i = 0; i < planes; i++)
+		memcpy(data + plane_size * i, audio->data[i], plane_size);
+
+	os_atomic_set_long(&source->rt_audio_write,
+			(long)((pos + size) % source->rt_audio_capacity));
+	return true;
+}
+
+void obs_source_flush_audio_rt(obs_source_t *source)
+{
+	size_t read_pos;
+	size_t write_pos;
+
+	pthread_mutex_lock(&source->rt_audio_mutex);
+
+	read_pos = (size_t)source->rt_audio_read;
+	write_pos = (size_t)os_atomic_load_long(&source->rt_audio_write);
+
+	while (source->rt_audio_buf && read_pos != write_pos) {
+		struct rt_audio_packet *packet;
+		struct obs_source_audio audio;
+		size_t tail = source->rt_audio_capacity - read_pos;
+		uint8_t *data;
+
+		packet = (void*)(source->rt_audio_buf + read_pos);
+		if (tail < sizeof(*packet) || !packet->frames) {
+			read_pos = 0;
+			continue;
+		}
+
+		memset(&audio, 0, sizeof(audio));
+		data = (uint8_t*)(packet + 1);
+
+		for (size_t i = 0;
+		     i < get_audio_planes(packet->format, packet->speakers);
+		     i++)
+			audio.data[i] = data + packet->plane_size * i;
+
+		audio.frames          = packet->frames;
+		audio.timestamp       = packet->timestamp;
+		audio.samples_per_sec = packet->samples_per_sec;
+		audio.format          = packet->format;
+		audio.speakers        = packet->speakers;
+
+		obs_source_output_audio(source, &audio);
+
+		read_pos = (read_pos + packet->size) %
+			source->rt_audio_capacity;
+		os_atomic_set_long(&source->rt_audio_read, (long)read_pos);
+	}
+
+	pthread_mutex_unlock(&source->rt_audio_mutex);
+}
+
 void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 {
 	if (frame)
@@ -2526,6 +2828,24 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 	return frame != NULL;
 }
 
+/* compares when a frame is shown with when audio of the same timestamp is
+ * mixed, which only means anything once the audio has set the timing */
+static inline void update_av_offset(obs_source_t *source,
+		const struct obs_source_frame *frame, uint64_t sys_time)
+{
+	uint64_t audio_time;
+
+	source->async_av_offset_valid =
+		(source->info.output_flags & OBS_SOURCE_AUDIO) != 0 &&
+		source->timing_set;
+	if (!source->async_av_offset_valid)
+		return;
+
+	audio_time = frame->timestamp + source->timing_adjust +
+		source->sync_offset;
+	source->async_av_offset = (int64_t)(sys_time - audio_time);
+}
+
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 		uint64_t sys_time)
 {
@@ -2539,6 +2859,8 @@ static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 		if (!source->last_frame_ts)
 			source->last_frame_ts = frame->timestamp;
 
+		update_av_offset(source, frame, sys_time);
+
 		return frame;
 	}
 
@@ -2609,6 +2931,9 @@ void obs_source_set_name(obs_source_t *source, const char *name)
 		char *prev_name = bstrdup(source->context.name);
 		obs_context_data_setname(&source->context, name);
 
+		if (source->audio_output_buf[0][0])
+			set_audio_render_name(source);
+
 		calldata_init(&data);
 		calldata_set_ptr(&data, "source", source);
 		calldata_set_string(&data, "new_name", source->context.name);
@@ -3013,6 +3338,7 @@ bool obs_source_add_active_child(obs_source_t *parent, obs_source_t *child)
 		obs_source_activate(child, type);
 	}
 
+	obs_audio_tree_changed();
 	return true;
 }
 
@@ -3028,6 +3354,8 @@ void obs_source_remove_active_child(obs_source_t *parent, obs_source_t *child)
 		type = (i < parent->activate_refs) ? MAIN_VIEW : AUX_VIEW;
 		obs_source_deactivate(child, type);
 	}
+
+	obs_audio_tree_changed();
 }
 
 void obs_source_save(obs_source_t *source)
@@ -3462,7 +3790,7 @@ void *obs_source_get_type_data(obs_source_t *source)
 		? source->info.type_data : NULL;
 }
 
-static float get_source_volume(obs_source_t *source, uint64_t os_time)
+static bool audio_muted(obs_source_t *source, uint64_t os_time)
 {
 	if (source->push_to_mute_enabled && source->push_to_mute_pressed)
 		source->push_to_mute_stop_time = os_time +
@@ -3477,11 +3805,15 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 	bool push_to_talk_active = source->push_to_talk_pressed ||
 		os_time < source->push_to_talk_stop_time;
 
-	bool muted = !source->enabled || source->muted ||
+	return !source->enabled || source->muted ||
 			(source->push_to_mute_enabled && push_to_mute_active) ||
 			(source->push_to_talk_enabled && !push_to_talk_active);
+}
 
-	if (muted || close_float(source->volume, 0.0f, 0.0001f))
+static float get_source_volume(obs_source_t *source, uint64_t os_time)
+{
+	if (audio_muted(source, os_time) ||
+	    close_float(source->volume, 0.0f, 0.0001f))
 		return 0.0f;
 	if (close_float(source->volume, 1.0f, 0.0001f))
 		return 1.0f;
@@ -3489,27 +3821,36 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 	return source->volume;
 }
 
+/* clears the output of the given mixes, mixes that aren't active are never
+ * read so they don't have to be cleared */
+static inline void clear_audio_output(obs_source_t *source, uint32_t mixers,
+		size_t channels)
+{
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((mixers & (1 << mix)) == 0)
+			continue;
+
+		for (size_t ch = 0; ch < channels; ch++)
+			memset(source->audio_output_buf[mix][ch], 0,
+					obs->audio.block_frames *
+					sizeof(float));
+	}
+}
+
 static inline void multiply_output_audio(obs_source_t *source, size_t mix,
 		size_t channels, float vol)
 {
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
-
-	while (out < end)
-		*(out++) *= vol;
+	for (size_t ch = 0; ch < channels; ch++)
+		audio_mix_scale(source->audio_output_buf[mix][ch], vol,
+				obs->audio.block_frames);
 }
 
 static inline void multiply_vol_data(obs_source_t *source, size_t mix,
 		size_t channels, float *vol_data)
 {
-	for (size_t ch = 0; ch < channels; ch++) {
-		register float *out = source->audio_output_buf[mix][ch];
-		register float *end = out + AUDIO_OUTPUT_FRAMES;
-		register float *vol = vol_data;
-
-		while (out < end)
-			*(out++) *= *(vol++);
-	}
+	for (size_t ch = 0; ch < channels; ch++)
+		audio_mix_scale_buf(source->audio_output_buf[mix][ch],
+				vol_data, obs->audio.block_frames);
 }
 
 static inline void apply_audio_action(obs_source_t *source,
@@ -3527,10 +3868,11 @@ static inline void apply_audio_action(obs_source_t *source,
 	}
 }
 
-static void apply_audio_actions(obs_source_t *source, size_t channels,
-		size_t sample_rate)
+static void apply_audio_actions(obs_source_t *source, uint32_t mixers,
+		size_t channels, size_t sample_rate)
 {
-	float *vol_data = malloc(sizeof(float) * AUDIO_OUTPUT_FRAMES);
+	size_t frames = obs->audio.block_frames;
+	float *vol_data = malloc(sizeof(float) * frames);
 	float cur_vol = get_source_volume(source, source->audio_ts);
 	size_t frame_num = 0;
 
@@ -3547,7 +3889,7 @@ static void apply_audio_actions(obs_source_t *source, size_t channels,
 		new_frame_num = conv_time_to_frames(sample_rate,
 				timestamp - source->audio_ts);
 
-		if (new_frame_num >= AUDIO_OUTPUT_FRAMES)
+		if (new_frame_num >= frames)
 			break;
 
 		da_erase(source->audio_actions, i--);
@@ -3562,13 +3904,15 @@ static void apply_audio_actions(obs_source_t *source, size_t channels,
 		cur_vol = get_source_volume(source, timestamp);
 	}
 
-	for (; frame_num < AUDIO_OUTPUT_FRAMES; frame_num++)
+	for (; frame_num < frames; frame_num++)
 		vol_data[frame_num] = cur_vol;
 
 	pthread_mutex_unlock(&source->audio_actions_mutex);
 
+	mixers &= source->audio_mixers;
+
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		if ((source->audio_mixers & (1 << mix)) != 0)
+		if ((mixers & (1 << mix)) != 0)
 			multiply_vol_data(source, mix, channels, vol_data);
 	}
 
@@ -3592,10 +3936,11 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 
 	if (actions_pending) {
 		uint64_t duration = conv_frames_to_time(sample_rate,
-				AUDIO_OUTPUT_FRAMES);
+				obs->audio.block_frames);
 
 		if (action.timestamp < (source->audio_ts + duration)) {
-			apply_audio_actions(source, channels, sample_rate);
+			apply_audio_actions(source, mixers, channels,
+					sample_rate);
 			return;
 		}
 	}
@@ -3604,10 +3949,8 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 	if (vol == 1.0f)
 		return;
 
-	if (vol == 0.0f || mixers == 0) {
-		memset(source->audio_output_buf[0][0], 0,
-				AUDIO_OUTPUT_FRAMES * sizeof(float) *
-				MAX_AUDIO_CHANNELS * MAX_AUDIO_MIXES);
+	if (vol == 0.0f) {
+		clear_audio_output(source, mixers, channels);
 		return;
 	}
 
@@ -3632,8 +3975,7 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 				source->audio_output_buf[mix][ch];
 	}
 
-	memset(audio_data.output[0].data[0], 0, AUDIO_OUTPUT_FRAMES *
-			MAX_AUDIO_MIXES * channels * sizeof(float));
+	clear_audio_output(source, mixers, channels);
 
 	success = source->info.audio_render(source->context.data, &ts,
 			&audio_data, mixers, channels, sample_rate);
@@ -3643,15 +3985,7 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 	if (!success || !source->audio_ts || !mixers)
 		return;
 
-	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		if ((source->audio_mixers & (1 << mix)) == 0) {
-			memset(source->audio_output_buf[mix][0], 0,
-					sizeof(float) * AUDIO_OUTPUT_FRAMES *
-					channels);
-			continue;
-		}
-	}
-
+	clear_audio_output(source, mixers & ~source->audio_mixers, channels);
 	apply_audio_volume(source, mixers, channels, sample_rate);
 }
 
@@ -3674,13 +4008,17 @@ static inline void process_audio_source_tick(obs_source_t *source,
 
 	pthread_mutex_unlock(&source->audio_buf_mutex);
 
+	/* mixes nobody is using are left as they are */
 	for (size_t mix = 1; mix < MAX_AUDIO_MIXES; mix++) {
 		uint32_t mix_and_val = (1 << mix);
 
-		if ((source->audio_mixers & mix_and_val) == 0 ||
-		    (mixers & mix_and_val) == 0) {
-			memset(source->audio_output_buf[mix][0],
-					0, size * channels);
+		if ((mixers & mix_and_val) == 0)
+			continue;
+
+		if ((source->audio_mixers & mix_and_val) == 0) {
+			for (size_t ch = 0; ch < channels; ch++)
+				memset(source->audio_output_buf[mix][ch],
+						0, size);
 			continue;
 		}
 
@@ -3689,9 +4027,10 @@ static inline void process_audio_source_tick(obs_source_t *source,
 					source->audio_output_buf[0][ch], size);
 	}
 
-	if ((source->audio_mixers & 1) == 0 || (mixers & 1) == 0)
-		memset(source->audio_output_buf[0][0], 0,
-				size * channels);
+	if ((source->audio_mixers & 1) == 0 && (mixers & 1) != 0) {
+		for (size_t ch = 0; ch < channels; ch++)
+			memset(source->audio_output_buf[0][ch], 0, size);
+	}
 
 	apply_audio_volume(source, mixers, channels, sample_rate);
 	source->audio_pending = false;
@@ -3749,6 +4088,146 @@ void obs_source_get_audio_mix(const obs_source_t *source,
 	}
 }
 
+/* copies a finished slot, returns false if it has been reused for a newer
+ * slot since, in which case it's older than the history anyway */
+static inline bool read_audio_level_slot(const obs_source_t *source,
+		uint64_t slot_num, struct audio_level_slot *copy)
+{
+	const struct audio_level_slot *slot =
+		&source->audio_levels[slot_num % AUDIO_LEVEL_HISTORY];
+	long seq = os_atomic_load_long(&slot->seq);
+
+	if ((seq & 1) != 0)
+		return false;
+
+	memcpy(copy, (const void*)slot, sizeof(*copy));
+
+	return os_atomic_load_long(&slot->seq) == seq &&
+		copy->slot == slot_num;
+}
+
+bool obs_source_get_audio_levels(const obs_source_t *source,
+		uint64_t since, struct obs_audio_levels *levels)
+{
+	float sum_squares[MAX_AUDIO_CHANNELS] = {0};
+	struct audio_level_slot slot;
+	size_t channels;
+	uint64_t ticks;
+	uint64_t first;
+	long cur;
+
+	if (!obs_source_valid(source, "obs_source_get_audio_levels"))
+		return false;
+	if (!obs_ptr_valid(levels, "obs_source_get_audio_levels"))
+		return false;
+
+	channels = audio_output_get_channels(obs->audio.audio);
+	cur = os_atomic_load_long(&source->audio_level_cur);
+	ticks = source->audio_levels[cur].slot;
+
+	memset(levels, 0, sizeof(*levels));
+	levels->ticks    = ticks;
+	levels->channels = (uint32_t)channels;
+
+	if (!ticks || since >= ticks)
+		return false;
+
+	/* the slot being filled takes up one entry of the history */
+	if (!since)
+		first = ticks - 1;
+	else if (ticks - since >= AUDIO_LEVEL_HISTORY)
+		first = ticks - (AUDIO_LEVEL_HISTORY - 1);
+	else
+		first = since;
+
+	for (uint64_t i = first; i < ticks; i++) {
+		if (!read_audio_level_slot(source, i, &slot))
+			continue;
+
+		for (size_t ch = 0; ch < channels; ch++) {
+			if (slot.peak[ch] > levels->peak[ch])
+				levels->peak[ch] = slot.peak[ch];
+			if (slot.true_peak[ch] > levels->true_peak[ch])
+				levels->true_peak[ch] = slot.true_peak[ch];
+			sum_squares[ch] += slot.sum_squares[ch];
+		}
+
+		if (slot.frames) {
+			levels->frames += slot.frames;
+			levels->muted   = slot.muted;
+		}
+	}
+
+	if (levels->frames) {
+		for (size_t ch = 0; ch < channels; ch++)
+			levels->rms[ch] = sqrtf(sum_squares[ch] /
+					(float)levels->frames);
+	}
+
+	return true;
+}
+
+void obs_source_add_audio_levels_callback(obs_source_t *source,
+		obs_source_audio_levels_t callback, void *param)
+{
+	struct audio_levels_cb_info info = {callback, param};
+
+	if (!obs_source_valid(source, "obs_source_add_audio_levels_callback"))
+		return;
+
+	pthread_mutex_lock(&source->audio_cb_mutex);
+	da_push_back(source->audio_levels_cb_list, &info);
+	pthread_mutex_unlock(&source->audio_cb_mutex);
+}
+
+void obs_source_remove_audio_levels_callback(obs_source_t *source,
+		obs_source_audio_levels_t callback, void *param)
+{
+	struct audio_levels_cb_info info = {callback, param};
+
+	if (!obs_source_valid(source,
+				"obs_source_remove_audio_levels_callback"))
+		return;
+
+	pthread_mutex_lock(&source->audio_cb_mutex);
+	da_erase_item(source->audio_levels_cb_list, &info);
+	pthread_mutex_unlock(&source->audio_cb_mutex);
+}
+
+bool obs_source_get_audio_stats(const obs_source_t *source,
+		struct obs_source_audio_stats *stats)
+{
+	obs_source_t *s = (obs_source_t*)source;
+	uint32_t sample_rate;
+	size_t frames;
+
+	if (!obs_source_valid(source, "obs_source_get_audio_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_source_get_audio_stats"))
+		return false;
+
+	memset(stats, 0, sizeof(*stats));
+	sample_rate = audio_output_get_sample_rate(obs->audio.audio);
+
+	pthread_mutex_lock(&s->audio_buf_mutex);
+	frames = s->audio_input_buf[0].size / sizeof(float);
+	stats->ts_jumps         = s->audio_ts_jumps;
+	stats->discarded_frames = s->audio_discarded_frames;
+	stats->resampler_resets = s->audio_resampler_resets;
+	pthread_mutex_unlock(&s->audio_buf_mutex);
+
+	if (sample_rate)
+		stats->buffered_ms = (uint32_t)((uint64_t)frames * 1000 /
+				sample_rate);
+
+	pthread_mutex_lock(&s->async_mutex);
+	stats->av_offset       = s->async_av_offset;
+	stats->av_offset_valid = s->async_av_offset_valid;
+	pthread_mutex_unlock(&s->async_mutex);
+
+	return true;
+}
+
 void obs_source_add_audio_capture_callback(obs_source_t *source,
 		obs_source_audio_capture_t callback, void *param)
 {
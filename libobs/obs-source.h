@@ -115,6 +115,17 @@ enum obs_source_type {
  */
 #define OBS_SOURCE_DO_NOT_DUPLICATE (1<<7)
 
+/**
+ * Source ticks without the graphics subsystem
+ *
+ * When this is used, specifies that the video_tick callback doesn't use the
+ * graphics subsystem and doesn't depend on the ticks of other sources.  The
+ * callback may then be called from a worker thread, in parallel with the
+ * ticks of other sources with this flag, after all other sources have been
+ * ticked on the graphics thread.
+ */
+#define OBS_SOURCE_THREADED_TICK (1<<8)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -21,12 +21,52 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 
+struct threaded_tick_data {
+	struct obs_source **sources;
+	float             seconds;
+};
+
+static void threaded_tick_task(void *param, size_t idx)
+{
+	struct threaded_tick_data *tick = param;
+	struct obs_source *source = tick->sources[idx];
+
+	source->info.video_tick(source->context.data, tick->seconds);
+}
+
+static inline bool tick_on_worker(struct obs_source *source)
+{
+	return (source->info.output_flags & OBS_SOURCE_THREADED_TICK) != 0 &&
+		source->context.data && source->info.video_tick;
+}
+
+static const char *threaded_ticks_name = "threaded_ticks";
+
+/* ticks of sources with OBS_SOURCE_THREADED_TICK are deferred until every
+ * other source has ticked, and then run on the tick pool.  sources_mutex
+ * stays locked until they finish so the sources can't be destroyed */
+static void run_threaded_ticks(struct obs_core_video *video, float seconds)
+{
+	struct threaded_tick_data tick = {video->threaded_ticks.array, seconds};
+
+	if (!video->threaded_ticks.num)
+		return;
+
+	profile_start(threaded_ticks_name);
+	task_pool_run(video->tick_pool, threaded_tick_task, &tick,
+			video->threaded_ticks.num);
+	profile_end(threaded_ticks_name);
+
+	da_resize(video->threaded_ticks, 0);
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
-	struct obs_core_data *data = &obs->data;
-	struct obs_source    *source;
-	uint64_t             delta_time;
-	float                seconds;
+	struct obs_core_data  *data = &obs->data;
+	struct obs_core_video *video = &obs->video;
+	struct obs_source     *source;
+	uint64_t              delta_time;
+	float                 seconds;
 
 	if (!last_time)
 		last_time = cur_time -
@@ -40,10 +80,18 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	/* call the tick function of each source */
 	source = data->first_source;
 	while (source) {
-		obs_source_video_tick(source, seconds);
+		if (video->tick_pool && tick_on_worker(source)) {
+			obs_source_prepare_video_tick(source);
+			da_push_back(video->threaded_ticks, &source);
+		} else {
+			obs_source_video_tick(source, seconds);
+		}
+
 		source = (struct obs_source*)source->context.next;
 	}
 
+	run_threaded_ticks(video, seconds);
+
 	pthread_mutex_unlock(&data->sources_mutex);
 
 	return cur_time;
@@ -52,9 +100,33 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 /* in obs-display.c */
 extern void render_display(struct obs_display *display);
 
+/* displays are refreshed on their own cadence, which is rounded to the
+ * nearest output frame.  half a frame of leeway keeps timing jitter from
+ * pushing a display back by a whole frame */
+static inline bool display_refresh_due(struct obs_display *display,
+		uint64_t cur_time, uint64_t frame_time)
+{
+	uint64_t interval = display->refresh_interval;
+
+	if (!display->enabled || !display->visible)
+		return false;
+	if (interval <= frame_time)
+		return true;
+	if (cur_time + frame_time / 2 < display->next_render_time)
+		return false;
+
+	display->next_render_time += interval;
+	if (display->next_render_time + frame_time / 2 < cur_time)
+		display->next_render_time = cur_time + interval;
+	return true;
+}
+
+static const char *render_display_name = "render_display";
 static inline void render_displays(void)
 {
 	struct obs_display *display;
+	uint64_t cur_time   = obs->video.video_time;
+	uint64_t frame_time = video_output_get_frame_time(obs->video.video);
 
 	if (!obs->data.valid)
 		return;
@@ -66,7 +138,12 @@ static inline void render_displays(void)
 
 	display = obs->data.first_display;
 	while (display) {
-		render_display(display);
+		if (display_refresh_due(display, cur_time, frame_time)) {
+			profile_start(render_display_name);
+			render_display(display);
+			profile_end(render_display_name);
+		}
+
 		display = display->next;
 	}
 
@@ -84,11 +161,11 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
-static inline void unmap_last_surface(struct obs_core_video *video)
+static inline void unmap_last_surface(struct obs_video_target *target)
 {
-	if (video->mapped_surface) {
-		gs_stagesurface_unmap(video->mapped_surface);
-		video->mapped_surface = NULL;
+	if (target->mapped_surface) {
+		gs_stagesurface_unmap(target->mapped_surface);
+		target->mapped_surface = NULL;
 	}
 }
 
@@ -113,13 +190,13 @@ static inline void render_main_texture(struct obs_core_video *video,
 }
 
 static inline gs_effect_t *get_scale_effect_internal(
-		struct obs_core_video *video)
+		struct obs_core_video *video, uint32_t width, uint32_t height)
 {
 	/* if the dimension is under half the size of the original image,
 	 * bicubic/lanczos can't sample enough pixels to create an accurate
 	 * image, so use the bilinear low resolution effect instead */
-	if (video->output_width  < (video->base_width  / 2) &&
-	    video->output_height < (video->base_height / 2)) {
+	if (width  < (video->base_width  / 2) &&
+	    height < (video->base_height / 2)) {
 		return video->bilinear_lowres_effect;
 	}
 
@@ -150,7 +227,8 @@ static inline gs_effect_t *get_scale_effect(struct obs_core_video *video,
 	} else {
 		/* if the scale method couldn't be loaded, use either bicubic
 		 * or bilinear by default */
-		gs_effect_t *effect = get_scale_effect_internal(video);
+		gs_effect_t *effect = get_scale_effect_internal(video,
+				width, height);
 		if (!effect)
 			effect = !!video->bicubic_effect ?
 				video->bicubic_effect :
@@ -161,12 +239,13 @@ static inline gs_effect_t *get_scale_effect(struct obs_core_video *video,
 
 static const char *render_output_texture_name = "render_output_texture";
 static inline void render_output_texture(struct obs_core_video *video,
-		int cur_texture, int prev_texture)
+		struct obs_video_target *output, int cur_texture,
+		int prev_texture)
 {
 	profile_start(render_output_texture_name);
 
 	gs_texture_t *texture = video->render_textures[prev_texture];
-	gs_texture_t *target  = video->output_textures[cur_texture];
+	gs_texture_t *target  = output->output_textures[cur_texture];
 	uint32_t     width   = gs_texture_get_width(target);
 	uint32_t     height  = gs_texture_get_height(target);
 	struct vec2  base_i;
@@ -206,7 +285,7 @@ static inline void render_output_texture(struct obs_core_video *video,
 	gs_technique_end(tech);
 	gs_enable_blending(true);
 
-	video->textures_output[cur_texture] = true;
+	output->textures_output[cur_texture] = true;
 
 end:
 	profile_end(render_output_texture_name);
@@ -220,26 +299,27 @@ static inline void set_eparam(gs_effect_t *effect, const char *name, float val)
 
 static const char *render_convert_texture_name = "render_convert_texture";
 static void render_convert_texture(struct obs_core_video *video,
-		int cur_texture, int prev_texture)
+		struct obs_video_target *output, int cur_texture,
+		int prev_texture)
 {
 	profile_start(render_convert_texture_name);
 
-	gs_texture_t *texture = video->output_textures[prev_texture];
-	gs_texture_t *target  = video->convert_textures[cur_texture];
-	float        fwidth  = (float)video->output_width;
-	float        fheight = (float)video->output_height;
+	gs_texture_t *texture = output->output_textures[prev_texture];
+	gs_texture_t *target  = output->convert_textures[cur_texture];
+	float        fwidth  = (float)output->width;
+	float        fheight = (float)output->height;
 	size_t       passes, i;
 
 	gs_effect_t    *effect  = video->conversion_effect;
 	gs_eparam_t    *image   = gs_effect_get_param_by_name(effect, "image");
 	gs_technique_t *tech    = gs_effect_get_technique(effect,
-			video->conversion_tech);
+			output->conversion_tech);
 
-	if (!video->textures_output[prev_texture])
+	if (!output->textures_output[prev_texture])
 		goto end;
 
-	set_eparam(effect, "u_plane_offset", (float)video->plane_offsets[1]);
-	set_eparam(effect, "v_plane_offset", (float)video->plane_offsets[2]);
+	set_eparam(effect, "u_plane_offset", (float)output->plane_offsets[1]);
+	set_eparam(effect, "v_plane_offset", (float)output->plane_offsets[2]);
 	set_eparam(effect, "width",  fwidth);
 	set_eparam(effect, "height", fheight);
 	set_eparam(effect, "width_i",  1.0f / fwidth);
@@ -248,61 +328,74 @@ static void render_convert_texture(struct obs_core_video *video,
 	set_eparam(effect, "height_d2", fheight * 0.5f);
 	set_eparam(effect, "width_d2_i",  1.0f / (fwidth  * 0.5f));
 	set_eparam(effect, "height_d2_i", 1.0f / (fheight * 0.5f));
-	set_eparam(effect, "input_height", (float)video->conversion_height);
+	set_eparam(effect, "input_height", (float)output->conversion_height);
 
 	gs_effect_set_texture(image, texture);
 
 	gs_set_render_target(target, NULL);
-	set_render_size(video->output_width, video->conversion_height);
+	set_render_size(output->width, output->conversion_height);
 
 	gs_enable_blending(false);
 	passes = gs_technique_begin(tech);
 	for (i = 0; i < passes; i++) {
 		gs_technique_begin_pass(tech, i);
-		gs_draw_sprite(texture, 0, video->output_width,
-				video->conversion_height);
+		gs_draw_sprite(texture, 0, output->width,
+				output->conversion_height);
 		gs_technique_end_pass(tech);
 	}
 	gs_technique_end(tech);
 	gs_enable_blending(true);
 
-	video->textures_converted[cur_texture] = true;
+	output->textures_converted[cur_texture] = true;
 
 end:
 	profile_end(render_convert_texture_name);
 }
 
 static const char *stage_output_texture_name = "stage_output_texture";
-static inline void stage_output_texture(struct obs_core_video *video,
+static inline void stage_output_texture(struct obs_video_target *output,
 		int cur_texture, int prev_texture)
 {
 	profile_start(stage_output_texture_name);
 
 	gs_texture_t   *texture;
 	bool        texture_ready;
-	gs_stagesurf_t *copy = video->copy_surfaces[cur_texture];
+	gs_stagesurf_t *copy = output->copy_surfaces[cur_texture];
 
-	if (video->gpu_conversion) {
-		texture = video->convert_textures[prev_texture];
-		texture_ready = video->textures_converted[prev_texture];
+	if (output->gpu_conversion) {
+		texture = output->convert_textures[prev_texture];
+		texture_ready = output->textures_converted[prev_texture];
 	} else {
-		texture = video->output_textures[prev_texture];
-		texture_ready = video->output_textures[prev_texture];
+		texture = output->output_textures[prev_texture];
+		texture_ready = output->textures_output[prev_texture];
 	}
 
-	unmap_last_surface(video);
+	unmap_last_surface(output);
 
 	if (!texture_ready)
 		goto end;
 
 	gs_stage_texture(copy, texture);
 
-	video->textures_copied[cur_texture] = true;
+	output->textures_copied[cur_texture] = true;
 
 end:
 	profile_end(stage_output_texture_name);
 }
 
+static inline void render_video_target(struct obs_core_video *video,
+		struct obs_video_target *output, int cur_texture,
+		int prev_texture)
+{
+	render_output_texture(video, output, cur_texture, prev_texture);
+	if (output->gpu_conversion)
+		render_convert_texture(video, output, cur_texture,
+				prev_texture);
+
+	stage_output_texture(output, cur_texture, prev_texture);
+}
+
+/* call with scaled_targets_mutex locked */
 static inline void render_video(struct obs_core_video *video, int cur_texture,
 		int prev_texture)
 {
@@ -312,11 +405,12 @@ static inline void render_video(struct obs_core_video *video, int cur_texture,
 	gs_set_cull_mode(GS_NEITHER);
 
 	render_main_texture(video, cur_texture);
-	render_output_texture(video, cur_texture, prev_texture);
-	if (video->gpu_conversion)
-		render_convert_texture(video, cur_texture, prev_texture);
+	render_video_target(video, &video->main_target, cur_texture,
+			prev_texture);
 
-	stage_output_texture(video, cur_texture, prev_texture);
+	for (size_t i = 0; i < video->scaled_targets.num; i++)
+		render_video_target(video, video->scaled_targets.array[i],
+				cur_texture, prev_texture);
 
 	gs_set_render_target(NULL, NULL);
 	gs_enable_blending(true);
@@ -324,21 +418,76 @@ static inline void render_video(struct obs_core_video *video, int cur_texture,
 	gs_end_scene();
 }
 
-static inline bool download_frame(struct obs_core_video *video,
-		int prev_texture, struct video_data *frame)
+/* with a ring deeper than the default, if the oldest copy still hasn't
+ * finished, its frame is dropped rather than stalling the graphics thread,
+ * and the next frame is output in its place */
+static inline void skip_unready_frame(struct obs_core_video *video)
 {
-	gs_stagesurf_t *surface = video->copy_surfaces[prev_texture];
+	struct obs_vframe_info skipped;
+	struct obs_vframe_info next;
 
-	if (!video->textures_copied[prev_texture])
-		return false;
+	circlebuf_pop_front(&video->vframe_info_buffer, &skipped,
+			sizeof(skipped));
+
+	video->lagged_frames += skipped.count;
+
+	if (video->vframe_info_buffer.size < sizeof(next))
+		return;
+
+	circlebuf_pop_front(&video->vframe_info_buffer, &next, sizeof(next));
+	next.timestamp = skipped.timestamp;
+	next.count += skipped.count;
+	circlebuf_push_front(&video->vframe_info_buffer, &next, sizeof(next));
+}
+
+static inline bool map_target_frame(struct obs_video_target *output,
+		int oldest_texture, struct video_data *frame)
+{
+	gs_stagesurf_t *surface = output->copy_surfaces[oldest_texture];
 
 	if (!gs_stagesurface_map(surface, &frame->data[0], &frame->linesize[0]))
 		return false;
 
-	video->mapped_surface = surface;
+	output->mapped_surface = surface;
 	return true;
 }
 
+static inline bool download_frame(struct obs_core_video *video,
+		int oldest_texture, struct video_data *frame)
+{
+	struct obs_video_target *output = &video->main_target;
+	gs_stagesurf_t *surface = output->copy_surfaces[oldest_texture];
+
+	if (!output->textures_copied[oldest_texture])
+		return false;
+
+	/* at the default depth, wait on the map like before so that no frames
+	 * are dropped */
+	if (video->num_textures > NUM_TEXTURES &&
+	    !gs_stagesurface_ready(surface)) {
+		skip_unready_frame(video);
+		return false;
+	}
+
+	return map_target_frame(output, oldest_texture, frame);
+}
+
+/* scaled copies are staged in the same frame as the main copy, so they're
+ * mapped whenever the main frame is ready to keep their frames in step with
+ * it.  call with scaled_targets_mutex locked */
+static inline void download_scaled_frames(struct obs_core_video *video,
+		int oldest_texture)
+{
+	for (size_t i = 0; i < video->scaled_targets.num; i++) {
+		struct obs_video_target *output = video->scaled_targets.array[i];
+
+		memset(&output->frame, 0, sizeof(output->frame));
+		output->frame_ready = output->textures_copied[oldest_texture] &&
+			map_target_frame(output, oldest_texture,
+					&output->frame);
+	}
+}
+
 static inline uint32_t calc_linesize(uint32_t pos, uint32_t linesize)
 {
 	uint32_t size = pos % linesize;
@@ -376,7 +525,7 @@ static inline uint32_t make_aligned_linesize_offset(uint32_t offset,
 	return (offset / dst_linesize) * src_linesize + remainder;
 }
 
-static void fix_gpu_converted_alignment(struct obs_core_video *video,
+static void fix_gpu_converted_alignment(struct obs_video_target *target,
 		struct video_frame *output, const struct video_data *input)
 {
 	uint32_t src_linesize = input->linesize[0];
@@ -384,65 +533,122 @@ static void fix_gpu_converted_alignment(struct obs_core_video *video,
 	uint32_t src_pos      = 0;
 
 	for (size_t i = 0; i < 3; i++) {
-		if (video->plane_linewidth[i] == 0)
+		if (target->plane_linewidth[i] == 0)
 			break;
 
-		src_pos = make_aligned_linesize_offset(video->plane_offsets[i],
+		src_pos = make_aligned_linesize_offset(target->plane_offsets[i],
 				dst_linesize, src_linesize);
 
 		copy_dealign(output->data[i], 0, dst_linesize,
 				input->data[0], src_pos, src_linesize,
-				video->plane_sizes[i]);
+				target->plane_sizes[i]);
 	}
 }
 
-static void set_gpu_converted_data(struct obs_core_video *video,
+static void set_gpu_converted_data(struct obs_video_target *target,
 		struct video_frame *output, const struct video_data *input,
 		const struct video_output_info *info)
 {
-	if (input->linesize[0] == video->output_width*4) {
+	if (input->linesize[0] == target->width*4) {
 		struct video_frame frame;
 
 		for (size_t i = 0; i < 3; i++) {
-			if (video->plane_linewidth[i] == 0)
+			if (target->plane_linewidth[i] == 0)
 				break;
 
-			frame.linesize[i] = video->plane_linewidth[i];
+			frame.linesize[i] = target->plane_linewidth[i];
 			frame.data[i] =
-				input->data[0] + video->plane_offsets[i];
+				input->data[0] + target->plane_offsets[i];
 		}
 
 		video_frame_copy(output, &frame, info->format, info->height);
 
 	} else {
-		fix_gpu_converted_alignment(video, output, input);
+		fix_gpu_converted_alignment(target, output, input);
 	}
 }
 
-static void convert_frame(
-		struct video_frame *output, const struct video_data *input,
-		const struct video_output_info *info)
+struct convert_band_data {
+	struct obs_core_video           *video;
+	struct video_frame              *output;
+	const struct video_data         *input;
+	const struct video_output_info  *info;
+	uint32_t                        band_height;
+	uint64_t                        band_start[MAX_CONVERT_BANDS];
+	uint64_t                        band_end[MAX_CONVERT_BANDS];
+};
+
+static void convert_frame_band(void *param, size_t band)
 {
+	struct convert_band_data       *data   = param;
+	struct video_frame             *output = data->output;
+	const struct video_data        *input  = data->input;
+	const struct video_output_info *info   = data->info;
+	uint32_t start_y = (uint32_t)band * data->band_height;
+	uint32_t end_y   = start_y + data->band_height;
+
+	if (end_y > info->height)
+		end_y = info->height;
+	if (start_y >= end_y)
+		return;
+
+	data->band_start[band] = os_gettime_ns();
+
 	if (info->format == VIDEO_FORMAT_I420) {
 		compress_uyvx_to_i420(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
 
 	} else if (info->format == VIDEO_FORMAT_NV12) {
 		compress_uyvx_to_nv12(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
 
 	} else if (info->format == VIDEO_FORMAT_I444) {
 		convert_uyvx_to_i444(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
+	}
 
-	} else {
+	data->band_end[band] = os_gettime_ns();
+}
+
+/* splits the frame in to bands of rows and converts them in parallel.  band
+ * heights are kept to multiples of two because the 4:2:0 conversions process
+ * two rows at a time.  bands are timed where they run, and added to the
+ * profiler here so that they all appear under the graphics thread's call */
+static void convert_frame(struct obs_core_video *video,
+		struct video_frame *output, const struct video_data *input,
+		const struct video_output_info *info)
+{
+	struct convert_band_data data;
+	size_t bands = video->convert_bands;
+
+	if (info->format != VIDEO_FORMAT_I420 &&
+	    info->format != VIDEO_FORMAT_NV12 &&
+	    info->format != VIDEO_FORMAT_I444) {
 		blog(LOG_ERROR, "convert_frame: unsupported texture format");
+		return;
+	}
+
+	data.video       = video;
+	data.output      = output;
+	data.input       = input;
+	data.info        = info;
+	data.band_height = (info->height + (uint32_t)bands - 1) /
+		(uint32_t)bands;
+	data.band_height = (data.band_height + 1) & ~1;
+	memset(data.band_start, 0, sizeof(data.band_start));
+
+	task_pool_run(video->convert_pool, convert_frame_band, &data, bands);
+
+	for (size_t i = 0; i < bands; i++) {
+		if (data.band_start[i])
+			profile_add_call(video->convert_band_names[i],
+					data.band_start[i], data.band_end[i]);
 	}
 }
 
@@ -466,46 +672,52 @@ static inline void copy_rgbx_frame(
 }
 
 static inline void output_video_data(struct obs_core_video *video,
-		struct video_data *input_frame, int count)
+		struct obs_video_target *output, struct video_data *input_frame,
+		int count)
 {
 	const struct video_output_info *info;
 	struct video_frame output_frame;
 	bool locked;
 
-	info = video_output_get_info(video->video);
+	info = video_output_get_info(output->video);
 
-	locked = video_output_lock_frame(video->video, &output_frame, count,
+	locked = video_output_lock_frame(output->video, &output_frame, count,
 			input_frame->timestamp);
 	if (locked) {
-		if (video->gpu_conversion) {
-			set_gpu_converted_data(video, &output_frame,
+		if (output->gpu_conversion) {
+			set_gpu_converted_data(output, &output_frame,
 					input_frame, info);
 
 		} else if (format_is_yuv(info->format)) {
-			convert_frame(&output_frame, input_frame, info);
+			convert_frame(video, &output_frame, input_frame, info);
 		} else {
 			copy_rgbx_frame(&output_frame, input_frame, info);
 		}
 
-		video_output_unlock_frame(video->video);
+		video_output_unlock_frame(output->video);
+	}
+}
+
+/* call with scaled_targets_mutex locked */
+static inline void output_scaled_video_data(struct obs_core_video *video,
+		uint64_t timestamp, int count)
+{
+	for (size_t i = 0; i < video->scaled_targets.num; i++) {
+		struct obs_video_target *output = video->scaled_targets.array[i];
+
+		if (output->frame_ready) {
+			output->frame.timestamp = timestamp;
+			output_video_data(video, output, &output->frame, count);
+		}
 	}
 }
 
 static inline void video_sleep(struct obs_core_video *video,
-		uint64_t *p_time, uint64_t interval_ns)
+		uint64_t *p_time)
 {
 	struct obs_vframe_info vframe_info;
 	uint64_t cur_time = *p_time;
-	uint64_t t = cur_time + interval_ns;
-	int count;
-
-	if (os_sleepto_ns(t)) {
-		*p_time = t;
-		count = 1;
-	} else {
-		count = (int)((os_gettime_ns() - cur_time) / interval_ns);
-		*p_time = cur_time + interval_ns * count;
-	}
+	int count = frame_clock_wait(video->frame_clock, p_time);
 
 	video->total_frames += count;
 	video->lagged_frames += count - 1;
@@ -525,7 +737,9 @@ static inline void output_frame(void)
 {
 	struct obs_core_video *video = &obs->video;
 	int cur_texture  = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES-1 : cur_texture-1;
+	int prev_texture = cur_texture == 0 ?
+		video->num_textures-1 : cur_texture-1;
+	int oldest_texture = (cur_texture + 1) % video->num_textures;
 	struct video_data frame;
 	bool frame_ready;
 
@@ -534,12 +748,18 @@ static inline void output_frame(void)
 	profile_start(output_frame_gs_context_name);
 	gs_enter_context(video->graphics);
 
+	/* held until the scaled frames have been output, so that scaled
+	 * targets can't be released while they're mapped */
+	pthread_mutex_lock(&video->scaled_targets_mutex);
+
 	profile_start(output_frame_render_video_name);
 	render_video(video, cur_texture, prev_texture);
 	profile_end(output_frame_render_video_name);
 
 	profile_start(output_frame_download_frame_name);
-	frame_ready = download_frame(video, prev_texture, &frame);
+	frame_ready = download_frame(video, oldest_texture, &frame);
+	if (frame_ready)
+		download_scaled_frames(video, oldest_texture);
 	profile_end(output_frame_download_frame_name);
 
 	profile_start(output_frame_gs_flush_name);
@@ -556,11 +776,16 @@ static inline void output_frame(void)
 
 		frame.timestamp = vframe_info.timestamp;
 		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
+		output_video_data(video, &video->main_target, &frame,
+				vframe_info.count);
+		output_scaled_video_data(video, vframe_info.timestamp,
+				vframe_info.count);
 		profile_end(output_frame_output_video_data_name);
 	}
 
-	if (++video->cur_texture == NUM_TEXTURES)
+	pthread_mutex_unlock(&video->scaled_targets_mutex);
+
+	if (++video->cur_texture == video->num_textures)
 		video->cur_texture = 0;
 }
 
@@ -602,7 +827,7 @@ void *obs_video_thread(void *param)
 
 		profile_reenable_thread();
 
-		video_sleep(&obs->video, &obs->video.video_time, interval);
+		video_sleep(&obs->video, &obs->video.video_time);
 	}
 
 	UNUSED_PARAMETER(param);
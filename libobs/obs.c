@@ -47,172 +47,199 @@ static inline void make_video_info(struct video_output_info *vi,
 #define GET_ALIGN(val, align) \
 	(((val) + (align-1)) & ~(align-1))
 
-static inline void set_420p_sizes(const struct obs_video_info *ovi)
+static inline void set_420p_sizes(struct obs_video_target *target)
 {
-	struct obs_core_video *video = &obs->video;
 	uint32_t chroma_pixels;
 	uint32_t total_bytes;
 
-	chroma_pixels = (ovi->output_width * ovi->output_height / 4);
+	chroma_pixels = (target->width * target->height / 4);
 	chroma_pixels = GET_ALIGN(chroma_pixels, PIXEL_SIZE);
 
-	video->plane_offsets[0] = 0;
-	video->plane_offsets[1] = ovi->output_width * ovi->output_height;
-	video->plane_offsets[2] = video->plane_offsets[1] + chroma_pixels;
+	target->plane_offsets[0] = 0;
+	target->plane_offsets[1] = target->width * target->height;
+	target->plane_offsets[2] = target->plane_offsets[1] + chroma_pixels;
 
-	video->plane_linewidth[0] = ovi->output_width;
-	video->plane_linewidth[1] = ovi->output_width/2;
-	video->plane_linewidth[2] = ovi->output_width/2;
+	target->plane_linewidth[0] = target->width;
+	target->plane_linewidth[1] = target->width/2;
+	target->plane_linewidth[2] = target->width/2;
 
-	video->plane_sizes[0] = video->plane_offsets[1];
-	video->plane_sizes[1] = video->plane_sizes[0]/4;
-	video->plane_sizes[2] = video->plane_sizes[1];
+	target->plane_sizes[0] = target->plane_offsets[1];
+	target->plane_sizes[1] = target->plane_sizes[0]/4;
+	target->plane_sizes[2] = target->plane_sizes[1];
 
-	total_bytes = video->plane_offsets[2] + chroma_pixels;
+	total_bytes = target->plane_offsets[2] + chroma_pixels;
 
-	video->conversion_height =
-		(total_bytes/PIXEL_SIZE + ovi->output_width-1) /
-		ovi->output_width;
+	target->conversion_height =
+		(total_bytes/PIXEL_SIZE + target->width-1) /
+		target->width;
 
-	video->conversion_height = GET_ALIGN(video->conversion_height, 2);
-	video->conversion_tech = "Planar420";
+	target->conversion_height = GET_ALIGN(target->conversion_height, 2);
+	target->conversion_tech = "Planar420";
 }
 
-static inline void set_nv12_sizes(const struct obs_video_info *ovi)
+static inline void set_nv12_sizes(struct obs_video_target *target)
 {
-	struct obs_core_video *video = &obs->video;
 	uint32_t chroma_pixels;
 	uint32_t total_bytes;
 
-	chroma_pixels = (ovi->output_width * ovi->output_height / 2);
+	chroma_pixels = (target->width * target->height / 2);
 	chroma_pixels = GET_ALIGN(chroma_pixels, PIXEL_SIZE);
 
-	video->plane_offsets[0] = 0;
-	video->plane_offsets[1] = ovi->output_width * ovi->output_height;
+	target->plane_offsets[0] = 0;
+	target->plane_offsets[1] = target->width * target->height;
 
-	video->plane_linewidth[0] = ovi->output_width;
-	video->plane_linewidth[1] = ovi->output_width;
+	target->plane_linewidth[0] = target->width;
+	target->plane_linewidth[1] = target->width;
 
-	video->plane_sizes[0] = video->plane_offsets[1];
-	video->plane_sizes[1] = video->plane_sizes[0]/2;
+	target->plane_sizes[0] = target->plane_offsets[1];
+	target->plane_sizes[1] = target->plane_sizes[0]/2;
 
-	total_bytes = video->plane_offsets[1] + chroma_pixels;
+	total_bytes = target->plane_offsets[1] + chroma_pixels;
 
-	video->conversion_height =
-		(total_bytes/PIXEL_SIZE + ovi->output_width-1) /
-		ovi->output_width;
+	target->conversion_height =
+		(total_bytes/PIXEL_SIZE + target->width-1) /
+		target->width;
 
-	video->conversion_height = GET_ALIGN(video->conversion_height, 2);
-	video->conversion_tech = "NV12";
+	target->conversion_height = GET_ALIGN(target->conversion_height, 2);
+	target->conversion_tech = "NV12";
 }
 
-static inline void set_444p_sizes(const struct obs_video_info *ovi)
+static inline void set_444p_sizes(struct obs_video_target *target)
 {
-	struct obs_core_video *video = &obs->video;
 	uint32_t chroma_pixels;
 	uint32_t total_bytes;
 
-	chroma_pixels = (ovi->output_width * ovi->output_height);
+	chroma_pixels = (target->width * target->height);
 	chroma_pixels = GET_ALIGN(chroma_pixels, PIXEL_SIZE);
 
-	video->plane_offsets[0] = 0;
-	video->plane_offsets[1] = chroma_pixels;
-	video->plane_offsets[2] = chroma_pixels + chroma_pixels;
+	target->plane_offsets[0] = 0;
+	target->plane_offsets[1] = chroma_pixels;
+	target->plane_offsets[2] = chroma_pixels + chroma_pixels;
 
-	video->plane_linewidth[0] = ovi->output_width;
-	video->plane_linewidth[1] = ovi->output_width;
-	video->plane_linewidth[2] = ovi->output_width;
+	target->plane_linewidth[0] = target->width;
+	target->plane_linewidth[1] = target->width;
+	target->plane_linewidth[2] = target->width;
 
-	video->plane_sizes[0] = chroma_pixels;
-	video->plane_sizes[1] = chroma_pixels;
-	video->plane_sizes[2] = chroma_pixels;
+	target->plane_sizes[0] = chroma_pixels;
+	target->plane_sizes[1] = chroma_pixels;
+	target->plane_sizes[2] = chroma_pixels;
 
-	total_bytes = video->plane_offsets[2] + chroma_pixels;
+	total_bytes = target->plane_offsets[2] + chroma_pixels;
 
-	video->conversion_height =
-		(total_bytes/PIXEL_SIZE + ovi->output_width-1) /
-		ovi->output_width;
+	target->conversion_height =
+		(total_bytes/PIXEL_SIZE + target->width-1) /
+		target->width;
 
-	video->conversion_height = GET_ALIGN(video->conversion_height, 2);
-	video->conversion_tech = "Planar444";
+	target->conversion_height = GET_ALIGN(target->conversion_height, 2);
+	target->conversion_tech = "Planar444";
 }
 
-static inline void calc_gpu_conversion_sizes(const struct obs_video_info *ovi)
+static inline void calc_gpu_conversion_sizes(struct obs_video_target *target,
+		enum video_format format)
 {
-	obs->video.conversion_height = 0;
-	memset(obs->video.plane_offsets, 0, sizeof(obs->video.plane_offsets));
-	memset(obs->video.plane_sizes, 0, sizeof(obs->video.plane_sizes));
-	memset(obs->video.plane_linewidth, 0,
-		sizeof(obs->video.plane_linewidth));
+	target->conversion_height = 0;
+	memset(target->plane_offsets, 0, sizeof(target->plane_offsets));
+	memset(target->plane_sizes, 0, sizeof(target->plane_sizes));
+	memset(target->plane_linewidth, 0, sizeof(target->plane_linewidth));
 
-	switch ((uint32_t)ovi->output_format) {
+	switch ((uint32_t)format) {
 	case VIDEO_FORMAT_I420:
-		set_420p_sizes(ovi);
+		set_420p_sizes(target);
 		break;
 	case VIDEO_FORMAT_NV12:
-		set_nv12_sizes(ovi);
+		set_nv12_sizes(target);
 		break;
 	case VIDEO_FORMAT_I444:
-		set_444p_sizes(ovi);
+		set_444p_sizes(target);
 		break;
 	}
 }
 
-static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
+static bool obs_init_gpu_conversion(struct obs_video_target *target,
+		enum video_format format)
 {
-	struct obs_core_video *video = &obs->video;
-
-	calc_gpu_conversion_sizes(ovi);
+	calc_gpu_conversion_sizes(target, format);
 
-	if (!video->conversion_height) {
+	if (!target->conversion_height) {
 		blog(LOG_INFO, "GPU conversion not available for format: %u",
-				(unsigned int)ovi->output_format);
-		video->gpu_conversion = false;
+				(unsigned int)format);
+		target->gpu_conversion = false;
 		return true;
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
-		video->convert_textures[i] = gs_texture_create(
-				ovi->output_width, video->conversion_height,
+	for (int i = 0; i < obs->video.num_textures; i++) {
+		target->convert_textures[i] = gs_texture_create(
+				target->width, target->conversion_height,
 				GS_RGBA, 1, NULL, GS_RENDER_TARGET);
 
-		if (!video->convert_textures[i])
+		if (!target->convert_textures[i])
 			return false;
 	}
 
 	return true;
 }
 
-static bool obs_init_textures(struct obs_video_info *ovi)
+static bool obs_init_target_textures(struct obs_video_target *target)
 {
-	struct obs_core_video *video = &obs->video;
-	uint32_t output_height = video->gpu_conversion ?
-		video->conversion_height : ovi->output_height;
-	size_t i;
+	uint32_t output_height = target->gpu_conversion ?
+		target->conversion_height : target->height;
 
-	for (i = 0; i < NUM_TEXTURES; i++) {
-		video->copy_surfaces[i] = gs_stagesurface_create(
-				ovi->output_width, output_height, GS_RGBA);
+	for (int i = 0; i < obs->video.num_textures; i++) {
+		target->copy_surfaces[i] = gs_stagesurface_create(
+				target->width, output_height, GS_RGBA);
 
-		if (!video->copy_surfaces[i])
+		if (!target->copy_surfaces[i])
 			return false;
 
-		video->render_textures[i] = gs_texture_create(
-				ovi->base_width, ovi->base_height,
+		target->output_textures[i] = gs_texture_create(
+				target->width, target->height,
 				GS_RGBA, 1, NULL, GS_RENDER_TARGET);
 
-		if (!video->render_textures[i])
+		if (!target->output_textures[i])
 			return false;
+	}
+
+	return true;
+}
 
-		video->output_textures[i] = gs_texture_create(
-				ovi->output_width, ovi->output_height,
+static void obs_free_target_textures(struct obs_video_target *target)
+{
+	if (target->mapped_surface) {
+		gs_stagesurface_unmap(target->mapped_surface);
+		target->mapped_surface = NULL;
+	}
+
+	for (size_t i = 0; i < MAX_NUM_TEXTURES; i++) {
+		gs_stagesurface_destroy(target->copy_surfaces[i]);
+		gs_texture_destroy(target->convert_textures[i]);
+		gs_texture_destroy(target->output_textures[i]);
+
+		target->copy_surfaces[i]    = NULL;
+		target->convert_textures[i] = NULL;
+		target->output_textures[i]  = NULL;
+	}
+
+	memset(&target->textures_output, 0, sizeof(target->textures_output));
+	memset(&target->textures_copied, 0, sizeof(target->textures_copied));
+	memset(&target->textures_converted, 0,
+			sizeof(target->textures_converted));
+}
+
+static bool obs_init_textures(struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+	int i;
+
+	for (i = 0; i < video->num_textures; i++) {
+		video->render_textures[i] = gs_texture_create(
+				ovi->base_width, ovi->base_height,
 				GS_RGBA, 1, NULL, GS_RENDER_TARGET);
 
-		if (!video->output_textures[i])
+		if (!video->render_textures[i])
 			return false;
 	}
 
-	return true;
+	return obs_init_target_textures(&video->main_target);
 }
 
 gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file)
@@ -347,6 +374,48 @@ static inline void set_video_matrix(struct obs_core_video *video,
 	memcpy(video->color_matrix, &mat, sizeof(float) * 16);
 }
 
+/* rows per band below which splitting the conversion isn't worth it */
+#define MIN_CONVERT_BAND_HEIGHT 128
+
+static void obs_init_convert_pool(struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+	size_t bands = (size_t)os_get_logical_cores() / 2;
+
+	if (bands > MAX_CONVERT_BANDS)
+		bands = MAX_CONVERT_BANDS;
+	if (bands > ovi->output_height / MIN_CONVERT_BAND_HEIGHT)
+		bands = ovi->output_height / MIN_CONVERT_BAND_HEIGHT;
+	if (!bands)
+		bands = 1;
+
+	if (bands > 1)
+		video->convert_pool = task_pool_create(
+				"libobs: frame conversion thread", bands - 1);
+
+	video->convert_bands = video->convert_pool ?
+		task_pool_get_thread_count(video->convert_pool) + 1 : 1;
+
+	for (size_t i = 0; i < video->convert_bands; i++)
+		video->convert_band_names[i] = profile_store_name(
+				obs_get_profiler_name_store(),
+				"convert_frame_band(%d)", (int)i);
+}
+
+static void obs_init_tick_pool(void)
+{
+	struct obs_core_video *video = &obs->video;
+	size_t threads = (size_t)os_get_logical_cores() / 2;
+
+	if (threads > MAX_TICK_THREADS)
+		threads = MAX_TICK_THREADS;
+
+	/* the graphics thread takes part in running the ticks as well */
+	if (threads > 1)
+		video->tick_pool = task_pool_create(
+				"libobs: source tick thread", threads - 1);
+}
+
 static int obs_init_video(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -358,8 +427,12 @@ static int obs_init_video(struct obs_video_info *ovi)
 	video->base_height    = ovi->base_height;
 	video->output_width   = ovi->output_width;
 	video->output_height  = ovi->output_height;
-	video->gpu_conversion = ovi->gpu_conversion;
 	video->scale_type     = ovi->scale_type;
+	video->num_textures   = (int)ovi->readback_depth;
+
+	video->main_target.width          = ovi->output_width;
+	video->main_target.height         = ovi->output_height;
+	video->main_target.gpu_conversion = ovi->gpu_conversion;
 
 	set_video_matrix(video, ovi);
 
@@ -375,15 +448,32 @@ static int obs_init_video(struct obs_video_info *ovi)
 		return OBS_VIDEO_FAIL;
 	}
 
+	video->main_target.video = video->video;
+
+	frame_clock_reset(video->frame_clock,
+			video_output_get_frame_time(video->video));
+
 	gs_enter_context(video->graphics);
 
-	if (ovi->gpu_conversion && !obs_init_gpu_conversion(ovi))
+	if (ovi->gpu_conversion &&
+	    !obs_init_gpu_conversion(&video->main_target,
+		    ovi->output_format))
 		return OBS_VIDEO_FAIL;
 	if (!obs_init_textures(ovi))
 		return OBS_VIDEO_FAIL;
 
 	gs_leave_context();
 
+	/* scaled targets follow whatever the main output ended up using */
+	video->gpu_conversion = video->main_target.gpu_conversion;
+
+	if (!video->gpu_conversion && format_is_yuv(ovi->output_format))
+		obs_init_convert_pool(ovi);
+	else
+		video->convert_bands = 1;
+
+	obs_init_tick_pool();
+
 	errorcode = pthread_create(&video->video_thread, NULL,
 			obs_video_thread, obs);
 	if (errorcode != 0)
@@ -408,48 +498,70 @@ static void stop_video(void)
 
 }
 
+static void obs_video_target_destroy(struct obs_video_target *target);
+
+static void log_frame_clock_stats(struct obs_core_video *video)
+{
+	struct frame_clock_stats stats;
+
+	frame_clock_get_stats(video->frame_clock, &stats);
+	if (!stats.total_frames)
+		return;
+
+	blog(LOG_INFO, "Video frame clock: %"PRIu64" frames, "
+			"%"PRIu64" lagged from rendering, "
+			"%"PRIu64" lagged from late wake ups, "
+			"max jitter %"PRIu64" us, audio drift %"PRId64" us "
+			"(max %"PRId64" us)",
+			stats.total_frames,
+			stats.render_lagged_frames,
+			stats.sleep_lagged_frames,
+			stats.max_jitter / 1000,
+			stats.audio_drift / 1000,
+			stats.max_audio_drift / 1000);
+}
+
 static void obs_free_video(void)
 {
 	struct obs_core_video *video = &obs->video;
 
 	if (video->video) {
+		log_frame_clock_stats(video);
+
+		for (size_t i = 0; i < video->scaled_targets.num; i++)
+			obs_video_target_destroy(video->scaled_targets.array[i]);
+		da_free(video->scaled_targets);
+
 		video_output_close(video->video);
 		video->video = NULL;
+		video->main_target.video = NULL;
 
 		if (!video->graphics)
 			return;
 
 		gs_enter_context(video->graphics);
 
-		if (video->mapped_surface) {
-			gs_stagesurface_unmap(video->mapped_surface);
-			video->mapped_surface = NULL;
-		}
+		obs_free_target_textures(&video->main_target);
 
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
-			gs_stagesurface_destroy(video->copy_surfaces[i]);
+		for (size_t i = 0; i < MAX_NUM_TEXTURES; i++) {
 			gs_texture_destroy(video->render_textures[i]);
-			gs_texture_destroy(video->convert_textures[i]);
-			gs_texture_destroy(video->output_textures[i]);
-
-			video->copy_surfaces[i]    = NULL;
-			video->render_textures[i]  = NULL;
-			video->convert_textures[i] = NULL;
-			video->output_textures[i]  = NULL;
+			video->render_textures[i] = NULL;
 		}
 
 		gs_leave_context();
 
 		circlebuf_free(&video->vframe_info_buffer);
 
+		task_pool_destroy(video->tick_pool);
+		video->tick_pool = NULL;
+		da_free(video->threaded_ticks);
+
+		task_pool_destroy(video->convert_pool);
+		video->convert_pool = NULL;
+		video->convert_bands = 0;
+
 		memset(&video->textures_rendered, 0,
 				sizeof(video->textures_rendered));
-		memset(&video->textures_output, 0,
-				sizeof(video->textures_output));
-		memset(&video->textures_copied, 0,
-				sizeof(video->textures_copied));
-		memset(&video->textures_converted, 0,
-				sizeof(video->textures_converted));
 
 		video->cur_texture = 0;
 	}
@@ -492,6 +604,22 @@ static bool obs_init_audio(struct audio_output_info *ai)
 
 	audio->user_volume    = 1.0f;
 
+	/* the audio thread starts mixing as soon as the output is opened */
+	audio->block_frames   = ai->block_frames ?
+		ai->block_frames : AUDIO_OUTPUT_FRAMES;
+	audio->max_buffering_ticks = (int)(MAX_BUFFERING_FRAMES /
+			audio->block_frames);
+	audio->min_headroom   = SIZE_MAX;
+	audio->tree_changed   = true;
+
+	if (audio->render_threads)
+		audio->render_pool = task_pool_create(
+				"libobs: audio render thread",
+				audio->render_threads);
+
+	/* the audio clock starts over, so drift has to be measured again */
+	frame_clock_reset_audio(obs->video.frame_clock);
+
 	errorcode = audio_output_open(&audio->audio, ai);
 	if (errorcode == AUDIO_OUTPUT_SUCCESS)
 		return true;
@@ -509,9 +637,19 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	task_pool_destroy(audio->render_pool);
+
 	circlebuf_free(&audio->buffered_timestamps);
+	for (size_t i = 0; i < audio->cached_render_order.num; i++)
+		obs_weak_source_release(audio->cached_render_order.array[i]);
+	for (size_t i = 0; i < audio->cached_root_nodes.num; i++)
+		obs_weak_source_release(audio->cached_root_nodes.array[i]);
+
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
+	da_free(audio->cached_render_order);
+	da_free(audio->cached_root_nodes);
+	da_free(audio->parallel_sources);
 
 	memset(audio, 0, sizeof(struct obs_core_audio));
 }
@@ -725,6 +863,14 @@ static bool obs_init(const char *locale, const char *module_config_path,
 {
 	obs = bzalloc(sizeof(struct obs_core));
 
+	pthread_mutex_init_value(&obs->video.scaled_targets_mutex);
+	if (pthread_mutex_init(&obs->video.scaled_targets_mutex, NULL) != 0)
+		return false;
+
+	obs->video.frame_clock = frame_clock_create();
+	if (!obs->video.frame_clock)
+		return false;
+
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
 	if (!obs->name_store) {
@@ -818,6 +964,8 @@ void obs_shutdown(void)
 	obs_free_video();
 	obs_free_hotkeys();
 	obs_free_graphics();
+	pthread_mutex_destroy(&obs->video.scaled_targets_mutex);
+	frame_clock_destroy(obs->video.frame_clock);
 	proc_handler_destroy(obs->procs);
 	signal_handler_destroy(obs->signals);
 
@@ -889,12 +1037,163 @@ static inline bool size_valid(uint32_t width, uint32_t height)
 	        width <= OBS_SIZE_MAX && height <= OBS_SIZE_MAX);
 }
 
+static void obs_video_target_destroy(struct obs_video_target *target)
+{
+	if (!target)
+		return;
+
+	video_output_close(target->video);
+
+	gs_enter_context(obs->video.graphics);
+	obs_free_target_textures(target);
+	gs_leave_context();
+
+	bfree(target);
+}
+
+static struct obs_video_target *obs_video_target_create(uint32_t width,
+		uint32_t height)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_video_target *target;
+	struct video_output_info vi;
+	bool success = true;
+
+	vi        = *video_output_get_info(video->video);
+	vi.name   = "scaled_video";
+	vi.width  = width;
+	vi.height = height;
+
+	target = bzalloc(sizeof(struct obs_video_target));
+	target->width          = width;
+	target->height         = height;
+	target->gpu_conversion = video->gpu_conversion;
+	target->refs           = 1;
+
+	if (video_output_open(&target->video, &vi) != VIDEO_OUTPUT_SUCCESS) {
+		blog(LOG_WARNING, "Could not open scaled video output");
+		bfree(target);
+		return NULL;
+	}
+
+	gs_enter_context(video->graphics);
+
+	if (target->gpu_conversion &&
+	    !obs_init_gpu_conversion(target, vi.format))
+		success = false;
+	if (success && !obs_init_target_textures(target))
+		success = false;
+
+	gs_leave_context();
+
+	if (!success) {
+		blog(LOG_WARNING, "Could not create scaled video textures");
+		obs_video_target_destroy(target);
+		return NULL;
+	}
+
+	blog(LOG_INFO, "Created GPU-scaled video output: %"PRIu32"x%"PRIu32,
+			width, height);
+	return target;
+}
+
+static struct obs_video_target *find_video_target(uint32_t width,
+		uint32_t height)
+{
+	struct obs_core_video *video = &obs->video;
+
+	for (size_t i = 0; i < video->scaled_targets.num; i++) {
+		struct obs_video_target *target = video->scaled_targets.array[i];
+
+		if (target->width == width && target->height == height)
+			return target;
+	}
+
+	return NULL;
+}
+
+struct obs_video_target *obs_video_target_acquire(uint32_t width,
+		uint32_t height)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_video_target *target;
+	struct obs_video_target *new_target;
+
+	if (!video->video || !video->graphics)
+		return NULL;
+
+	/* the conversions expect the same alignment as the main output */
+	if (!size_valid(width, height) || (width & 3) != 0 ||
+	    (height & 1) != 0)
+		return NULL;
+
+	pthread_mutex_lock(&video->scaled_targets_mutex);
+	target = find_video_target(width, height);
+	if (target)
+		target->refs++;
+	pthread_mutex_unlock(&video->scaled_targets_mutex);
+
+	if (target)
+		return target;
+
+	/* textures are created outside of the lock because the graphics
+	 * thread holds the graphics context while taking the lock */
+	new_target = obs_video_target_create(width, height);
+	if (!new_target)
+		return NULL;
+
+	pthread_mutex_lock(&video->scaled_targets_mutex);
+	target = find_video_target(width, height);
+	if (target) {
+		target->refs++;
+	} else {
+		target = new_target;
+		new_target = NULL;
+		da_push_back(video->scaled_targets, &target);
+	}
+	pthread_mutex_unlock(&video->scaled_targets_mutex);
+
+	obs_video_target_destroy(new_target);
+	return target;
+}
+
+void obs_video_target_release(struct obs_video_target *target)
+{
+	struct obs_core_video *video = &obs->video;
+	bool destroy;
+
+	if (!target)
+		return;
+
+	pthread_mutex_lock(&video->scaled_targets_mutex);
+	destroy = --target->refs == 0;
+	if (destroy)
+		da_erase_item(video->scaled_targets, &target);
+	pthread_mutex_unlock(&video->scaled_targets_mutex);
+
+	if (destroy)
+		obs_video_target_destroy(target);
+}
+
+static bool scaled_targets_active(void)
+{
+	struct obs_core_video *video = &obs->video;
+	bool active;
+
+	pthread_mutex_lock(&video->scaled_targets_mutex);
+	active = video->scaled_targets.num != 0;
+	pthread_mutex_unlock(&video->scaled_targets_mutex);
+
+	return active;
+}
+
 int obs_reset_video(struct obs_video_info *ovi)
 {
 	if (!obs) return OBS_VIDEO_FAIL;
 
 	/* don't allow changing of video settings if active. */
-	if (obs->video.video && video_output_active(obs->video.video))
+	if (obs->video.video && (video_output_active(obs->video.video) ||
+	                         scaled_targets_active()))
 		return OBS_VIDEO_CURRENTLY_ACTIVE;
 
 	if (!size_valid(ovi->output_width, ovi->output_height) ||
@@ -915,6 +1214,13 @@ int obs_reset_video(struct obs_video_info *ovi)
 	ovi->output_width  &= 0xFFFFFFFC;
 	ovi->output_height &= 0xFFFFFFFE;
 
+	if (!ovi->readback_depth)
+		ovi->readback_depth = NUM_TEXTURES;
+	else if (ovi->readback_depth < 2)
+		ovi->readback_depth = 2;
+	else if (ovi->readback_depth > MAX_NUM_TEXTURES)
+		ovi->readback_depth = MAX_NUM_TEXTURES;
+
 	if (!video->graphics) {
 		int errorcode = obs_init_graphics(ovi);
 		if (errorcode != OBS_VIDEO_SUCCESS) {
@@ -928,11 +1234,13 @@ int obs_reset_video(struct obs_video_info *ovi)
 	               "\tbase resolution:   %dx%d\n"
 	               "\toutput resolution: %dx%d\n"
 	               "\tfps:               %d/%d\n"
-	               "\tformat:            %s",
+	               "\tformat:            %s\n"
+	               "\treadback depth:    %d",
 	               ovi->base_width, ovi->base_height,
 	               ovi->output_width, ovi->output_height,
 	               ovi->fps_num, ovi->fps_den,
-		       get_video_format_name(ovi->output_format));
+		       get_video_format_name(ovi->output_format),
+	               (int)ovi->readback_depth);
 
 	return obs_init_video(ovi);
 }
@@ -951,18 +1259,32 @@ bool obs_reset_audio(const struct obs_audio_info *oai)
 	if (!oai)
 		return true;
 
+	memset(&ai, 0, sizeof(ai));
 	ai.name = "Audio";
 	ai.samples_per_sec = oai->samples_per_sec;
 	ai.format = AUDIO_FORMAT_FLOAT_PLANAR;
 	ai.speakers = oai->speakers;
 	ai.input_callback = audio_callback;
+	ai.block_frames = oai->block_frames;
+
+	obs->audio.low_latency = oai->low_latency;
+	obs->audio.render_threads = oai->render_threads;
+	if (obs->audio.render_threads > MAX_AUDIO_RENDER_THREADS)
+		obs->audio.render_threads = MAX_AUDIO_RENDER_THREADS;
 
 	blog(LOG_INFO, "---------------------------------");
 	blog(LOG_INFO, "audio settings reset:\n"
 	               "\tsamples per sec: %d\n"
-	               "\tspeakers:        %d",
+	               "\tspeakers:        %d\n"
+	               "\tblock frames:    %d\n"
+	               "\tlow latency:     %s\n"
+	               "\trender threads:  %d",
 	               (int)ai.samples_per_sec,
-	               (int)ai.speakers);
+	               (int)ai.speakers,
+	               (int)(ai.block_frames ?
+			       ai.block_frames : AUDIO_OUTPUT_FRAMES),
+	               oai->low_latency ? "yes" : "no",
+	               (int)obs->audio.render_threads);
 
 	return obs_init_audio(&ai);
 }
@@ -991,6 +1313,7 @@ bool obs_get_video_info(struct obs_video_info *ovi)
 	ovi->output_format = info->format;
 	ovi->fps_num       = info->fps_num;
 	ovi->fps_den       = info->fps_den;
+	ovi->readback_depth= (uint32_t)video->num_textures;
 
 	return true;
 }
@@ -1007,6 +1330,9 @@ bool obs_get_audio_info(struct obs_audio_info *oai)
 
 	oai->samples_per_sec = info->samples_per_sec;
 	oai->speakers = info->speakers;
+	oai->block_frames = info->block_frames;
+	oai->low_latency = audio->low_latency;
+	oai->render_threads = (uint32_t)audio->render_threads;
 	return true;
 }
 
@@ -1102,6 +1428,65 @@ video_t *obs_get_video(void)
 	return (obs != NULL) ? obs->video.video : NULL;
 }
 
+bool obs_get_frame_clock_stats(struct frame_clock_stats *stats)
+{
+	if (!obs || !obs->video.video)
+		return false;
+
+	frame_clock_get_stats(obs->video.frame_clock, stats);
+	return true;
+}
+
+uint32_t obs_get_audio_buffering_ms(void)
+{
+	struct obs_core_audio *audio;
+	uint32_t sample_rate;
+
+	if (!obs || !obs->audio.audio)
+		return 0;
+
+	audio = &obs->audio;
+	sample_rate = audio_output_get_sample_rate(audio->audio);
+
+	return (uint32_t)((uint64_t)audio->total_buffering_ticks *
+			audio->block_frames * 1000 / sample_rate);
+}
+
+bool obs_get_audio_stats(struct obs_audio_stats *stats)
+{
+	struct obs_core_audio *audio;
+	struct frame_clock_stats clock_stats;
+	uint64_t tick_ms;
+
+	if (!obs || !obs->audio.audio)
+		return false;
+	if (!obs_ptr_valid(stats, "obs_get_audio_stats"))
+		return false;
+
+	audio = &obs->audio;
+	memset(stats, 0, sizeof(*stats));
+
+	tick_ms = audio->block_frames * 1000;
+	stats->buffering_ms = (uint32_t)(audio->total_buffering_ticks *
+			tick_ms / audio_output_get_sample_rate(audio->audio));
+	stats->max_buffering_ms = (uint32_t)(audio->max_buffering_ticks *
+			tick_ms / audio_output_get_sample_rate(audio->audio));
+
+	stats->buffering_increases =
+		(uint64_t)os_atomic_load_long(&audio->buffering_increases);
+	stats->buffering_reductions =
+		(uint64_t)os_atomic_load_long(&audio->buffering_reductions);
+	stats->max_buffering_reached =
+		(uint64_t)os_atomic_load_long(&audio->max_buffering_reached);
+
+	if (obs->video.video) {
+		frame_clock_get_stats(obs->video.frame_clock, &clock_stats);
+		stats->clock_drift = clock_stats.audio_drift;
+	}
+
+	return true;
+}
+
 /* TODO: optimize this later so it's not just O(N) string lookups */
 static inline struct obs_modal_ui *get_modal_ui_callback(const char *id,
 		const char *task, const char *target)
@@ -1196,6 +1581,8 @@ void obs_set_output_source(uint32_t channel, obs_source_t *source)
 
 	pthread_mutex_unlock(&view->channels_mutex);
 
+	obs_audio_tree_changed();
+
 	if (source)
 		obs_source_activate(source, MAIN_VIEW);
 
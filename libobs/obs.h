@@ -26,6 +26,7 @@
 #include "graphics/vec3.h"
 #include "media-io/audio-io.h"
 #include "media-io/video-io.h"
+#include "media-io/frame-clock.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
 
@@ -260,6 +261,13 @@ struct obs_video_info {
 	enum video_range_type range;       /**< YUV range (if YUV) */
 
 	enum obs_scale_type scale_type;    /**< How to scale if scaling */
+
+	/**
+	 * Number of frames in the GPU readback ring (0 for the default).
+	 * Higher values add latency but prevent the graphics thread from
+	 * stalling while waiting for texture downloads.
+	 */
+	uint32_t            readback_depth;
 };
 
 /**
@@ -268,6 +276,27 @@ struct obs_video_info {
 struct obs_audio_info {
 	uint32_t            samples_per_sec;
 	enum speaker_layout speakers;
+
+	/** Frames per audio block, 0 for the default (AUDIO_OUTPUT_FRAMES) */
+	uint32_t            block_frames;
+
+	/**
+	 * Allows audio buffering to be reduced again after it's been increased,
+	 * once all sources have kept to their timing for a while.  Each
+	 * reduction skips a block, so audio output timestamps jump ahead by
+	 * that much; audio encoders fill the gap with silence, raw audio
+	 * callbacks see the jump in audio_data::timestamp
+	 */
+	bool                low_latency;
+
+	/**
+	 * Extra threads that sources are rendered on each audio tick, 0 to
+	 * render them all on the audio thread.  Rendering a source only copies
+	 * and scales its buffered audio, which rarely outweighs the cost of
+	 * waking the threads.  Filters such as noise suppression run when
+	 * audio is received, and have their own threading options.
+	 */
+	uint32_t            render_threads;
 };
 
 /**
@@ -554,6 +583,40 @@ EXPORT audio_t *obs_get_audio(void);
 /** Gets the main video output handler for this OBS context */
 EXPORT video_t *obs_get_video(void);
 
+/**
+ * Gets the pacing statistics of the graphics thread since video was last
+ * reset, returns false if no video
+ */
+EXPORT bool obs_get_frame_clock_stats(struct frame_clock_stats *stats);
+
+/** Gets the amount of audio currently being buffered, in milliseconds */
+EXPORT uint32_t obs_get_audio_buffering_ms(void);
+
+/** Statistics of the audio mixer, counted since audio was last reset */
+struct obs_audio_stats {
+	uint32_t buffering_ms;          /**< Audio currently being buffered */
+	uint32_t max_buffering_ms;      /**< Most audio that may be buffered */
+	uint64_t buffering_increases;   /**< Times buffering had to be added */
+	uint64_t buffering_reductions;  /**< Times low latency mode removed it */
+	uint64_t max_buffering_reached; /**< Times buffering hit the maximum */
+
+	/**
+	 * How far the video frame clock has drifted ahead of (positive) or
+	 * behind (negative) the audio thread's clock since the two were first
+	 * compared, in nanoseconds.  This is the drift between the clocks
+	 * that pace rendering and mixing, not the offset between the audio and
+	 * video timestamps sent to outputs: any offset present at the first
+	 * comparison is not included.
+	 */
+	int64_t  clock_drift;
+};
+
+/**
+ * Gets the statistics of the audio mixer.  Only reads counters, so it's
+ * cheap to poll.  Returns false if no audio.
+ */
+EXPORT bool obs_get_audio_stats(struct obs_audio_stats *stats);
+
 /** Sets the primary output source for a channel. */
 EXPORT void obs_set_output_source(uint32_t channel, obs_source_t *source);
 
@@ -743,6 +806,21 @@ EXPORT bool obs_display_enabled(obs_display_t *display);
 EXPORT void obs_display_set_background_color(obs_display_t *display,
 		uint32_t color);
 
+/**
+ * Sets the rate the display is refreshed at.  Displays can't refresh faster
+ * than the output frame rate, and a value of 0 (the default) refreshes on
+ * every output frame.
+ */
+EXPORT void obs_display_set_refresh_rate(obs_display_t *display, double fps);
+EXPORT double obs_display_get_refresh_rate(obs_display_t *display);
+
+/**
+ * Tells the display whether its window can currently be seen.  Displays that
+ * aren't visible (such as hidden or minimized windows) are not rendered.
+ */
+EXPORT void obs_display_set_visible(obs_display_t *display, bool visible);
+EXPORT bool obs_display_visible(obs_display_t *display);
+
 
 /* ------------------------------------------------------------------------- */
 /* Sources */
@@ -975,6 +1053,68 @@ EXPORT void obs_source_add_audio_capture_callback(obs_source_t *source,
 EXPORT void obs_source_remove_audio_capture_callback(obs_source_t *source,
 		obs_source_audio_capture_t callback, void *param);
 
+/**
+ * Audio levels of a source, measured by libobs once as each packet of audio
+ * is received, after filters and before volume is applied.  Levels are
+ * linear, per audio channel.  The levels are kept in 10 millisecond slots
+ * of received audio, so that they can be read back over any interval.
+ */
+struct obs_audio_levels {
+	uint64_t ticks;     /**< Number of slots that have been completed */
+	uint32_t frames;    /**< Number of frames the levels cover */
+	uint32_t channels;
+	float    peak[MAX_AUDIO_CHANNELS];
+	float    true_peak[MAX_AUDIO_CHANNELS]; /**< 4x oversampled peak */
+	float    rms[MAX_AUDIO_CHANNELS];
+	bool     muted;     /**< Whether the source was muted as of the last packet */
+};
+
+/**
+ * Gets a source's audio levels over the slots completed after 'since', which
+ * is the 'ticks' value of a previous call, or 0 to get only the latest slot.
+ * Looks back over at most the last second.  Never blocks or waits on the
+ * source's audio, so it's cheap to poll at any interval.
+ *
+ * @return  false if no slots have been completed since then
+ */
+EXPORT bool obs_source_get_audio_levels(const obs_source_t *source,
+		uint64_t since, struct obs_audio_levels *levels);
+
+/**
+ * Called with the levels of each new packet, on the thread the source's audio
+ * is received on
+ */
+typedef void (*obs_source_audio_levels_t)(void *param, obs_source_t *source,
+		const struct obs_audio_levels *levels);
+
+EXPORT void obs_source_add_audio_levels_callback(obs_source_t *source,
+		obs_source_audio_levels_t callback, void *param);
+EXPORT void obs_source_remove_audio_levels_callback(obs_source_t *source,
+		obs_source_audio_levels_t callback, void *param);
+
+/** Audio timing statistics of a source, counted since it was created */
+struct obs_source_audio_stats {
+	uint32_t buffered_ms;       /**< Audio waiting to be mixed */
+	uint64_t ts_jumps;          /**< Timestamp jumps that reset timing */
+	uint64_t discarded_frames;  /**< Frames dropped instead of mixed */
+	uint64_t resampler_resets;  /**< Times the input format changed */
+
+	/**
+	 * How late (positive) or early (negative) the last async video frame
+	 * was shown relative to the audio with the same timestamp, in
+	 * nanoseconds.  Only valid for async sources that also have audio.
+	 */
+	int64_t  av_offset;
+	bool     av_offset_valid;
+};
+
+/**
+ * Gets the audio timing statistics of a source.  Only briefly takes the
+ * source's buffer locks, so it's cheap to poll.
+ */
+EXPORT bool obs_source_get_audio_stats(const obs_source_t *source,
+		struct obs_source_audio_stats *stats);
+
 enum obs_deinterlace_mode {
 	OBS_DEINTERLACE_MODE_DISABLE,
 	OBS_DEINTERLACE_MODE_DISCARD,
@@ -1045,6 +1185,26 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_audio(obs_source_t *source,
 		const struct obs_source_audio *audio);
 
+/**
+ * Allocates the buffer used by obs_source_output_audio_rt, with room for at
+ * least the given number of frames in the given format.  Must not be called
+ * while another thread is outputting audio with obs_source_output_audio_rt.
+ */
+EXPORT void obs_source_reserve_audio_rt(obs_source_t *source, size_t frames,
+		enum audio_format format, enum speaker_layout speakers);
+
+/**
+ * Outputs audio data from a realtime thread.  Never locks or allocates: the
+ * audio is copied into the buffer allocated with obs_source_reserve_audio_rt
+ * and resampled and placed later on the audio thread.  Only one thread may
+ * output audio this way for a given source.
+ *
+ * @return  false if the audio was dropped because the buffer was full or
+ *          hasn't been allocated
+ */
+EXPORT bool obs_source_output_audio_rt(obs_source_t *source,
+		const struct obs_source_audio *audio);
+
 /** Signal an update to any currently used properties via 'update_properties' */
 EXPORT void obs_source_update_properties(obs_source_t *source);
 
@@ -1737,10 +1897,15 @@ EXPORT const char *obs_encoder_get_id(const obs_encoder_t *encoder);
 
 EXPORT uint32_t obs_get_encoder_caps(const char *encoder_id);
 
-/** Duplicates an encoder packet */
+/**
+ * Duplicates an encoder packet.  The data is copied into a reference counted
+ * buffer the first time, and duplicating a packet again only adds a reference
+ * to that buffer, so the data of a duplicated packet must not be modified.
+ */
 EXPORT void obs_duplicate_encoder_packet(struct encoder_packet *dst,
 		const struct encoder_packet *src);
 
+/** Frees or releases the data of a duplicated encoder packet */
 EXPORT void obs_free_encoder_packet(struct encoder_packet *packet);
 
 
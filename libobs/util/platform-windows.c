@@ -798,3 +798,10 @@ void os_breakpoint(void)
 {
 	__debugbreak();
 }
+
+int os_get_logical_cores(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+}
@@ -21,10 +21,17 @@
 #include <locale.h>
 #include "c99defs.h"
 #include "platform.h"
+#include "threading.h"
 #include "bmem.h"
 #include "utf8.h"
 #include "dstr.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
 FILE *os_wfopen(const wchar_t *path, const char *mode)
 {
 	FILE *file = NULL;
@@ -656,3 +663,71 @@ const char *os_get_path_extension(const char *path)
 
 	return path + pos;
 }
+
+static void get_cpuid(uint32_t leaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+	__cpuidex((int*)regs, (int)leaf, 0);
+#else
+	__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t get_xcr0(void)
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static pthread_once_t avx2_detect_token = PTHREAD_ONCE_INIT;
+static bool avx2_supported = false;
+#ifdef OBS_TEST_HOOKS
+static volatile bool avx2_disabled = false;
+#endif
+
+static void detect_avx2(void)
+{
+	uint32_t regs[4];
+
+	get_cpuid(0, regs);
+	if (regs[0] < 7)
+		return;
+
+	/* the OS must save the YMM registers (OSXSAVE + AVX, XCR0 bits 1-2) */
+	get_cpuid(1, regs);
+	if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0)
+		return;
+	if ((get_xcr0() & 0x6) != 0x6)
+		return;
+
+	get_cpuid(7, regs);
+	avx2_supported = (regs[1] & (1 << 5)) != 0;
+}
+
+static void log_avx2(void)
+{
+	detect_avx2();
+	blog(LOG_INFO, "CPU AVX2 support: %s", avx2_supported ? "yes" : "no");
+}
+
+bool os_cpu_has_avx2(void)
+{
+	pthread_once(&avx2_detect_token, log_avx2);
+#ifdef OBS_TEST_HOOKS
+	return avx2_supported && !avx2_disabled;
+#else
+	return avx2_supported;
+#endif
+}
+
+#ifdef OBS_TEST_HOOKS
+void os_cpu_force_disable_avx2(bool disable)
+{
+	avx2_disabled = disable;
+}
+#endif
@@ -171,6 +171,18 @@ EXPORT void os_inhibit_sleep_destroy(os_inhibit_t *info);
 
 EXPORT void os_breakpoint(void);
 
+EXPORT int os_get_logical_cores(void);
+
+/* returns true if both the CPU and the OS support AVX2 */
+EXPORT bool os_cpu_has_avx2(void);
+
+#ifdef OBS_TEST_HOOKS
+/* only in builds with the test programs: makes os_cpu_has_avx2 report
+ * false, so the SSE code paths can be compared with the AVX2 ones on the
+ * same machine */
+EXPORT void os_cpu_force_disable_avx2(bool disable);
+#endif
+
 #ifdef _MSC_VER
 #define strtoll _strtoi64
 #if _MSC_VER < 1900
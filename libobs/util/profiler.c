@@ -443,6 +443,32 @@ void profile_end(const char *name)
 	merge_context(call);
 }
 
+void profile_add_call(const char *name, uint64_t start_time,
+		uint64_t end_time)
+{
+	if (!thread_enabled)
+		return;
+
+	profile_call new_call = {
+		.name = name,
+#ifdef TRACK_OVERHEAD
+		.overhead_start = start_time,
+		.overhead_end = end_time,
+#endif
+		.start_time = start_time,
+		.end_time = end_time,
+		.parent = thread_context,
+	};
+
+	if (new_call.parent) {
+		da_push_back(new_call.parent->children, &new_call);
+	} else {
+		profile_call *call = bmalloc(sizeof(profile_call));
+		memcpy(call, &new_call, sizeof(profile_call));
+		merge_context(call);
+	}
+}
+
 static int profiler_time_entry_compare(const void *first, const void *second)
 {
 	int64_t diff = ((profiler_time_entry*)second)->time_delta -
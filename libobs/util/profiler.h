@@ -20,6 +20,11 @@ EXPORT void profile_register_root(const char *name,
 EXPORT void profile_start(const char *name);
 EXPORT void profile_end(const char *name);
 
+/* adds a call that was timed elsewhere, e.g. on a worker thread, as a child
+ * of the current call.  the times are from os_gettime_ns */
+EXPORT void profile_add_call(const char *name, uint64_t start_time,
+		uint64_t end_time);
+
 EXPORT void profile_reenable_thread(void);
 
 /* ------------------------------------------------------------------------- */
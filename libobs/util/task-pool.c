@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "bmem.h"
+#include "base.h"
+#include "profiler.h"
+#include "threading.h"
+#include "task-pool.h"
+
+struct task_pool {
+	pthread_t        *threads;
+	size_t           num_threads;
+	const char       *thread_name;
+
+	os_sem_t         *work_sem;
+	os_event_t       *done_event;
+	pthread_mutex_t  run_mutex;
+
+	/* current job, protected by task_mutex */
+	pthread_mutex_t  task_mutex;
+	task_pool_func_t func;
+	void             *param;
+	size_t           next_task;
+	size_t           num_tasks;
+	size_t           remaining;
+
+	volatile bool    stop;
+};
+
+static bool get_task(struct task_pool *pool, task_pool_func_t *func,
+		void **param, size_t *idx)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&pool->task_mutex);
+
+	if (pool->next_task < pool->num_tasks) {
+		*func  = pool->func;
+		*param = pool->param;
+		*idx   = pool->next_task++;
+		found  = true;
+	}
+
+	pthread_mutex_unlock(&pool->task_mutex);
+	return found;
+}
+
+static void finish_task(struct task_pool *pool)
+{
+	bool done;
+
+	pthread_mutex_lock(&pool->task_mutex);
+	done = --pool->remaining == 0;
+	pthread_mutex_unlock(&pool->task_mutex);
+
+	if (done)
+		os_event_signal(pool->done_event);
+}
+
+static void process_tasks(struct task_pool *pool)
+{
+	task_pool_func_t func;
+	void *param;
+	size_t idx;
+
+	while (get_task(pool, &func, &param, &idx)) {
+		func(param, idx);
+		finish_task(pool);
+	}
+}
+
+static void *task_thread(void *data)
+{
+	struct task_pool *pool = data;
+
+	os_set_thread_name(pool->thread_name);
+
+	while (os_sem_wait(pool->work_sem) == 0) {
+		if (pool->stop)
+			break;
+
+		process_tasks(pool);
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+task_pool_t *task_pool_create(const char *thread_name, size_t threads)
+{
+	struct task_pool *pool = bzalloc(sizeof(struct task_pool));
+
+	pool->thread_name = thread_name;
+	pthread_mutex_init_value(&pool->run_mutex);
+	pthread_mutex_init_value(&pool->task_mutex);
+
+	if (pthread_mutex_init(&pool->run_mutex, NULL) != 0)
+		goto fail;
+	if (pthread_mutex_init(&pool->task_mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&pool->work_sem, 0) != 0)
+		goto fail;
+	if (os_event_init(&pool->done_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+
+	if (threads)
+		pool->threads = bzalloc(sizeof(pthread_t) * threads);
+
+	for (size_t i = 0; i < threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, task_thread,
+					pool) != 0) {
+			blog(LOG_WARNING, "task_pool_create: Only able to "
+			                  "create %d of %d threads",
+			                  (int)i, (int)threads);
+			break;
+		}
+
+		pool->num_threads++;
+	}
+
+	return pool;
+
+fail:
+	blog(LOG_ERROR, "task_pool_create: Failed to create task pool");
+	task_pool_destroy(pool);
+	return NULL;
+}
+
+void task_pool_destroy(task_pool_t *pool)
+{
+	void *thread_ret;
+
+	if (!pool)
+		return;
+
+	pool->stop = true;
+	for (size_t i = 0; i < pool->num_threads; i++)
+		os_sem_post(pool->work_sem);
+	for (size_t i = 0; i < pool->num_threads; i++)
+		pthread_join(pool->threads[i], &thread_ret);
+
+	os_event_destroy(pool->done_event);
+	os_sem_destroy(pool->work_sem);
+	pthread_mutex_destroy(&pool->task_mutex);
+	pthread_mutex_destroy(&pool->run_mutex);
+	bfree(pool->threads);
+	bfree(pool);
+}
+
+size_t task_pool_get_thread_count(const task_pool_t *pool)
+{
+	return pool ? pool->num_threads : 0;
+}
+
+void task_pool_run(task_pool_t *pool, task_pool_func_t func,
+		void *param, size_t count)
+{
+	size_t wake;
+
+	if (!count)
+		return;
+
+	if (!pool || !pool->num_threads || count == 1) {
+		for (size_t i = 0; i < count; i++)
+			func(param, i);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->run_mutex);
+
+	pthread_mutex_lock(&pool->task_mutex);
+	pool->func      = func;
+	pool->param     = param;
+	pool->next_task = 0;
+	pool->num_tasks = count;
+	pool->remaining = count;
+	pthread_mutex_unlock(&pool->task_mutex);
+
+	/* the calling thread takes a task too */
+	wake = count - 1;
+	if (wake > pool->num_threads)
+		wake = pool->num_threads;
+
+	for (size_t i = 0; i < wake; i++)
+		os_sem_post(pool->work_sem);
+
+	process_tasks(pool);
+	os_event_wait(pool->done_event);
+
+	pthread_mutex_unlock(&pool->run_mutex);
+}
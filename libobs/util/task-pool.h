@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ *   Persistent pool of worker threads for splitting a job into a number of
+ * independent tasks.  task_pool_run blocks until every task has completed,
+ * and the calling thread processes tasks as well while it waits.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct task_pool;
+typedef struct task_pool task_pool_t;
+
+typedef void (*task_pool_func_t)(void *param, size_t idx);
+
+EXPORT task_pool_t *task_pool_create(const char *thread_name, size_t threads);
+EXPORT void task_pool_destroy(task_pool_t *pool);
+
+EXPORT size_t task_pool_get_thread_count(const task_pool_t *pool);
+
+/* calls func once for each index in [0, count) and returns when all calls
+ * have finished.  only one job may run on a pool at a time. */
+EXPORT void task_pool_run(task_pool_t *pool, task_pool_func_t func,
+		void *param, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
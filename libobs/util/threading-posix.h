@@ -26,9 +26,11 @@ static inline long os_atomic_dec_long(volatile long *val)
 	return __sync_sub_and_fetch(val, 1);
 }
 
+/* __sync_lock_test_and_set is only an acquire barrier, exchanges are full
+ * barriers like _InterlockedExchange so that a set can publish other data */
 static inline long os_atomic_set_long(volatile long *ptr, long val)
 {
-	return __sync_lock_test_and_set(ptr, val);
+	return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
 }
 
 static inline long os_atomic_load_long(const volatile long *ptr)
@@ -44,7 +46,7 @@ static inline bool os_atomic_compare_swap_long(volatile long *val,
 
 static inline bool os_atomic_set_bool(volatile bool *ptr, bool val)
 {
-	return __sync_lock_test_and_set(ptr, val);
+	return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
 }
 
 static inline bool os_atomic_load_bool(const volatile bool *ptr)
@@ -5,6 +5,7 @@
 #include <QScreen>
 #include <QResizeEvent>
 #include <QShowEvent>
+#include <QHideEvent>
 
 OBSQTDisplay::OBSQTDisplay(QWidget *parent, Qt::WindowFlags flags)
 	: QWidget(parent, flags)
@@ -18,6 +19,8 @@ OBSQTDisplay::OBSQTDisplay(QWidget *parent, Qt::WindowFlags flags)
 
 	auto windowVisible = [this] (bool visible)
 	{
+		UpdateVisibility();
+
 		if (!visible)
 			return;
 
@@ -57,10 +60,20 @@ void OBSQTDisplay::CreateDisplay()
 	QTToGSWindow(winId(), info.window);
 
 	display = obs_display_create(&info);
+	UpdateVisibility();
 
 	emit DisplayCreated(this);
 }
 
+void OBSQTDisplay::UpdateVisibility()
+{
+	if (!display)
+		return;
+
+	bool minimized = (window()->windowState() & Qt::WindowMinimized) != 0;
+	obs_display_set_visible(display, isVisible() && !minimized);
+}
+
 void OBSQTDisplay::resizeEvent(QResizeEvent *event)
 {
 	QWidget::resizeEvent(event);
@@ -82,6 +95,32 @@ void OBSQTDisplay::paintEvent(QPaintEvent *event)
 	QWidget::paintEvent(event);
 }
 
+void OBSQTDisplay::showEvent(QShowEvent *event)
+{
+	QWidget::showEvent(event);
+
+	/* minimizing only changes the state of the top level window, so watch
+	 * it to stop rendering while minimized */
+	window()->removeEventFilter(this);
+	window()->installEventFilter(this);
+
+	UpdateVisibility();
+}
+
+void OBSQTDisplay::hideEvent(QHideEvent *event)
+{
+	QWidget::hideEvent(event);
+	UpdateVisibility();
+}
+
+bool OBSQTDisplay::eventFilter(QObject *obj, QEvent *event)
+{
+	if (event->type() == QEvent::WindowStateChange)
+		UpdateVisibility();
+
+	return QWidget::eventFilter(obj, event);
+}
+
 QPaintEngine *OBSQTDisplay::paintEngine() const
 {
 	return nullptr;
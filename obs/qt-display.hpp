@@ -9,9 +9,13 @@ class OBSQTDisplay : public QWidget {
 	OBSDisplay display;
 
 	void CreateDisplay();
+	void UpdateVisibility();
 
 	void resizeEvent(QResizeEvent *event) override;
 	void paintEvent(QPaintEvent *event) override;
+	void showEvent(QShowEvent *event) override;
+	void hideEvent(QHideEvent *event) override;
+	bool eventFilter(QObject *obj, QEvent *event) override;
 
 signals:
 	void DisplayCreated(OBSQTDisplay *window);
@@ -1132,6 +1132,8 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_uint(basicConfig, "Audio", "SampleRate", 44100);
 	config_set_default_string(basicConfig, "Audio", "ChannelSetup",
 		"Stereo");
+	config_set_default_uint(basicConfig, "Audio", "BlockFrames", 1024);
+	config_set_default_bool(basicConfig, "Audio", "LowLatency", false);
 
 	return true;
 }
@@ -2746,6 +2748,8 @@ int OBSBasic::ResetVideo()
 	ovi.adapter = 0;
 	ovi.gpu_conversion = true;
 	ovi.scale_type = GetScaleType(basicConfig);
+	ovi.readback_depth = (uint32_t)config_get_uint(basicConfig,
+		"Video", "ReadbackDepth");
 
 	if (ovi.base_width == 0 || ovi.base_height == 0) {
 		ovi.base_width = 1920;
@@ -2785,13 +2789,27 @@ int OBSBasic::ResetVideo()
 	return ret;
 }
 
+#define MIN_AUDIO_BLOCK_FRAMES 64
+
 bool OBSBasic::ResetAudio()
 {
 	ProfileScope("OBSBasic::ResetAudio");
 
-	struct obs_audio_info ai;
+	struct obs_audio_info ai = {};
 	ai.samples_per_sec = config_get_uint(basicConfig, "Audio",
 		"SampleRate");
+	uint64_t blockFrames = config_get_uint(basicConfig, "Audio",
+		"BlockFrames");
+
+	/* libobs rejects blocks larger than AUDIO_OUTPUT_FRAMES, and very
+	 * small blocks would tick the audio thread far too often */
+	if (blockFrames == 0 || blockFrames > AUDIO_OUTPUT_FRAMES)
+		blockFrames = AUDIO_OUTPUT_FRAMES;
+	else if (blockFrames < MIN_AUDIO_BLOCK_FRAMES)
+		blockFrames = MIN_AUDIO_BLOCK_FRAMES;
+
+	ai.block_frames = (uint32_t)blockFrames;
+	ai.low_latency = config_get_bool(basicConfig, "Audio", "LowLatency");
 
 	const char *channelSetupStr = config_get_string(basicConfig,
 		"Audio", "ChannelSetup");
@@ -387,6 +387,7 @@ static inline bool ss_audio_render_(obs_source_t *transition, uint64_t *ts_out,
 {
 	struct obs_source_audio_mix child_audio;
 	uint64_t source_ts;
+	size_t frames;
 
 	if (obs_source_audio_pending(transition))
 		return false;
@@ -395,6 +396,8 @@ static inline bool ss_audio_render_(obs_source_t *transition, uint64_t *ts_out,
 	if (!source_ts)
 		return false;
 
+	frames = audio_output_get_block_frames(obs_get_audio());
+
 	obs_source_get_audio_mix(transition, &child_audio);
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		if ((mixers & (1 << mix)) == 0)
@@ -404,8 +407,7 @@ static inline bool ss_audio_render_(obs_source_t *transition, uint64_t *ts_out,
 			float *out = audio_output->output[mix].data[ch];
 			float *in = child_audio.output[mix].data[ch];
 
-			memcpy(out, in, AUDIO_OUTPUT_FRAMES *
-					MAX_AUDIO_CHANNELS * sizeof(float));
+			memcpy(out, in, frames * sizeof(float));
 		}
 	}
 
@@ -51,14 +51,17 @@ static enum speaker_layout jack_channels_to_obs_speakers(uint_fast32_t channels)
 	return SPEAKERS_UNKNOWN;
 }
 
+/**
+ * Runs on the JACK realtime thread, so this must not lock or allocate.  The
+ * ports stay valid while the client is active, as deactivate_jack deactivates
+ * the client before touching them.
+ */
 int jack_process_callback(jack_nframes_t nframes, void* arg)
 {
 	struct jack_data* data = (struct jack_data*)arg;
 	if (data == 0)
 		return 0;
 
-	pthread_mutex_lock(&data->jack_mutex);
-
 	struct obs_source_audio out;
 	out.speakers        = jack_channels_to_obs_speakers(data->channels);
 	out.samples_per_sec = jack_get_sample_rate (data->jack_client);
@@ -76,8 +79,7 @@ int jack_process_callback(jack_nframes_t nframes, void* arg)
 	out.timestamp = os_gettime_ns() -
 				jack_frames_to_time(data->jack_client, nframes);
 
-	obs_source_output_audio(data->source, &out);
-	pthread_mutex_unlock(&data->jack_mutex);
+	obs_source_output_audio_rt(data->source, &out);
 	return 0;
 }
 
@@ -117,6 +119,13 @@ int_fast32_t jack_init(struct jack_data* data)
 		}
 	}
 
+	/* room for half a second of audio, which the audio thread drains
+	 * every few milliseconds */
+	obs_source_reserve_audio_rt(data->source,
+		jack_get_sample_rate(data->jack_client) / 2,
+		AUDIO_FORMAT_FLOAT_PLANAR,
+		jack_channels_to_obs_speakers(data->channels));
+
 	if (jack_set_process_callback(data->jack_client,
 			jack_process_callback, data) != 0) {
 		blog(LOG_ERROR, "jack_set_process_callback Error");
@@ -144,6 +153,9 @@ void deactivate_jack(struct jack_data* data)
 	pthread_mutex_lock(&data->jack_mutex);
 
 	if (data->jack_client) {
+		/* stops the process callback before the ports go away */
+		jack_deactivate(data->jack_client);
+
 		if (data->jack_ports != NULL) {
 			for (int i = 0; i < data->channels; ++i) {
 				if (data->jack_ports[i] != NULL)
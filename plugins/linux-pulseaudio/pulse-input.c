@@ -147,7 +147,7 @@ static void pulse_stream_read(pa_stream *p, size_t nbytes, void *userdata)
 		data->first_ts = out.timestamp + STARTUP_TIMEOUT_NS;
 
 	if (out.timestamp > data->first_ts)
-		obs_source_output_audio(data->source, &out);
+		obs_source_output_audio_rt(data->source, &out);
 
 	data->packets++;
 	data->frames += out.frames;
@@ -263,7 +263,12 @@ static int_fast32_t pulse_start_recording(struct pulse_data *data)
 		return -1;
 	}
 
+	/* the read callback only copies the audio into a buffer, which the
+	 * audio thread passes on.  reserving under the mainloop lock keeps it
+	 * from racing with a read callback of a previous stream */
 	pulse_lock();
+	obs_source_reserve_audio_rt(data->source, data->samples_per_sec / 2,
+		pulse_to_obs_audio_format(data->format), data->speakers);
 	pa_stream_set_read_callback(data->stream, pulse_stream_read,
 		(void *) data);
 	pulse_unlock();
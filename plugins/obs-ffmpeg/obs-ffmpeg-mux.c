@@ -17,12 +17,15 @@
 
 #include <obs-module.h>
 #include <obs-avc.h>
+#include <util/darray.h>
 #include <util/dstr.h>
 #include <util/pipe.h>
+#include <util/platform.h>
 #include <util/threading.h>
 #include "ffmpeg-mux/ffmpeg-mux.h"
 
 #include <libavformat/avformat.h>
+#include <time.h>
 
 #define do_log(level, format, ...) \
 	blog(level, "[ffmpeg muxer: '%s'] " format, \
@@ -40,6 +43,19 @@ struct ffmpeg_muxer {
 	volatile bool     active;
 	volatile bool     stopping;
 	volatile bool     capturing;
+
+	/* replay buffer */
+	pthread_mutex_t   mutex;
+	DARRAY(struct encoder_packet) packets;
+	int64_t           cur_size;
+	int64_t           max_size;
+	int64_t           max_time;
+	struct dstr       last_replay;
+
+	DARRAY(struct encoder_packet) save_packets;
+	pthread_t         save_thread;
+	bool              save_thread_active;
+	volatile bool     saving;
 };
 
 static const char *ffmpeg_mux_getname(void *unused)
@@ -295,8 +311,8 @@ static void signal_failure(struct ffmpeg_muxer *stream)
 	os_atomic_set_bool(&stream->capturing, false);
 }
 
-static bool write_packet(struct ffmpeg_muxer *stream,
-		struct encoder_packet *packet)
+static bool write_packet_to_pipe(struct ffmpeg_muxer *stream,
+		os_process_pipe_t *pipe, struct encoder_packet *packet)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
 	size_t ret;
@@ -310,17 +326,26 @@ static bool write_packet(struct ffmpeg_muxer *stream,
 		.keyframe = packet->keyframe
 	};
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t*)&info,
+	ret = os_process_pipe_write(pipe, (const uint8_t*)&info,
 			sizeof(info));
 	if (ret != sizeof(info)) {
 		warn("os_process_pipe_write for info structure failed");
-		signal_failure(stream);
 		return false;
 	}
 
-	ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
+	ret = os_process_pipe_write(pipe, packet->data, packet->size);
 	if (ret != packet->size) {
 		warn("os_process_pipe_write for packet data failed");
+		return false;
+	}
+
+	return true;
+}
+
+static bool write_packet(struct ffmpeg_muxer *stream,
+		struct encoder_packet *packet)
+{
+	if (!write_packet_to_pipe(stream, stream->pipe, packet)) {
 		signal_failure(stream);
 		return false;
 	}
@@ -329,7 +354,7 @@ static bool write_packet(struct ffmpeg_muxer *stream,
 }
 
 static bool send_audio_headers(struct ffmpeg_muxer *stream,
-		obs_encoder_t *aencoder, size_t idx)
+		os_process_pipe_t *pipe, obs_encoder_t *aencoder, size_t idx)
 {
 	struct encoder_packet packet = {
 		.type         = OBS_ENCODER_AUDIO,
@@ -338,10 +363,11 @@ static bool send_audio_headers(struct ffmpeg_muxer *stream,
 	};
 
 	obs_encoder_get_extra_data(aencoder, &packet.data, &packet.size);
-	return write_packet(stream, &packet);
+	return write_packet_to_pipe(stream, pipe, &packet);
 }
 
-static bool send_video_headers(struct ffmpeg_muxer *stream)
+static bool send_video_headers(struct ffmpeg_muxer *stream,
+		os_process_pipe_t *pipe)
 {
 	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
 
@@ -351,21 +377,21 @@ static bool send_video_headers(struct ffmpeg_muxer *stream)
 	};
 
 	obs_encoder_get_extra_data(vencoder, &packet.data, &packet.size);
-	return write_packet(stream, &packet);
+	return write_packet_to_pipe(stream, pipe, &packet);
 }
 
-static bool send_headers(struct ffmpeg_muxer *stream)
+static bool send_headers(struct ffmpeg_muxer *stream, os_process_pipe_t *pipe)
 {
 	obs_encoder_t *aencoder;
 	size_t idx = 0;
 
-	if (!send_video_headers(stream))
+	if (!send_video_headers(stream, pipe))
 		return false;
 
 	do {
 		aencoder = obs_output_get_audio_encoder(stream->output, idx);
 		if (aencoder) {
-			if (!send_audio_headers(stream, aencoder, idx)) {
+			if (!send_audio_headers(stream, pipe, aencoder, idx)) {
 				return false;
 			}
 			idx++;
@@ -383,8 +409,10 @@ static void ffmpeg_mux_data(void *data, struct encoder_packet *packet)
 		return;
 
 	if (!stream->sent_headers) {
-		if (!send_headers(stream))
+		if (!send_headers(stream, stream->pipe)) {
+			signal_failure(stream);
 			return;
+		}
 
 		stream->sent_headers = true;
 	}
@@ -424,3 +452,438 @@ struct obs_output_info ffmpeg_muxer = {
 	.encoded_packet = ffmpeg_mux_data,
 	.get_properties = ffmpeg_mux_properties
 };
+
+/* ------------------------------------------------------------------------ */
+/* replay buffer */
+
+/*
+ * Keeps the last max_time of encoded packets (or as many as fit in
+ * max_size) in memory, starting from a keyframe, and writes them out to a
+ * new file through ffmpeg-mux whenever the "save" procedure is called.
+ *
+ * Saving only duplicates the buffered packets, which shares their data
+ * rather than copying it, and hands them to a separate thread, so the
+ * encoder callbacks are never held up by the file being written.
+ */
+
+static inline bool is_keyframe(const struct encoder_packet *packet)
+{
+	return packet->type == OBS_ENCODER_VIDEO && packet->keyframe;
+}
+
+static const char *replay_buffer_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("ReplayBuffer");
+}
+
+static void free_packets(struct encoder_packet *packets, size_t num)
+{
+	for (size_t i = 0; i < num; i++)
+		obs_free_encoder_packet(packets + i);
+}
+
+static void replay_buffer_clear(struct ffmpeg_muxer *stream)
+{
+	free_packets(stream->packets.array, stream->packets.num);
+	da_free(stream->packets);
+	stream->cur_size = 0;
+}
+
+static void replay_buffer_destroy(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+
+	if (stream->save_thread_active)
+		pthread_join(stream->save_thread, NULL);
+
+	replay_buffer_clear(stream);
+	da_free(stream->save_packets);
+	dstr_free(&stream->last_replay);
+	pthread_mutex_destroy(&stream->mutex);
+
+	ffmpeg_mux_destroy(data);
+}
+
+static void generate_replay_path(struct ffmpeg_muxer *stream,
+		struct dstr *path)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	const char *dir = obs_data_get_string(settings, "directory");
+	const char *prefix = obs_data_get_string(settings, "prefix");
+	const char *ext = obs_data_get_string(settings, "extension");
+	time_t now = time(NULL);
+	char timestamp[64];
+
+	strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H-%M-%S",
+			localtime(&now));
+
+	dstr_copy(path, dir);
+	dstr_replace(path, "\\", "/");
+	if (path->len && dstr_end(path) != '/')
+		dstr_cat_ch(path, '/');
+	dstr_catf(path, "%s %s.%s", prefix, timestamp, ext);
+
+	obs_data_release(settings);
+}
+
+/* the saved file starts at its first keyframe, and audio is offset to
+ * stay in sync with it.  audio from before the keyframe is left out */
+static bool write_replay_packets(struct ffmpeg_muxer *stream,
+		os_process_pipe_t *pipe)
+{
+	struct encoder_packet *packets = stream->save_packets.array;
+	int64_t video_offset = packets[0].dts;
+	int64_t video_start_usec = packets[0].dts_usec;
+	int64_t audio_offsets[MAX_AUDIO_MIXES];
+	bool audio_started[MAX_AUDIO_MIXES] = {0};
+
+	for (size_t i = 0; i < stream->save_packets.num; i++) {
+		struct encoder_packet packet = packets[i];
+		int64_t offset = video_offset;
+
+		if (packet.type == OBS_ENCODER_AUDIO) {
+			size_t track = packet.track_idx;
+
+			if (packet.dts_usec < video_start_usec)
+				continue;
+
+			if (!audio_started[track]) {
+				audio_offsets[track] = packet.dts -
+					(packet.dts_usec - video_start_usec) *
+					packet.timebase_den /
+					(packet.timebase_num * 1000000LL);
+				audio_started[track] = true;
+			}
+
+			offset = audio_offsets[track];
+		}
+
+		packet.pts -= offset;
+		packet.dts -= offset;
+
+		if (!write_packet_to_pipe(stream, pipe, &packet))
+			return false;
+	}
+
+	return true;
+}
+
+static void *replay_buffer_save_thread(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+	struct dstr path = {0};
+	struct dstr cmd;
+	os_process_pipe_t *pipe;
+	bool success = false;
+
+	os_set_thread_name("replay buffer: save thread");
+
+	generate_replay_path(stream, &path);
+	dstr_copy_dstr(&stream->path, &path);
+	dstr_replace(&stream->path, "\"", "\"\"");
+
+	build_command_line(stream, &cmd);
+	pipe = os_process_pipe_create(cmd.array, "w");
+	dstr_free(&cmd);
+
+	if (pipe) {
+		success = send_headers(stream, pipe) &&
+			write_replay_packets(stream, pipe);
+
+		if (os_process_pipe_destroy(pipe) != FFM_SUCCESS)
+			success = false;
+	} else {
+		warn("Failed to create process pipe");
+	}
+
+	free_packets(stream->save_packets.array, stream->save_packets.num);
+	stream->save_packets.num = 0;
+
+	if (success) {
+		signal_handler_t *sh =
+			obs_output_get_signal_handler(stream->output);
+		struct calldata params = {0};
+
+		info("Saved replay to '%s'", path.array);
+
+		pthread_mutex_lock(&stream->mutex);
+		dstr_copy_dstr(&stream->last_replay, &path);
+		pthread_mutex_unlock(&stream->mutex);
+
+		calldata_set_ptr(&params, "output", stream->output);
+		calldata_set_string(&params, "path", path.array);
+		signal_handler_signal(sh, "saved", &params);
+		calldata_free(&params);
+	} else {
+		warn("Failed to save replay to '%s'", path.array);
+	}
+
+	dstr_free(&path);
+	os_atomic_set_bool(&stream->saving, false);
+	return NULL;
+}
+
+/* finds the last keyframe at least 'seconds' before the newest packet, or
+ * the start of the buffer if it doesn't go back that far */
+static size_t replay_start_index(struct ffmpeg_muxer *stream, int64_t seconds)
+{
+	struct encoder_packet *last;
+	int64_t start_usec;
+	size_t start = 0;
+
+	if (!stream->packets.num || seconds <= 0)
+		return 0;
+
+	last = da_end(stream->packets);
+	start_usec = last->dts_usec - seconds * 1000000LL;
+
+	for (size_t i = 0; i < stream->packets.num; i++) {
+		struct encoder_packet *packet = stream->packets.array + i;
+
+		if (!is_keyframe(packet))
+			continue;
+		if (packet->dts_usec > start_usec)
+			break;
+
+		start = i;
+	}
+
+	return start;
+}
+
+static bool replay_buffer_save(struct ffmpeg_muxer *stream, int64_t seconds)
+{
+	size_t start;
+	size_t num;
+
+	if (!active(stream))
+		return false;
+
+	/* set and checked in one step, so of two saves requested at the same
+	 * time only one gets past here */
+	if (os_atomic_set_bool(&stream->saving, true)) {
+		warn("A replay is already being saved");
+		return false;
+	}
+
+	if (stream->save_thread_active) {
+		pthread_join(stream->save_thread, NULL);
+		stream->save_thread_active = false;
+	}
+
+	pthread_mutex_lock(&stream->mutex);
+
+	start = replay_start_index(stream, seconds);
+	num = stream->packets.num - start;
+
+	da_resize(stream->save_packets, num);
+	for (size_t i = 0; i < num; i++)
+		obs_duplicate_encoder_packet(stream->save_packets.array + i,
+				stream->packets.array + start + i);
+
+	pthread_mutex_unlock(&stream->mutex);
+
+	if (!num) {
+		warn("Nothing has been buffered yet");
+		os_atomic_set_bool(&stream->saving, false);
+		return false;
+	}
+
+	if (pthread_create(&stream->save_thread, NULL,
+				replay_buffer_save_thread, stream) != 0) {
+		warn("Failed to create save thread");
+		free_packets(stream->save_packets.array, num);
+		stream->save_packets.num = 0;
+		os_atomic_set_bool(&stream->saving, false);
+		return false;
+	}
+
+	stream->save_thread_active = true;
+	return true;
+}
+
+static void replay_buffer_save_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_muxer *stream = data;
+	replay_buffer_save(stream, calldata_int(cd, "seconds"));
+}
+
+static void get_last_replay_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_muxer *stream = data;
+
+	pthread_mutex_lock(&stream->mutex);
+	calldata_set_string(cd, "path", stream->last_replay.array);
+	pthread_mutex_unlock(&stream->mutex);
+}
+
+static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	signal_handler_t *sh = obs_output_get_signal_handler(output);
+
+	stream->output = output;
+	pthread_mutex_init(&stream->mutex, NULL);
+
+	proc_handler_add(ph, "void save(in int seconds)",
+			replay_buffer_save_proc, stream);
+	proc_handler_add(ph, "void get_last_replay(out string path)",
+			get_last_replay_proc, stream);
+	signal_handler_add(sh, "void saved(ptr output, string path)");
+
+	UNUSED_PARAMETER(settings);
+	return stream;
+}
+
+static bool replay_buffer_start(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+	obs_data_t *settings;
+
+	if (!obs_output_can_begin_data_capture(stream->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(stream->output, 0))
+		return false;
+
+	settings = obs_output_get_settings(stream->output);
+	stream->max_time = obs_data_get_int(settings, "max_time_sec") *
+		1000000LL;
+	stream->max_size = obs_data_get_int(settings, "max_size_mb") *
+		(1024 * 1024);
+	obs_data_release(settings);
+
+	os_atomic_set_bool(&stream->active, true);
+	os_atomic_set_bool(&stream->capturing, true);
+	obs_output_begin_data_capture(stream->output, 0);
+
+	info("Buffering up to %d seconds or %d MB of replay",
+			(int)(stream->max_time / 1000000LL),
+			(int)(stream->max_size / (1024 * 1024)));
+	return true;
+}
+
+static void replay_buffer_deactivate(struct ffmpeg_muxer *stream)
+{
+	pthread_mutex_lock(&stream->mutex);
+	replay_buffer_clear(stream);
+	pthread_mutex_unlock(&stream->mutex);
+
+	os_atomic_set_bool(&stream->active, false);
+	os_atomic_set_bool(&stream->stopping, false);
+	obs_output_end_data_capture(stream->output);
+
+	info("Replay buffer stopped");
+}
+
+static inline size_t next_keyframe(struct ffmpeg_muxer *stream, size_t idx)
+{
+	for (; idx < stream->packets.num; idx++) {
+		if (is_keyframe(stream->packets.array + idx))
+			return idx;
+	}
+
+	return DARRAY_INVALID;
+}
+
+/* drops the oldest keyframe interval while the rest of the buffer still
+ * covers max_time, or while the buffer is bigger than max_size.  the
+ * newest interval is always kept */
+static void replay_buffer_purge(struct ffmpeg_muxer *stream,
+		int64_t newest_usec)
+{
+	for (;;) {
+		size_t idx = next_keyframe(stream, 1);
+
+		if (idx == DARRAY_INVALID)
+			break;
+
+		if (stream->cur_size <= stream->max_size &&
+		    newest_usec - stream->packets.array[idx].dts_usec <
+				stream->max_time)
+			break;
+
+		for (size_t i = 0; i < idx; i++)
+			stream->cur_size -= (int64_t)stream->packets.array[i].size;
+
+		free_packets(stream->packets.array, idx);
+		da_erase_range(stream->packets, 0, idx);
+	}
+}
+
+static void replay_buffer_data(void *data, struct encoder_packet *packet)
+{
+	struct ffmpeg_muxer *stream = data;
+	struct encoder_packet pkt;
+
+	if (!active(stream))
+		return;
+
+	if (stopping(stream) && packet->sys_dts_usec >= stream->stop_ts) {
+		replay_buffer_deactivate(stream);
+		return;
+	}
+
+	/* packets are only ever added or removed on this thread, so the
+	 * buffer can be checked without locking */
+	if (!stream->packets.num && !is_keyframe(packet))
+		return;
+
+	obs_duplicate_encoder_packet(&pkt, packet);
+
+	pthread_mutex_lock(&stream->mutex);
+
+	da_push_back(stream->packets, &pkt);
+	stream->cur_size += (int64_t)pkt.size;
+
+	if (is_keyframe(&pkt) || stream->cur_size > stream->max_size)
+		replay_buffer_purge(stream, pkt.dts_usec);
+
+	pthread_mutex_unlock(&stream->mutex);
+}
+
+static void replay_buffer_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_string(settings, "prefix", "Replay");
+	obs_data_set_default_string(settings, "extension", "mkv");
+	obs_data_set_default_int(settings, "max_time_sec", 20);
+	obs_data_set_default_int(settings, "max_size_mb", 512);
+}
+
+static obs_properties_t *replay_buffer_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_path(props, "directory",
+			obs_module_text("ReplayBuffer.Directory"),
+			OBS_PATH_DIRECTORY, NULL, NULL);
+	obs_properties_add_text(props, "prefix",
+			obs_module_text("ReplayBuffer.Prefix"),
+			OBS_TEXT_DEFAULT);
+	obs_properties_add_text(props, "extension",
+			obs_module_text("ReplayBuffer.Extension"),
+			OBS_TEXT_DEFAULT);
+	obs_properties_add_int(props, "max_time_sec",
+			obs_module_text("ReplayBuffer.MaxTime"), 1, 21600, 1);
+	obs_properties_add_int(props, "max_size_mb",
+			obs_module_text("ReplayBuffer.MaxSize"), 1, 16384, 1);
+	return props;
+}
+
+struct obs_output_info replay_buffer = {
+	.id             = "replay_buffer",
+	.flags          = OBS_OUTPUT_AV |
+	                  OBS_OUTPUT_ENCODED |
+	                  OBS_OUTPUT_MULTI_TRACK,
+	.get_name       = replay_buffer_getname,
+	.create         = replay_buffer_create,
+	.destroy        = replay_buffer_destroy,
+	.start          = replay_buffer_start,
+	.stop           = ffmpeg_mux_stop,
+	.encoded_packet = replay_buffer_data,
+	.get_defaults   = replay_buffer_defaults,
+	.get_properties = replay_buffer_properties
+};
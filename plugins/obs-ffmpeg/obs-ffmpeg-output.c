@@ -643,6 +643,18 @@ static inline void copy_data(AVPicture *pic, const struct video_data *frame,
 	}
 }
 
+/* libavcodec makes its own copy of non-refcounted frames that it needs to
+ * keep, so frames that don't need scaling can be encoded from the video
+ * output's buffer directly rather than being copied to dst_picture first */
+static inline void use_frame_data(AVFrame *vframe,
+		const struct video_data *frame)
+{
+	for (int plane = 0; plane < MAX_AV_PLANES; plane++) {
+		vframe->data[plane]     = frame->data[plane];
+		vframe->linesize[plane] = (int)frame->linesize[plane];
+	}
+}
+
 static void receive_video(void *param, struct video_data *frame)
 {
 	struct ffmpeg_output *output = param;
@@ -663,15 +675,19 @@ static void receive_video(void *param, struct video_data *frame)
 	if (!data->start_timestamp)
 		data->start_timestamp = frame->timestamp;
 
+	bool raw_picture = (data->output->flags & AVFMT_RAWPICTURE) != 0;
+
 	if (!!data->swscale)
 		sws_scale(data->swscale, (const uint8_t *const *)frame->data,
 				(const int*)frame->linesize,
 				0, data->config.height, data->dst_picture.data,
 				data->dst_picture.linesize);
-	else
+	else if (raw_picture)
 		copy_data(&data->dst_picture, frame, context->height);
+	else
+		use_frame_data(data->vframe, frame);
 
-	if (data->output->flags & AVFMT_RAWPICTURE) {
+	if (raw_picture) {
 		packet.flags        |= AV_PKT_FLAG_KEY;
 		packet.stream_index  = data->video->index;
 		packet.data          = data->dst_picture.data[0];
@@ -686,6 +702,8 @@ static void receive_video(void *param, struct video_data *frame)
 		data->vframe->pts = data->total_frames;
 		ret = avcodec_encode_video2(context, &packet, data->vframe,
 				&got_packet);
+		*((AVPicture*)data->vframe) = data->dst_picture;
+
 		if (ret < 0) {
 			blog(LOG_WARNING, "receive_video: Error encoding "
 			                  "video: %s", av_err2str(ret));
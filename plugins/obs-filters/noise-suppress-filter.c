@@ -2,6 +2,10 @@
 #include <inttypes.h>
 
 #include <util/circlebuf.h>
+#include <util/threading.h>
+#include <util/task-pool.h>
+#include <util/platform.h>
+#include <media-io/audio-math.h>
 #include <obs-module.h>
 #include <speex/speex_preprocess.h>
 
@@ -23,9 +27,11 @@
 /* -------------------------------------------------------- */
 
 #define S_SUPPRESS_LEVEL                "suppress_level"
+#define S_USE_THREAD                    "use_thread"
 
 #define MT_ obs_module_text
 #define TEXT_SUPPRESS_LEVEL             MT_("NoiseSuppress.SuppressLevel")
+#define TEXT_USE_THREAD                 MT_("NoiseSuppress.UseThread")
 
 #define MAX_PREPROC_CHANNELS            2
 
@@ -36,10 +42,17 @@ struct noise_suppress_data {
 	int suppress_level;
 
 	uint64_t last_timestamp;
+	uint32_t sample_rate;
 
 	size_t frames;
 	size_t channels;
 
+	/* mutex protects the buffers below, which are shared with the worker
+	 * thread.  process_mutex is held while the speex states and the
+	 * segment buffers are in use */
+	pthread_mutex_t mutex;
+	pthread_mutex_t process_mutex;
+
 	struct circlebuf info_buffer;
 	struct circlebuf input_buffers[MAX_PREPROC_CHANNELS];
 	struct circlebuf output_buffers[MAX_PREPROC_CHANNELS];
@@ -51,6 +64,22 @@ struct noise_suppress_data {
 	float *copy_buffers[MAX_PREPROC_CHANNELS];
 	spx_int16_t *segment_buffers[MAX_PREPROC_CHANNELS];
 
+	/* processes the channels in parallel, if there's more than one */
+	task_pool_t *pool;
+
+	/* frames received and returned since the last reset, used to hold the
+	 * output back by a fixed amount when using the worker thread */
+	size_t frames_in;
+	size_t frames_out;
+	long reset_count;
+
+	/* worker thread */
+	bool use_thread;
+	bool thread_active;
+	volatile bool thread_stop;
+	os_sem_t *thread_sem;
+	pthread_t thread;
+
 	/* output data */
 	struct obs_audio_data output_audio;
 	DARRAY(float) output_data;
@@ -61,11 +90,10 @@ struct noise_suppress_data {
 #define SUP_MIN -60
 #define SUP_MAX 0
 
-static const float c_32_to_16 = (float)INT16_MAX;
-static const float c_16_to_32 = ((float)INT16_MAX + 1.0f);
-
 /* -------------------------------------------------------- */
 
+static void start_thread(struct noise_suppress_data *ng);
+
 static const char *noise_suppress_name(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -76,6 +104,15 @@ static void noise_suppress_destroy(void *data)
 {
 	struct noise_suppress_data *ng = data;
 
+	if (ng->thread_active) {
+		os_atomic_set_bool(&ng->thread_stop, true);
+		os_sem_post(ng->thread_sem);
+		pthread_join(ng->thread, NULL);
+	}
+
+	os_sem_destroy(ng->thread_sem);
+	task_pool_destroy(ng->pool);
+
 	for (size_t i = 0; i < ng->channels; i++) {
 		speex_preprocess_state_destroy(ng->states[i]);
 		circlebuf_free(&ng->input_buffers[i]);
@@ -86,6 +123,8 @@ static void noise_suppress_destroy(void *data)
 	bfree(ng->copy_buffers[0]);
 	circlebuf_free(&ng->info_buffer);
 	da_free(ng->output_data);
+	pthread_mutex_destroy(&ng->process_mutex);
+	pthread_mutex_destroy(&ng->mutex);
 	bfree(ng);
 }
 
@@ -110,9 +149,18 @@ static void noise_suppress_update(void *data, obs_data_t *s)
 	ng->suppress_level = (int)obs_data_get_int(s, S_SUPPRESS_LEVEL);
 
 	/* Process 10 millisecond segments to keep latency low */
+	ng->sample_rate = sample_rate;
 	ng->frames = frames;
 	ng->channels = channels;
 
+	pthread_mutex_lock(&ng->mutex);
+	ng->use_thread = obs_data_get_bool(s, S_USE_THREAD);
+	pthread_mutex_unlock(&ng->mutex);
+
+	/* The thread is kept once started, it just idles when not in use */
+	if (ng->use_thread && !ng->thread_active)
+		start_thread(ng);
+
 	/* Ignore if already allocated */
 	if (ng->states[0])
 		return;
@@ -128,6 +176,9 @@ static void noise_suppress_update(void *data, obs_data_t *s)
 
 	for (size_t i = 0; i < channels; i++)
 		alloc_channel(ng, sample_rate, i, frames);
+
+	if (channels > 1 && os_get_logical_cores() > 1)
+		ng->pool = task_pool_create("noise suppress", channels - 1);
 }
 
 static void *noise_suppress_create(obs_data_t *settings, obs_source_t *filter)
@@ -136,43 +187,106 @@ static void *noise_suppress_create(obs_data_t *settings, obs_source_t *filter)
 		bzalloc(sizeof(struct noise_suppress_data));
 
 	ng->context = filter;
+
+	pthread_mutex_init_value(&ng->mutex);
+	pthread_mutex_init_value(&ng->process_mutex);
+	if (pthread_mutex_init(&ng->mutex, NULL) != 0 ||
+	    pthread_mutex_init(&ng->process_mutex, NULL) != 0 ||
+	    os_sem_init(&ng->thread_sem, 0) != 0) {
+		noise_suppress_destroy(ng);
+		return NULL;
+	}
+
 	noise_suppress_update(ng, settings);
 	return ng;
 }
 
-static inline void process(struct noise_suppress_data *ng)
+static void process_channel(void *data, size_t channel)
 {
+	struct noise_suppress_data *ng = data;
+
+	speex_preprocess_ctl(ng->states[channel],
+			SPEEX_PREPROCESS_SET_NOISE_SUPPRESS,
+			&ng->suppress_level);
+
+	audio_float_to_s16(ng->segment_buffers[channel],
+			ng->copy_buffers[channel], ng->frames);
+	speex_preprocess_run(ng->states[channel],
+			ng->segment_buffers[channel]);
+	audio_s16_to_float(ng->copy_buffers[channel],
+			ng->segment_buffers[channel], ng->frames);
+}
+
+/* processes one 10ms segment if there's one buffered, must be called with
+ * process_mutex held */
+static bool process(struct noise_suppress_data *ng)
+{
+	size_t segment_size = ng->frames * sizeof(float);
+	long reset_count;
+
 	/* Pop from input circlebuf */
-	for (size_t i = 0; i < ng->channels; i++)
-		circlebuf_pop_front(&ng->input_buffers[i], ng->copy_buffers[i],
-				ng->frames * sizeof(float));
+	pthread_mutex_lock(&ng->mutex);
 
-	/* Set args */
-	for (size_t i = 0; i < ng->channels; i++)
-		speex_preprocess_ctl(ng->states[i],
-				SPEEX_PREPROCESS_SET_NOISE_SUPPRESS,
-				&ng->suppress_level);
+	if (ng->input_buffers[0].size < segment_size) {
+		pthread_mutex_unlock(&ng->mutex);
+		return false;
+	}
 
-	/* Convert to 16bit */
 	for (size_t i = 0; i < ng->channels; i++)
-		for (size_t j = 0; j < ng->frames; j++)
-			ng->segment_buffers[i][j] = (spx_int16_t)
-				(ng->copy_buffers[i][j] * c_32_to_16);
+		circlebuf_pop_front(&ng->input_buffers[i], ng->copy_buffers[i],
+				segment_size);
+
+	reset_count = ng->reset_count;
+	pthread_mutex_unlock(&ng->mutex);
 
 	/* Execute */
-	for (size_t i = 0; i < ng->channels; i++)
-		speex_preprocess_run(ng->states[i], ng->segment_buffers[i]);
+	if (ng->pool)
+		task_pool_run(ng->pool, process_channel, ng, ng->channels);
+	else
+		for (size_t i = 0; i < ng->channels; i++)
+			process_channel(ng, i);
+
+	/* Push to output circlebuf, unless the data was reset meanwhile */
+	pthread_mutex_lock(&ng->mutex);
+
+	if (reset_count == ng->reset_count) {
+		for (size_t i = 0; i < ng->channels; i++)
+			circlebuf_push_back(&ng->output_buffers[i],
+					ng->copy_buffers[i], segment_size);
+	}
 
-	/* Convert back to 32bit */
-	for (size_t i = 0; i < ng->channels; i++)
-		for (size_t j = 0; j < ng->frames; j++)
-			ng->copy_buffers[i][j] =
-				(float)ng->segment_buffers[i][j] / c_16_to_32;
+	pthread_mutex_unlock(&ng->mutex);
+	return true;
+}
 
-	/* Push to output circlebuf */
-	for (size_t i = 0; i < ng->channels; i++)
-		circlebuf_push_back(&ng->output_buffers[i], ng->copy_buffers[i],
-				ng->frames * sizeof(float));
+static void *noise_suppress_thread(void *data)
+{
+	struct noise_suppress_data *ng = data;
+
+	os_set_thread_name("noise suppress: worker thread");
+
+	while (os_sem_wait(ng->thread_sem) == 0) {
+		if (os_atomic_load_bool(&ng->thread_stop))
+			break;
+
+		pthread_mutex_lock(&ng->process_mutex);
+		while (process(ng));
+		pthread_mutex_unlock(&ng->process_mutex);
+	}
+
+	return NULL;
+}
+
+static void start_thread(struct noise_suppress_data *ng)
+{
+	if (pthread_create(&ng->thread, NULL, noise_suppress_thread, ng) != 0) {
+		warn("Failed to create worker thread");
+		return;
+	}
+
+	ng->thread_active = true;
+	info("Processing on a worker thread, adds %d ms of latency",
+			(int)(ng->frames * 1000 / ng->sample_rate));
 }
 
 struct ng_audio_info {
@@ -185,6 +299,7 @@ static inline void clear_circlebuf(struct circlebuf *buf)
 	circlebuf_pop_front(buf, NULL, buf->size);
 }
 
+/* must be called with mutex held */
 static void reset_data(struct noise_suppress_data *ng)
 {
 	for (size_t i = 0; i < ng->channels; i++) {
@@ -193,6 +308,40 @@ static void reset_data(struct noise_suppress_data *ng)
 	}
 
 	clear_circlebuf(&ng->info_buffer);
+
+	ng->frames_in  = 0;
+	ng->frames_out = 0;
+	ng->reset_count++;
+}
+
+/* gets the timestamp of the next frame to output and removes the given
+ * number of frames from the packet info, which may end partway through a
+ * packet */
+static uint64_t pop_info(struct noise_suppress_data *ng, size_t frames)
+{
+	struct ng_audio_info info;
+	uint64_t timestamp;
+
+	circlebuf_peek_front(&ng->info_buffer, &info, sizeof(info));
+	timestamp = info.timestamp;
+
+	while (frames) {
+		circlebuf_peek_front(&ng->info_buffer, &info, sizeof(info));
+
+		if (info.frames > frames) {
+			info.timestamp += (uint64_t)frames * 1000000000ULL /
+				ng->sample_rate;
+			info.frames    -= (uint32_t)frames;
+			circlebuf_place(&ng->info_buffer, 0, &info,
+					sizeof(info));
+			break;
+		}
+
+		frames -= info.frames;
+		circlebuf_pop_front(&ng->info_buffer, NULL, sizeof(info));
+	}
+
+	return timestamp;
 }
 
 static struct obs_audio_data *noise_suppress_filter_audio(void *data,
@@ -200,12 +349,15 @@ static struct obs_audio_data *noise_suppress_filter_audio(void *data,
 {
 	struct noise_suppress_data *ng = data;
 	struct ng_audio_info info;
-	size_t segment_size = ng->frames * sizeof(float);
-	size_t out_size;
+	size_t latency;
+	size_t frames;
+	bool threaded;
 
 	if (!ng->states[0])
 		return audio;
 
+	pthread_mutex_lock(&ng->mutex);
+
 	/* -----------------------------------------------
 	 * if timestamp has dramatically changed, consider it a new stream of
 	 * audio data.  clear all circular buffers to prevent old audio data
@@ -232,44 +384,65 @@ static struct obs_audio_data *noise_suppress_filter_audio(void *data,
 		circlebuf_push_back(&ng->input_buffers[i], audio->data[i],
 				audio->frames * sizeof(float));
 
-	/* -----------------------------------------------
-	 * pop/process each 10ms segments, push back to output circlebuf */
-	while (ng->input_buffers[0].size >= segment_size)
-		process(ng);
+	ng->frames_in += audio->frames;
+	threaded = ng->use_thread && ng->thread_active;
+
+	pthread_mutex_unlock(&ng->mutex);
 
 	/* -----------------------------------------------
-	 * peek front of info circlebuf, check to see if we have enough to
-	 * pop the expected packet size, if not, return null */
-	memset(&info, 0, sizeof(info));
-	circlebuf_peek_front(&ng->info_buffer, &info, sizeof(info));
-	out_size = info.frames * sizeof(float);
+	 * pop/process each 10ms segments, push back to output circlebuf.
+	 * the worker thread works one segment ahead of the output instead,
+	 * so the output is held back by a segment to give it time */
+	if (threaded) {
+		os_sem_post(ng->thread_sem);
+		latency = ng->frames;
+	} else {
+		pthread_mutex_lock(&ng->process_mutex);
+		while (process(ng));
+		pthread_mutex_unlock(&ng->process_mutex);
+		latency = 0;
+	}
 
-	if (ng->output_buffers[0].size < out_size)
+	/* -----------------------------------------------
+	 * return whatever has been processed, as long as it was received at
+	 * least the latency ago.  output that's running behind is caught up
+	 * by returning more than one packet's worth at once */
+	pthread_mutex_lock(&ng->mutex);
+
+	frames = ng->output_buffers[0].size / sizeof(float);
+	if (ng->frames_in < ng->frames_out + latency)
+		frames = 0;
+	else if (frames > ng->frames_in - latency - ng->frames_out)
+		frames = ng->frames_in - latency - ng->frames_out;
+
+	if (!frames) {
+		pthread_mutex_unlock(&ng->mutex);
 		return NULL;
+	}
 
-	/* -----------------------------------------------
-	 * if there's enough audio data buffered in the output circlebuf,
-	 * pop and return a packet */
-	circlebuf_pop_front(&ng->info_buffer, NULL, sizeof(info));
-	da_resize(ng->output_data, out_size * ng->channels);
+	da_resize(ng->output_data, frames * ng->channels);
 
 	for (size_t i = 0; i < ng->channels; i++) {
 		ng->output_audio.data[i] =
-			(uint8_t*)&ng->output_data.array[i * out_size];
+			(uint8_t*)&ng->output_data.array[i * frames];
 
 		circlebuf_pop_front(&ng->output_buffers[i],
 				ng->output_audio.data[i],
-				out_size);
+				frames * sizeof(float));
 	}
 
-	ng->output_audio.frames = info.frames;
-	ng->output_audio.timestamp = info.timestamp;
+	ng->output_audio.frames = (uint32_t)frames;
+	ng->output_audio.timestamp = pop_info(ng, frames);
+	ng->frames_out += frames;
+
+	pthread_mutex_unlock(&ng->mutex);
 	return &ng->output_audio;
 }
 
 static void noise_suppress_defaults(obs_data_t *s)
 {
 	obs_data_set_default_int(s, S_SUPPRESS_LEVEL, -30);
+	obs_data_set_default_bool(s, S_USE_THREAD, false);
 }
 
 static obs_properties_t *noise_suppress_properties(void *data)
@@ -278,6 +451,7 @@ static obs_properties_t *noise_suppress_properties(void *data)
 
 	obs_properties_add_int_slider(ppts, S_SUPPRESS_LEVEL,
 			TEXT_SUPPRESS_LEVEL, SUP_MIN, SUP_MAX, 0);
+	obs_properties_add_bool(ppts, S_USE_THREAD, TEXT_USE_THREAD);
 
 	UNUSED_PARAMETER(data);
 	return ppts;
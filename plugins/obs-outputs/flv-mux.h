@@ -21,6 +21,12 @@
 
 #define MILLISECOND_DEN   1000
 
+/* maximum size of the bytes that precede the packet data in a tag body */
+#define FLV_BODY_HEADER_MAX 5
+
+/* size of the tag header plus the trailing tag size field */
+#define FLV_TAG_OVERHEAD  (11 + 4)
+
 static uint32_t get_ms_time(struct encoder_packet *packet, int64_t val)
 {
 	return (uint32_t)(val * MILLISECOND_DEN / packet->timebase_den);
@@ -32,3 +38,5 @@ extern bool flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 		bool write_header, size_t audio_idx);
 extern void flv_packet_mux(struct encoder_packet *packet,
 		uint8_t **output, size_t *size, bool is_header);
+extern size_t flv_packet_body_header(struct encoder_packet *packet,
+		bool is_header, uint8_t *header);
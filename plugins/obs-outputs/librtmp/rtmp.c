@@ -3912,18 +3912,19 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
-int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+/* Encodes the chunk header of a message so that it ends at hend,
+ * compressing it against the previous message sent on the same channel.
+ * Returns the header size, or -1 on failure. */
+static int
+EncodePacketHeader(RTMP *r, RTMPPacket *packet, char *hend, char **pheader,
+                   int *pcSize, char *pc)
 {
     const RTMPPacket *prevPacket;
     uint32_t last = 0;
     int nSize;
     int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *header, *hptr, c;
     uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -3934,7 +3935,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
             free(r->m_vecChannelsOut);
             r->m_vecChannelsOut = NULL;
             r->m_channelsAllocatedOut = 0;
-            return FALSE;
+            return -1;
         }
         r->m_vecChannelsOut = packets;
         memset(r->m_vecChannelsOut + r->m_channelsAllocatedOut, 0, sizeof(RTMPPacket*) * (n - r->m_channelsAllocatedOut));
@@ -3960,24 +3961,14 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     {
         RTMP_Log(RTMP_LOGERROR, "sanity failed!! trying to send header of type: 0x%02x.",
                  (unsigned char)packet->m_headerType);
-        return FALSE;
+        return -1;
     }
 
     nSize = packetSize[packet->m_headerType];
     hSize = nSize;
     cSize = 0;
     t = packet->m_nTimeStamp - last;
-
-    if (packet->m_body)
-    {
-        header = packet->m_body - nSize;
-        hend = packet->m_body;
-    }
-    else
-    {
-        header = hbuf + 6;
-        hend = hbuf + sizeof(hbuf);
-    }
+    header = hend - nSize;
 
     if (packet->m_nChannel > 319)
         cSize = 2;
@@ -4034,6 +4025,28 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     if (nSize > 1 && t >= 0xffffff)
         hptr = AMF_EncodeInt32(hptr, hend, t);
 
+    *pheader = header;
+    *pcSize = cSize;
+    *pc = c;
+    return hSize;
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    int nSize;
+    int hSize, cSize;
+    char *header, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    hSize = EncodePacketHeader(r, packet,
+                               packet->m_body ? packet->m_body : hbuf + sizeof(hbuf),
+                               &header, &cSize, &c);
+    if (hSize < 0)
+        return FALSE;
+
     nSize = packet->m_nBodySize;
     buffer = packet->m_body;
     nChunkSize = r->m_outChunkSize;
@@ -4129,6 +4142,263 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     return TRUE;
 }
 
+#define RTMP_MAX_IOV 64
+
+#ifdef _WIN32
+typedef WSABUF RTMPIOVec;
+#define RTMP_IOV_SET(v, p, l)	((v).buf = (CHAR *)(p), (v).len = (ULONG)(l))
+#define RTMP_IOV_BASE(v)	((char *)(v).buf)
+#define RTMP_IOV_LEN(v)	((int)(v).len)
+#else
+typedef struct iovec RTMPIOVec;
+#define RTMP_IOV_SET(v, p, l)	((v).iov_base = (void *)(p), (v).iov_len = (size_t)(l))
+#define RTMP_IOV_BASE(v)	((char *)(v).iov_base)
+#define RTMP_IOV_LEN(v)	((int)(v).iov_len)
+#endif
+
+/* scatter-gather writes only work when the data goes straight to the
+ * socket without being encrypted or wrapped first */
+static int
+CanWriteV(RTMP *r)
+{
+#ifdef RTMP_NETSTACK_DUMP
+    return FALSE;
+#endif
+    if (r->Link.protocol & RTMP_FEATURE_HTTP)
+        return FALSE;
+    if (r->m_bCustomSend && r->m_customSendFunc)
+        return FALSE;
+    if (r->m_sb.sb_ssl)
+        return FALSE;
+#ifdef CRYPTO
+    if (r->Link.rc4keyOut)
+        return FALSE;
+#endif
+    return TRUE;
+}
+
+static int
+WriteV(RTMP *r, RTMPIOVec *iov, int count)
+{
+    while (count > 0)
+    {
+        int nBytes;
+#ifdef _WIN32
+        DWORD sent = 0;
+        nBytes = WSASend(r->m_sb.sb_socket, iov, (DWORD)count, &sent, 0,
+                         NULL, NULL) == 0 ? (int)sent : -1;
+#else
+        nBytes = (int)writev(r->m_sb.sb_socket, iov, count);
+#endif
+
+        if (nBytes < 0)
+        {
+            int sockerr = GetSockError();
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d", __FUNCTION__,
+                     sockerr);
+
+            if (sockerr == EINTR && !RTMP_ctrlC)
+                continue;
+
+            RTMP_Close(r);
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+            return FALSE;
+
+        /* skip what was sent, resume partial writes mid-buffer */
+        while (count > 0 && nBytes >= RTMP_IOV_LEN(*iov))
+        {
+            nBytes -= RTMP_IOV_LEN(*iov);
+            iov++;
+            count--;
+        }
+        if (count > 0 && nBytes > 0)
+            RTMP_IOV_SET(*iov, RTMP_IOV_BASE(*iov) + nBytes,
+                         RTMP_IOV_LEN(*iov) - nBytes);
+    }
+
+    return TRUE;
+}
+
+static int
+FlushIOV(RTMP *r, RTMPIOVec *iov, int count)
+{
+    char buf[RTMP_BUFFER_CACHE_SIZE];
+    int i, len = 0;
+
+    if (!count)
+        return TRUE;
+    if (CanWriteV(r))
+        return WriteV(r, iov, count);
+
+    /* coalesce for the TLS/encrypted paths, which need whole buffers */
+    for (i = 0; i < count; i++)
+    {
+        const char *ptr = RTMP_IOV_BASE(iov[i]);
+        int n = RTMP_IOV_LEN(iov[i]);
+
+        while (n > 0)
+        {
+            int num = (int)sizeof(buf) - len;
+            if (num > n)
+                num = n;
+
+            memcpy(buf + len, ptr, num);
+            len += num;
+            ptr += num;
+            n -= num;
+
+            if (len == (int)sizeof(buf))
+            {
+                if (!WriteN(r, buf, len))
+                    return FALSE;
+                len = 0;
+            }
+        }
+    }
+
+    return len ? WriteN(r, buf, len) : TRUE;
+}
+
+static int
+PushIOV(RTMP *r, RTMPIOVec *iov, int *count, const char *ptr, int len)
+{
+    if (*count == RTMP_MAX_IOV)
+    {
+        if (!FlushIOV(r, iov, *count))
+            return FALSE;
+        *count = 0;
+    }
+
+    RTMP_IOV_SET(iov[*count], ptr, len);
+    (*count)++;
+    return TRUE;
+}
+
+/* copies into the message buffer if there is one, queues a write otherwise */
+static int
+AppendIOV(RTMP *r, RTMPIOVec *iov, int *count, char **toff,
+          const char *ptr, int len)
+{
+    if (*toff)
+    {
+        memcpy(*toff, ptr, len);
+        *toff += len;
+        return TRUE;
+    }
+
+    return PushIOV(r, iov, count, ptr, len);
+}
+
+/* Sends an audio/video message whose body is made up of several buffers.
+ * The chunk headers are built on the stack and sent together with the
+ * body buffers, so the body is never copied or reallocated.  Over HTTP
+ * every write is a separate request, so there the whole message is copied
+ * into one buffer and sent in one request, like RTMP_SendPacket does. */
+int
+RTMP_WriteMessage(RTMP *r, int packetType, uint32_t timestamp,
+                  const AVal *body, int count, int streamIdx)
+{
+    RTMPPacket packet = {0};
+    RTMPIOVec iov[RTMP_MAX_IOV];
+    char hbuf[RTMP_MAX_HEADER_SIZE], cbuf[3];
+    char *header, c;
+    char *tbuf = NULL, *toff = NULL;
+    int hSize, cSize;
+    int nIov = 0, nChunkSize, left, i;
+
+    packet.m_nChannel = 0x04;	/* source channel */
+    packet.m_packetType = packetType;
+    packet.m_nTimeStamp = timestamp;
+    packet.m_nInfoField2 = r->Link.streams[streamIdx].id;
+    packet.m_headerType = timestamp ?
+                          RTMP_PACKET_SIZE_MEDIUM : RTMP_PACKET_SIZE_LARGE;
+
+    for (i = 0; i < count; i++)
+        packet.m_nBodySize += body[i].av_len;
+
+    hSize = EncodePacketHeader(r, &packet, hbuf + sizeof(hbuf),
+                               &header, &cSize, &c);
+    if (hSize < 0)
+        return FALSE;
+
+    cbuf[0] = (0xc0 | c);
+    if (cSize)
+    {
+        int tmp = packet.m_nChannel - 64;
+        cbuf[1] = tmp & 0xff;
+        if (cSize == 2)
+            cbuf[2] = tmp >> 8;
+    }
+
+    RTMP_Log(RTMP_LOGDEBUG2, "%s: fd=%d, size=%d", __FUNCTION__,
+             (int)r->m_sb.sb_socket, (int)packet.m_nBodySize);
+
+    nChunkSize = r->m_outChunkSize;
+    left = nChunkSize;
+
+    if (r->Link.protocol & RTMP_FEATURE_HTTP)
+    {
+        int chunks = ((int)packet.m_nBodySize + nChunkSize - 1) / nChunkSize;
+        int tlen = hSize + (int)packet.m_nBodySize;
+
+        if (chunks > 1)
+            tlen += (chunks - 1) * (cSize + 1);
+
+        tbuf = malloc(tlen);
+        if (!tbuf)
+            return FALSE;
+        toff = tbuf;
+    }
+
+    AppendIOV(r, iov, &nIov, &toff, header, hSize);
+
+    for (i = 0; i < count; i++)
+    {
+        const char *ptr = body[i].av_val;
+        int n = body[i].av_len;
+
+        while (n > 0)
+        {
+            int num;
+
+            if (!left)
+            {
+                if (!AppendIOV(r, iov, &nIov, &toff, cbuf, cSize + 1))
+                    return FALSE;
+                left = nChunkSize;
+            }
+
+            num = n < left ? n : left;
+            if (!AppendIOV(r, iov, &nIov, &toff, ptr, num))
+                return FALSE;
+
+            ptr += num;
+            n -= num;
+            left -= num;
+        }
+    }
+
+    if (tbuf)
+    {
+        int wrote = WriteN(r, tbuf, (int)(toff - tbuf));
+        free(tbuf);
+        if (!wrote)
+            return FALSE;
+    }
+    else if (!FlushIOV(r, iov, nIov))
+    {
+        return FALSE;
+    }
+
+    if (!r->m_vecChannelsOut[packet.m_nChannel])
+        r->m_vecChannelsOut[packet.m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet.m_nChannel], &packet, sizeof(RTMPPacket));
+    return TRUE;
+}
+
 int
 RTMP_Serve(RTMP *r)
 {
@@ -411,6 +411,8 @@ extern "C"
     void RTMP_DropRequest(RTMP *r, int i, int freeit);
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
+    int RTMP_WriteMessage(RTMP *r, int packetType, uint32_t timestamp,
+                          const AVal *body, int count, int streamIdx);
 
     /* hashswf.c */
     int RTMP_HashSWF(const char *url, unsigned int *size, unsigned char *hash,
@@ -0,0 +1,47 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "rtmp-dbr.h"
+
+/* the send thread blocks while the socket buffer is full, so while there is
+ * a backlog the rate at which sends complete is the rate the network drains
+ * the socket buffer */
+long dbr_window_add(struct dbr_window *window, const struct dbr_frame *back)
+{
+	struct dbr_frame front;
+	uint64_t dur;
+
+	circlebuf_push_back(&window->frames, back, sizeof(*back));
+	window->data_size += back->size;
+
+	/* the newest send always stays, even if it alone took longer than
+	 * the window */
+	while (window->frames.size > sizeof(struct dbr_frame)) {
+		circlebuf_peek_front(&window->frames, &front, sizeof(front));
+		if (back->send_end - front.send_beg < DBR_WINDOW_NS)
+			break;
+
+		circlebuf_pop_front(&window->frames, NULL, sizeof(front));
+		window->data_size -= front.size;
+	}
+
+	circlebuf_peek_front(&window->frames, &front, sizeof(front));
+	dur = back->send_end - front.send_beg;
+
+	return dur >= DBR_MIN_WINDOW_NS ?
+		(long)(window->data_size * 8 * 1000000ULL / dur) : 0;
+}
@@ -0,0 +1,47 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/circlebuf.h>
+
+/* throughput is measured over the last second of sends, and is not
+ * estimated until at least a quarter second of sends has been seen */
+#define DBR_WINDOW_NS        1000000000ULL
+#define DBR_MIN_WINDOW_NS    250000000ULL
+
+struct dbr_frame {
+	uint64_t         send_beg;
+	uint64_t         send_end;
+	size_t           size;
+};
+
+struct dbr_window {
+	struct circlebuf frames;
+	size_t           data_size;
+};
+
+/* adds a completed send to the window and returns the estimated kbps, or 0
+ * if the window is still too short to estimate */
+extern long dbr_window_add(struct dbr_window *window,
+		const struct dbr_frame *frame);
+
+static inline void dbr_window_free(struct dbr_window *window)
+{
+	circlebuf_free(&window->frames);
+	window->data_size = 0;
+}
@@ -25,6 +25,7 @@
 #include "librtmp/rtmp.h"
 #include "librtmp/log.h"
 #include "flv-mux.h"
+#include "rtmp-dbr.h"
 #include "net-if.h"
 
 #ifdef _WIN32
@@ -33,6 +34,10 @@
 #include <sys/ioctl.h>
 #endif
 
+#ifdef __linux__
+#include <netinet/tcp.h>
+#endif
+
 #define do_log(level, format, ...) \
 	blog(level, "[rtmp stream: '%s'] " format, \
 			obs_output_get_name(stream->output), ##__VA_ARGS__)
@@ -44,9 +49,28 @@
 #define OPT_DROP_THRESHOLD "drop_threshold_ms"
 #define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
 #define OPT_BIND_IP "bind_ip"
+#define OPT_CHUNK_SIZE "chunk_size"
+#define OPT_DYN_BITRATE "dyn_bitrate"
+
+#define MIN_CHUNK_SIZE 128
+#define MAX_CHUNK_SIZE 0xFFFFFF
+
+/* dynamic bitrate: the bitrate is lowered when more than DBR_TRIGGER_USEC
+ * of data is waiting to be sent, and raised back in steps once the backlog
+ * is gone */
+#define DBR_HOLD_NS          2000000000ULL
+#define DBR_INC_TIMER_NS     10000000000ULL
+#define DBR_TRIGGER_USEC     200000LL
 
 //#define TEST_FRAMEDROPS
 
+struct dbr_tcp_info {
+	uint32_t         rtt_usec;
+	uint32_t         cwnd;
+	uint32_t         mss;
+	uint32_t         unacked;
+};
+
 struct rtmp_stream {
 	obs_output_t     *output;
 
@@ -62,6 +86,7 @@ struct rtmp_stream {
 	pthread_t        send_thread;
 
 	int              max_shutdown_time_sec;
+	int              chunk_size;
 
 	os_sem_t         *send_sem;
 	os_event_t       *stop_event;
@@ -82,6 +107,22 @@ struct rtmp_stream {
 	uint64_t         total_bytes_sent;
 	int              dropped_frames;
 
+	/* dynamic bitrate variables, the current values and counters are
+	 * guarded by dbr_mutex so the stats can be read from other threads */
+	bool             dbr_enabled;
+	pthread_mutex_t  dbr_mutex;
+	struct dbr_window dbr_window;
+	long             audio_bitrate;
+	long             dbr_orig_bitrate;
+	long             dbr_cur_bitrate;
+	long             dbr_est_bitrate;
+	uint64_t         dbr_hold_until;
+	uint64_t         dbr_inc_timeout;
+	int64_t          dbr_last_buffer_usec;
+	int              dbr_decreases;
+	int              dbr_increases;
+	struct dbr_tcp_info dbr_tcp;
+
 	RTMP             rtmp;
 };
 
@@ -171,16 +212,24 @@ static void rtmp_stream_destroy(void *data)
 		os_event_destroy(stream->stop_event);
 		os_sem_destroy(stream->send_sem);
 		pthread_mutex_destroy(&stream->packets_mutex);
+		pthread_mutex_destroy(&stream->dbr_mutex);
 		circlebuf_free(&stream->packets);
+		dbr_window_free(&stream->dbr_window);
 		bfree(stream);
 	}
 }
 
+static void get_dbr_stats_proc(void *data, calldata_t *cd);
+
 static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	signal_handler_t *sh = obs_output_get_signal_handler(output);
+
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+	pthread_mutex_init_value(&stream->dbr_mutex);
 
 	RTMP_Init(&stream->rtmp);
 	RTMP_LogSetCallback(log_rtmp);
@@ -188,9 +237,21 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 
 	if (pthread_mutex_init(&stream->packets_mutex, NULL) != 0)
 		goto fail;
+	if (pthread_mutex_init(&stream->dbr_mutex, NULL) != 0)
+		goto fail;
 	if (os_event_init(&stream->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
 
+	proc_handler_add(ph, "void get_dynamic_bitrate_stats("
+			"out bool enabled, out int bitrate, "
+			"out int original_bitrate, out int estimate, "
+			"out int decreases, out int increases, "
+			"out int rtt_ms)",
+			get_dbr_stats_proc, stream);
+	signal_handler_add(sh, "void dynamic_bitrate_changed(ptr output, "
+			"int bitrate, int prev_bitrate, int estimate, "
+			"string reason)");
+
 	UNUSED_PARAMETER(settings);
 	return stream;
 
@@ -285,13 +346,284 @@ static bool discard_recv_data(struct rtmp_stream *stream, size_t size)
 	return true;
 }
 
+static inline long encoder_bitrate(obs_encoder_t *encoder)
+{
+	obs_data_t *settings = obs_encoder_get_settings(encoder);
+	long bitrate = (long)obs_data_get_int(settings, "bitrate");
+
+	obs_data_release(settings);
+	return bitrate;
+}
+
+static bool dbr_supported(struct rtmp_stream *stream)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	obs_data_t *settings;
+	const char *rate_control;
+	bool constant_quality;
+
+	if (!vencoder)
+		return false;
+
+	if ((obs_get_encoder_caps(obs_encoder_get_id(vencoder)) &
+				OBS_ENCODER_CAP_DYN_BITRATE) == 0) {
+		info("Dynamic bitrate disabled, video encoder '%s' does not "
+		     "support changing its bitrate while active",
+		     obs_encoder_get_id(vencoder));
+		return false;
+	}
+
+	settings = obs_encoder_get_settings(vencoder);
+	rate_control = obs_data_get_string(settings, "rate_control");
+	constant_quality = astrcmpi(rate_control, "CRF") == 0 ||
+	                   astrcmpi(rate_control, "CQP") == 0;
+	obs_data_release(settings);
+
+	if (constant_quality) {
+		info("Dynamic bitrate disabled, video encoder is not using "
+		     "bitrate-based rate control");
+		return false;
+	}
+
+	return true;
+}
+
+static void dbr_init(struct rtmp_stream *stream)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	obs_encoder_t *aencoder;
+
+	stream->audio_bitrate = 0;
+	for (size_t idx = 0;; idx++) {
+		aencoder = obs_output_get_audio_encoder(stream->output, idx);
+		if (!aencoder)
+			break;
+		stream->audio_bitrate += encoder_bitrate(aencoder);
+	}
+
+	dbr_window_free(&stream->dbr_window);
+	stream->dbr_hold_until       = 0;
+	stream->dbr_inc_timeout      = 0;
+	stream->dbr_last_buffer_usec = 0;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	stream->dbr_orig_bitrate = encoder_bitrate(vencoder);
+	stream->dbr_cur_bitrate  = stream->dbr_orig_bitrate;
+	stream->dbr_est_bitrate  = 0;
+	stream->dbr_decreases    = 0;
+	stream->dbr_increases    = 0;
+	memset(&stream->dbr_tcp, 0, sizeof(stream->dbr_tcp));
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	if (stream->dbr_orig_bitrate <= 0)
+		stream->dbr_enabled = false;
+	else
+		info("Dynamic bitrate enabled, video bitrate: %ld kbps",
+				stream->dbr_orig_bitrate);
+}
+
+static bool dbr_get_tcp_info(struct rtmp_stream *stream,
+		struct dbr_tcp_info *tcp)
+{
+#ifdef __linux__
+	struct tcp_info ti;
+	socklen_t len = sizeof(ti);
+
+	if (getsockopt(stream->rtmp.m_sb.sb_socket, IPPROTO_TCP, TCP_INFO,
+				&ti, &len) != 0)
+		return false;
+
+	tcp->rtt_usec = ti.tcpi_rtt;
+	tcp->cwnd     = ti.tcpi_snd_cwnd;
+	tcp->mss      = ti.tcpi_snd_mss;
+	tcp->unacked  = ti.tcpi_unacked;
+	return true;
+#else
+	UNUSED_PARAMETER(stream);
+	UNUSED_PARAMETER(tcp);
+	return false;
+#endif
+}
+
+static void dbr_add_frame(struct rtmp_stream *stream, struct dbr_frame *frame)
+{
+	long est = dbr_window_add(&stream->dbr_window, frame);
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	stream->dbr_est_bitrate = est;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+}
+
+/* returns the estimated total kbps the connection can carry, or 0 if there
+ * is no estimate yet */
+static long dbr_get_estimate(struct rtmp_stream *stream)
+{
+	struct dbr_tcp_info tcp;
+	long est;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	est = stream->dbr_est_bitrate;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	if (!dbr_get_tcp_info(stream, &tcp))
+		return est;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	stream->dbr_tcp = tcp;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	/* when the whole congestion window is in flight, one window per
+	 * round trip is an upper bound on what the connection can carry */
+	if (tcp.rtt_usec && tcp.unacked >= tcp.cwnd) {
+		long tcp_est = (long)((uint64_t)tcp.cwnd * tcp.mss * 8 *
+				1000 / tcp.rtt_usec);
+		if (!est || tcp_est < est)
+			est = tcp_est;
+	}
+
+	return est;
+}
+
+static void dbr_set_bitrate(struct rtmp_stream *stream, long bitrate,
+		long est, const char *reason)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	signal_handler_t *sh = obs_output_get_signal_handler(stream->output);
+	obs_data_t *settings = obs_data_create();
+	struct calldata params = {0};
+	long prev_bitrate;
+
+	obs_data_set_int(settings, "bitrate", bitrate);
+	obs_encoder_update(vencoder, settings);
+	obs_data_release(settings);
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	prev_bitrate = stream->dbr_cur_bitrate;
+	stream->dbr_cur_bitrate = bitrate;
+	if (bitrate < prev_bitrate)
+		stream->dbr_decreases++;
+	else
+		stream->dbr_increases++;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	info("Dynamic bitrate (%s): video bitrate %ld -> %ld kbps, "
+	     "estimated throughput %ld kbps",
+	     reason, prev_bitrate, bitrate, est);
+
+	calldata_set_ptr(&params, "output", stream->output);
+	calldata_set_int(&params, "bitrate", bitrate);
+	calldata_set_int(&params, "prev_bitrate", prev_bitrate);
+	calldata_set_int(&params, "estimate", est);
+	calldata_set_string(&params, "reason", reason);
+	signal_handler_signal(sh, "dynamic_bitrate_changed", &params);
+	calldata_free(&params);
+}
+
+static int64_t get_buffer_duration_usec(struct rtmp_stream *stream)
+{
+	struct encoder_packet first;
+	int64_t duration = 0;
+
+	pthread_mutex_lock(&stream->packets_mutex);
+	if (stream->packets.size) {
+		circlebuf_peek_front(&stream->packets, &first, sizeof(first));
+		duration = stream->last_dts_usec - first.dts_usec;
+	}
+	pthread_mutex_unlock(&stream->packets_mutex);
+
+	return duration;
+}
+
+static void dbr_check(struct rtmp_stream *stream)
+{
+	int64_t buffer_duration_usec = get_buffer_duration_usec(stream);
+	uint64_t now = os_gettime_ns();
+	long orig = stream->dbr_orig_bitrate;
+	long cur = stream->dbr_cur_bitrate;
+	long min_bitrate = orig / 5;
+	long bitrate, est;
+
+	/* give the encoder time to react before deciding again */
+	if (now < stream->dbr_hold_until)
+		return;
+
+	if (buffer_duration_usec >= DBR_TRIGGER_USEC) {
+		/* the queue still holds data encoded at the old bitrate, only
+		 * lower again if the backlog keeps growing */
+		if (buffer_duration_usec < stream->dbr_last_buffer_usec)
+			return;
+
+		est = dbr_get_estimate(stream);
+		if (!est)
+			return;
+
+		/* leave some headroom so the backlog can drain */
+		bitrate = (est - stream->audio_bitrate) * 9 / 10;
+		if (bitrate > cur - cur / 10)
+			bitrate = cur - cur / 10;
+		if (bitrate < min_bitrate)
+			bitrate = min_bitrate;
+		if (bitrate >= cur)
+			return;
+
+		dbr_set_bitrate(stream, bitrate, est, "congestion");
+		stream->dbr_last_buffer_usec = buffer_duration_usec;
+		stream->dbr_inc_timeout = now + DBR_INC_TIMER_NS;
+		stream->dbr_hold_until = now + DBR_HOLD_NS;
+
+	} else if (stream->dbr_inc_timeout && now >= stream->dbr_inc_timeout &&
+	           buffer_duration_usec < DBR_TRIGGER_USEC / 2) {
+		bitrate = cur + orig / 10;
+		if (bitrate > orig)
+			bitrate = orig;
+
+		dbr_set_bitrate(stream, bitrate, dbr_get_estimate(stream),
+				"recovery");
+		stream->dbr_last_buffer_usec = 0;
+		stream->dbr_inc_timeout = bitrate < orig ?
+			now + DBR_INC_TIMER_NS : 0;
+		stream->dbr_hold_until = now + DBR_HOLD_NS;
+
+	} else if (buffer_duration_usec < DBR_TRIGGER_USEC / 2) {
+		stream->dbr_last_buffer_usec = 0;
+	}
+}
+
+/* puts the encoder back to the user's bitrate once the stream ends, the
+ * encoder settings are shared with the rest of the program */
+static void dbr_restore(struct rtmp_stream *stream)
+{
+	if (stream->dbr_cur_bitrate != stream->dbr_orig_bitrate)
+		dbr_set_bitrate(stream, stream->dbr_orig_bitrate, 0, "restore");
+
+	dbr_window_free(&stream->dbr_window);
+}
+
+static void get_dbr_stats_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_stream *stream = data;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	calldata_set_bool(cd, "enabled", stream->dbr_enabled);
+	calldata_set_int(cd, "bitrate", stream->dbr_cur_bitrate);
+	calldata_set_int(cd, "original_bitrate", stream->dbr_orig_bitrate);
+	calldata_set_int(cd, "estimate", stream->dbr_est_bitrate);
+	calldata_set_int(cd, "decreases", stream->dbr_decreases);
+	calldata_set_int(cd, "increases", stream->dbr_increases);
+	calldata_set_int(cd, "rtt_ms", stream->dbr_tcp.rtt_usec / 1000);
+	pthread_mutex_unlock(&stream->dbr_mutex);
+}
+
 static int send_packet(struct rtmp_stream *stream,
 		struct encoder_packet *packet, bool is_header, size_t idx)
 {
-	uint8_t *data;
-	size_t  size;
-	int     recv_size = 0;
-	int     ret = 0;
+	uint8_t  body_header[FLV_BODY_HEADER_MAX];
+	AVal     body[2];
+	uint32_t time_ms;
+	uint64_t send_beg = 0;
+	size_t   size;
+	int      recv_size = 0;
+	int      ret = 0;
 
 #ifdef _WIN32
 	ret = ioctlsocket(stream->rtmp.m_sb.sb_socket, FIONREAD,
@@ -305,12 +637,41 @@ static int send_packet(struct rtmp_stream *stream,
 			return -1;
 	}
 
-	flv_packet_mux(packet, &data, &size, is_header);
+	if (!packet->data || !packet->size) {
+		obs_free_encoder_packet(packet);
+		return 0;
+	}
+
+	/* the tag body is the FLV body header followed by the packet data,
+	 * both of which are handed to librtmp as-is without being copied */
+	body[0].av_val = (char*)body_header;
+	body[0].av_len = (int)flv_packet_body_header(packet, is_header,
+			body_header);
+	body[1].av_val = (char*)packet->data;
+	body[1].av_len = (int)packet->size;
+
+	time_ms = get_ms_time(packet, packet->dts) & 0x7FFFFFFF;
+	size = FLV_TAG_OVERHEAD + body[0].av_len + packet->size;
+
 #ifdef TEST_FRAMEDROPS
 	os_sleep_ms(rand() % 40);
 #endif
-	ret = RTMP_Write(&stream->rtmp, (char*)data, (int)size, (int)idx);
-	bfree(data);
+	if (stream->dbr_enabled)
+		send_beg = os_gettime_ns();
+
+	ret = RTMP_WriteMessage(&stream->rtmp,
+			packet->type == OBS_ENCODER_VIDEO ?
+				RTMP_PACKET_TYPE_VIDEO : RTMP_PACKET_TYPE_AUDIO,
+			time_ms, body, 2, (int)idx) ? (int)size : -1;
+
+	if (stream->dbr_enabled && !is_header && ret >= 0) {
+		struct dbr_frame frame = {
+			.send_beg = send_beg,
+			.send_end = os_gettime_ns(),
+			.size     = size
+		};
+		dbr_add_frame(stream, &frame);
+	}
 
 	obs_free_encoder_packet(packet);
 
@@ -354,6 +715,9 @@ static void *send_thread(void *data)
 			os_atomic_set_bool(&stream->disconnected, true);
 			break;
 		}
+
+		if (stream->dbr_enabled)
+			dbr_check(stream);
 	}
 
 	if (disconnected(stream)) {
@@ -364,6 +728,9 @@ static void *send_thread(void *data)
 
 	RTMP_Close(&stream->rtmp);
 
+	if (stream->dbr_enabled)
+		dbr_restore(stream);
+
 	if (!stopping(stream)) {
 		pthread_detach(stream->send_thread);
 		obs_output_signal_stop(stream->output, OBS_OUTPUT_DISCONNECTED);
@@ -629,7 +996,7 @@ static int try_connect(struct rtmp_stream *stream)
 		RTMP_AddStream(&stream->rtmp, encoder_name);
 	}
 
-	stream->rtmp.m_outChunkSize       = 4096;
+	stream->rtmp.m_outChunkSize       = stream->chunk_size;
 	stream->rtmp.m_bSendChunkSizeInfo = true;
 	stream->rtmp.m_bUseNagle          = true;
 
@@ -680,9 +1047,21 @@ static bool init_connect(struct rtmp_stream *stream)
 	stream->max_shutdown_time_sec =
 		(int)obs_data_get_int(settings, OPT_MAX_SHUTDOWN_TIME_SEC);
 
+	stream->chunk_size =
+		(int)obs_data_get_int(settings, OPT_CHUNK_SIZE);
+	if (stream->chunk_size < MIN_CHUNK_SIZE)
+		stream->chunk_size = MIN_CHUNK_SIZE;
+	else if (stream->chunk_size > MAX_CHUNK_SIZE)
+		stream->chunk_size = MAX_CHUNK_SIZE;
+
 	bind_ip = obs_data_get_string(settings, OPT_BIND_IP);
 	dstr_copy(&stream->bind_ip, bind_ip);
 
+	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE) &&
+		dbr_supported(stream);
+	if (stream->dbr_enabled)
+		dbr_init(stream);
+
 	obs_data_release(settings);
 	return true;
 }
@@ -858,6 +1237,8 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_int(defaults, OPT_DROP_THRESHOLD, 600);
 	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 5);
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
+	obs_data_set_default_int(defaults, OPT_CHUNK_SIZE, 4096);
+	obs_data_set_default_bool(defaults, OPT_DYN_BITRATE, false);
 }
 
 static obs_properties_t *rtmp_stream_properties(void *unused)
@@ -871,6 +1252,8 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 	obs_properties_add_int(props, OPT_DROP_THRESHOLD,
 			obs_module_text("RTMPStream.DropThreshold"),
 			200, 10000, 100);
+	obs_properties_add_bool(props, OPT_DYN_BITRATE,
+			obs_module_text("RTMPStream.DynamicBitrate"));
 
 	p = obs_properties_add_list(props, OPT_BIND_IP,
 			obs_module_text("RTMPStream.BindIP"),
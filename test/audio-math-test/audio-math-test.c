@@ -0,0 +1,249 @@
+/*
+ * Checks the audio_mix_* and audio_level_* sample buffer operations.
+ *
+ * Each operation is run on random samples with AVX2 and with it disabled,
+ * and the mixing operations are also run as the plain C loops they stand in
+ * for.  Mixing results have to match exactly.  Level sums are accumulated
+ * in a different order, so they only have to be close.
+ *
+ * Buffers are deliberately misaligned by one sample, and the counts leave
+ * remainders after the 4 and 8 sample vector loops.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/audio-math.h>
+
+#define MAX_COUNT 1027
+
+static const size_t counts[] = {1, 3, 4, 7, 8, 15, 17, 480, 1024, MAX_COUNT};
+
+enum impl {
+	IMPL_C,
+	IMPL_SSE,
+	IMPL_AVX2,
+	NUM_IMPLS
+};
+
+static const char *impl_names[NUM_IMPLS] = {"C", "SSE", "AVX2"};
+
+struct buffers {
+	float *dst;
+	float *src;
+	float *vol;
+	float *b;
+};
+
+static float *alloc_samples(void)
+{
+	/* one extra sample so the buffers can be offset off alignment */
+	return bmalloc((MAX_COUNT + 1) * sizeof(float));
+}
+
+static void randomize(float *data, size_t count, float range)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) *
+			range;
+}
+
+static void run_mix(const char *name, enum impl impl, float *dst,
+		const float *src, const float *vol, const float *b,
+		size_t count)
+{
+	if (impl == IMPL_C) {
+		if (strcmp(name, "audio_mix_add") == 0) {
+			for (size_t i = 0; i < count; i++)
+				dst[i] += src[i];
+		} else if (strcmp(name, "audio_mix_scale") == 0) {
+			for (size_t i = 0; i < count; i++)
+				dst[i] *= vol[0];
+		} else if (strcmp(name, "audio_mix_scale_buf") == 0) {
+			for (size_t i = 0; i < count; i++)
+				dst[i] *= vol[i];
+		} else if (strcmp(name, "audio_mix_add_scaled") == 0) {
+			for (size_t i = 0; i < count; i++)
+				dst[i] += src[i] * vol[0];
+		} else if (strcmp(name, "audio_mix_add_scaled_buf") == 0) {
+			for (size_t i = 0; i < count; i++)
+				dst[i] += src[i] * vol[i];
+		} else if (strcmp(name, "audio_mix_clamp") == 0) {
+			for (size_t i = 0; i < count; i++) {
+				float val = dst[i];
+				val = (val >  1.0f) ?  1.0f : val;
+				val = (val < -1.0f) ? -1.0f : val;
+				dst[i] = val;
+			}
+		} else if (strcmp(name, "audio_mix_crossfade") == 0) {
+			for (size_t i = 0; i < count; i++) {
+				float t = 0.25f + (0.5f / (float)count) *
+					(float)i;
+				dst[i] = src[i] * (1.0f - t) + b[i] * t;
+			}
+		}
+		return;
+	}
+
+	os_cpu_force_disable_avx2(impl != IMPL_AVX2);
+
+	if (strcmp(name, "audio_mix_add") == 0)
+		audio_mix_add(dst, src, count);
+	else if (strcmp(name, "audio_mix_scale") == 0)
+		audio_mix_scale(dst, vol[0], count);
+	else if (strcmp(name, "audio_mix_scale_buf") == 0)
+		audio_mix_scale_buf(dst, vol, count);
+	else if (strcmp(name, "audio_mix_add_scaled") == 0)
+		audio_mix_add_scaled(dst, src, vol[0], count);
+	else if (strcmp(name, "audio_mix_add_scaled_buf") == 0)
+		audio_mix_add_scaled_buf(dst, src, vol, count);
+	else if (strcmp(name, "audio_mix_clamp") == 0)
+		audio_mix_clamp(dst, count);
+	else if (strcmp(name, "audio_mix_crossfade") == 0)
+		audio_mix_crossfade(dst, src, b, 0.25f, 0.5f / (float)count,
+				count);
+
+	os_cpu_force_disable_avx2(false);
+}
+
+static bool test_mix(const char *name, struct buffers *in, size_t count,
+		bool have_avx2)
+{
+	float *results[NUM_IMPLS] = {0};
+	bool success = true;
+
+	for (int impl = 0; impl < NUM_IMPLS; impl++) {
+		if (impl == IMPL_AVX2 && !have_avx2)
+			continue;
+
+		results[impl] = alloc_samples();
+		memcpy(results[impl] + 1, in->dst, count * sizeof(float));
+		run_mix(name, impl, results[impl] + 1, in->src, in->vol,
+				in->b, count);
+	}
+
+	for (int impl = IMPL_SSE; impl < NUM_IMPLS && success; impl++) {
+		if (!results[impl])
+			continue;
+
+		for (size_t i = 0; i < count; i++) {
+			float expected = results[IMPL_C][i + 1];
+			float actual = results[impl][i + 1];
+
+			if (memcmp(&expected, &actual, sizeof(float)) != 0) {
+				printf("FAIL %s (%s, %u samples): sample %u, "
+				       "expected %.9g got %.9g\n",
+				       name, impl_names[impl],
+				       (unsigned)count, (unsigned)i,
+				       expected, actual);
+				success = false;
+				break;
+			}
+		}
+	}
+
+	for (int impl = 0; impl < NUM_IMPLS; impl++)
+		bfree(results[impl]);
+	return success;
+}
+
+static bool test_level_scan(const float *src, size_t count, bool have_avx2)
+{
+	double expected_sum = 0.0;
+	float expected_peak = 0.0f;
+	bool success = true;
+
+	for (size_t i = 0; i < count; i++) {
+		float val = fabsf(src[i]);
+		expected_sum += (double)val * (double)val;
+		if (val > expected_peak)
+			expected_peak = val;
+	}
+
+	for (int impl = IMPL_SSE; impl < NUM_IMPLS; impl++) {
+		float peak = 0.0f;
+		float sum = 0.0f;
+
+		if (impl == IMPL_AVX2 && !have_avx2)
+			continue;
+
+		os_cpu_force_disable_avx2(impl != IMPL_AVX2);
+		audio_level_scan(src, count, &peak, &sum);
+		os_cpu_force_disable_avx2(false);
+
+		if (peak != expected_peak ||
+		    fabs((double)sum - expected_sum) >
+				expected_sum * 1e-5 + 1e-9) {
+			printf("FAIL audio_level_scan (%s, %u samples): "
+			       "peak %.9g sum %.9g, expected peak %.9g "
+			       "sum %.9g\n",
+			       impl_names[impl], (unsigned)count,
+			       peak, sum, expected_peak, expected_sum);
+			success = false;
+		}
+	}
+
+	return success;
+}
+
+int main(void)
+{
+	static const char *mix_funcs[] = {
+		"audio_mix_add",
+		"audio_mix_scale",
+		"audio_mix_scale_buf",
+		"audio_mix_add_scaled",
+		"audio_mix_add_scaled_buf",
+		"audio_mix_clamp",
+		"audio_mix_crossfade",
+	};
+
+	bool have_avx2 = os_cpu_has_avx2();
+	struct buffers in;
+	int failures = 0;
+	int tests = 0;
+
+	if (!have_avx2)
+		printf("AVX2 is not supported on this machine, only checking "
+		       "the SSE versions\n");
+
+	srand(1);
+
+	in.dst = alloc_samples() + 1;
+	in.src = alloc_samples() + 1;
+	in.vol = alloc_samples() + 1;
+	in.b   = alloc_samples() + 1;
+
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		size_t count = counts[c];
+
+		/* mixed sums go past 1.0, which exercises the clamp */
+		randomize(in.dst, count, 1.5f);
+		randomize(in.src, count, 1.0f);
+		randomize(in.vol, count, 1.0f);
+		randomize(in.b,   count, 1.0f);
+
+		for (size_t f = 0; f < sizeof(mix_funcs) / sizeof(mix_funcs[0]);
+		     f++) {
+			tests++;
+			if (!test_mix(mix_funcs[f], &in, count, have_avx2))
+				failures++;
+		}
+
+		tests++;
+		if (!test_level_scan(in.src, count, have_avx2))
+			failures++;
+	}
+
+	bfree(in.dst - 1);
+	bfree(in.src - 1);
+	bfree(in.vol - 1);
+	bfree(in.b - 1);
+
+	printf("%d of %d audio math tests passed\n", tests - failures, tests);
+	return failures ? 1 : 0;
+}
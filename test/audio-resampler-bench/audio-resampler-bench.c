@@ -0,0 +1,224 @@
+/*
+ * Compares the speed of the audio_resampler_* conversions, with the native
+ * resampler enabled, with libswresample doing the same work.
+ *
+ * Each conversion pushes 60 seconds of audio through in 10 millisecond
+ * packets, the way a capture source would.  Besides the total time, the
+ * number of seconds of audio converted per second of run time is printed.
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/audio-resampler.h>
+
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+#include <libswresample/swresample.h>
+
+#define BENCH_SECONDS 60
+#define PACKETS_PER_SECOND 100
+
+struct conversion {
+	const char          *name;
+	struct resample_info src;
+	struct resample_info dst;
+};
+
+static const struct conversion conversions[] = {
+	{"44.1k stereo float planar -> 48k stereo float planar",
+		{44100, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO},
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"44.1k stereo s16 -> 48k stereo float planar",
+		{44100, AUDIO_FORMAT_16BIT, SPEAKERS_STEREO},
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"32k mono s16 -> 48k stereo float planar",
+		{32000, AUDIO_FORMAT_16BIT, SPEAKERS_MONO},
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"48k 5.1 float -> 48k stereo float planar",
+		{48000, AUDIO_FORMAT_FLOAT, SPEAKERS_5POINT1},
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"96k stereo s32 -> 48k stereo float planar",
+		{96000, AUDIO_FORMAT_32BIT, SPEAKERS_STEREO},
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"48k stereo float planar -> 44.1k stereo s16",
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO},
+		{44100, AUDIO_FORMAT_16BIT, SPEAKERS_STEREO}},
+};
+
+static enum AVSampleFormat convert_audio_format(enum audio_format format)
+{
+	switch (format) {
+	case AUDIO_FORMAT_UNKNOWN:      return AV_SAMPLE_FMT_S16;
+	case AUDIO_FORMAT_U8BIT:        return AV_SAMPLE_FMT_U8;
+	case AUDIO_FORMAT_16BIT:        return AV_SAMPLE_FMT_S16;
+	case AUDIO_FORMAT_32BIT:        return AV_SAMPLE_FMT_S32;
+	case AUDIO_FORMAT_FLOAT:        return AV_SAMPLE_FMT_FLT;
+	case AUDIO_FORMAT_U8BIT_PLANAR: return AV_SAMPLE_FMT_U8P;
+	case AUDIO_FORMAT_16BIT_PLANAR: return AV_SAMPLE_FMT_S16P;
+	case AUDIO_FORMAT_32BIT_PLANAR: return AV_SAMPLE_FMT_S32P;
+	case AUDIO_FORMAT_FLOAT_PLANAR: return AV_SAMPLE_FMT_FLTP;
+	}
+
+	return AV_SAMPLE_FMT_S16;
+}
+
+static uint64_t convert_speaker_layout(enum speaker_layout layout)
+{
+	switch (layout) {
+	case SPEAKERS_MONO:             return AV_CH_LAYOUT_MONO;
+	case SPEAKERS_STEREO:           return AV_CH_LAYOUT_STEREO;
+	case SPEAKERS_5POINT1:          return AV_CH_LAYOUT_5POINT1;
+	default:                        return 0;
+	}
+}
+
+/* fills the input planes with a sine wave in the source format */
+static void fill_input(const struct resample_info *info, uint8_t *planes[],
+		uint32_t frames)
+{
+	size_t channels = get_audio_channels(info->speakers);
+	size_t bytes = get_audio_bytes_per_channel(info->format);
+	bool planar = is_audio_planar(info->format);
+
+	for (uint32_t i = 0; i < frames; i++) {
+		double val = 0.5 * sin(2.0 * M_PI * 1000.0 * i /
+				info->samples_per_sec);
+
+		for (size_t ch = 0; ch < channels; ch++) {
+			uint8_t *out = planar ?
+				planes[ch] + i * bytes :
+				planes[0] + (i * channels + ch) * bytes;
+
+			switch (bytes) {
+			case 2: *(int16_t*)out = (int16_t)(val * 32767.0);
+				break;
+			case 4:
+				if (info->format == AUDIO_FORMAT_FLOAT ||
+				    info->format == AUDIO_FORMAT_FLOAT_PLANAR)
+					*(float*)out = (float)val;
+				else
+					*(int32_t*)out =
+						(int32_t)(val * 2147483647.0);
+				break;
+			default:
+				*out = (uint8_t)(val * 127.0 + 128.0);
+			}
+		}
+	}
+}
+
+static double bench_native(const struct conversion *conv,
+		const uint8_t *const planes[], uint32_t frames)
+{
+	audio_resampler_t *rs = audio_resampler_create(&conv->dst,
+			&conv->src);
+	uint64_t start;
+	uint64_t end;
+
+	if (!rs)
+		return 0.0;
+
+	start = os_gettime_ns();
+
+	for (int i = 0; i < BENCH_SECONDS * PACKETS_PER_SECOND; i++) {
+		uint8_t *output[MAX_AV_PLANES];
+		uint32_t out_frames;
+		uint64_t ts_offset;
+
+		audio_resampler_resample(rs, output, &out_frames, &ts_offset,
+				planes, frames);
+	}
+
+	end = os_gettime_ns();
+	audio_resampler_destroy(rs);
+	return (double)(end - start) / 1000000.0;
+}
+
+static double bench_swr(const struct conversion *conv,
+		const uint8_t *const planes[], uint32_t frames)
+{
+	enum AVSampleFormat out_format = convert_audio_format(
+			conv->dst.format);
+	int out_ch = (int)get_audio_channels(conv->dst.speakers);
+	uint8_t *output[MAX_AV_PLANES] = {0};
+	struct SwrContext *swr;
+	int out_size;
+	uint64_t start;
+	uint64_t end;
+
+	swr = swr_alloc_set_opts(NULL,
+		convert_speaker_layout(conv->dst.speakers), out_format,
+		conv->dst.samples_per_sec,
+		convert_speaker_layout(conv->src.speakers),
+		convert_audio_format(conv->src.format),
+		conv->src.samples_per_sec,
+		0, NULL);
+
+	if (!swr || swr_init(swr) != 0) {
+		swr_free(&swr);
+		return 0.0;
+	}
+
+	out_size = frames * 2 + 256;
+	av_samples_alloc(output, NULL, out_ch, out_size, out_format, 0);
+
+	start = os_gettime_ns();
+
+	for (int i = 0; i < BENCH_SECONDS * PACKETS_PER_SECOND; i++)
+		swr_convert(swr, output, out_size,
+				(const uint8_t**)planes, frames);
+
+	end = os_gettime_ns();
+
+	av_freep(&output[0]);
+	swr_free(&swr);
+	return (double)(end - start) / 1000000.0;
+}
+
+static inline double realtime_factor(double ms)
+{
+	return ms > 0.0 ? (double)BENCH_SECONDS * 1000.0 / ms : 0.0;
+}
+
+int main(void)
+{
+	audio_resampler_set_native(true);
+
+	printf("%-55s %12s %12s %10s %10s\n", "conversion", "native (ms)",
+			"swr (ms)", "native x", "swr x");
+
+	for (size_t i = 0; i < sizeof(conversions) / sizeof(conversions[0]);
+	     i++) {
+		const struct conversion *conv = &conversions[i];
+		uint32_t frames = conv->src.samples_per_sec /
+			PACKETS_PER_SECOND;
+		size_t size = get_audio_size(conv->src.format,
+				conv->src.speakers, frames);
+		uint8_t *planes[MAX_AV_PLANES] = {0};
+		double native_ms;
+		double swr_ms;
+
+		for (size_t p = 0; p < get_audio_planes(conv->src.format,
+					conv->src.speakers); p++)
+			planes[p] = bmalloc(size);
+
+		fill_input(&conv->src, planes, frames);
+
+		native_ms = bench_native(conv,
+				(const uint8_t *const *)planes, frames);
+		swr_ms = bench_swr(conv,
+				(const uint8_t *const *)planes, frames);
+
+		printf("%-55s %12.1f %12.1f %10.0f %10.0f\n", conv->name,
+				native_ms, swr_ms, realtime_factor(native_ms),
+				realtime_factor(swr_ms));
+
+		for (size_t p = 0; p < MAX_AV_PLANES; p++)
+			bfree(planes[p]);
+	}
+
+	return 0;
+}
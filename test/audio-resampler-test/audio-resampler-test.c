@@ -0,0 +1,399 @@
+/*
+ * Checks the output of the native resampler against libswresample.
+ *
+ * Each conversion is run once with the native resampler and once with
+ * libswresample, on two seconds of a signal made of four sine tones sent in
+ * 10 millisecond packets.  The tones are then measured over one second of
+ * each output, skipping the first half second.  Both outputs have to keep
+ * every tone at its original level, add little noise or distortion, and
+ * delay the signal by the ts_offset they report.  The native output also
+ * has to agree with the swr output on tone levels and delay.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <util/bmem.h>
+#include <media-io/audio-resampler.h>
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#define TEST_SECONDS 2
+#define PACKETS_PER_SECOND 100
+
+#define TONE_AMPLITUDE 0.2
+
+/* allowed tone level error, in dB */
+#define MAX_LEVEL_ERROR_DB 0.1
+/* allowed rms of what's left after removing the tones */
+#define MAX_RESIDUAL 0.001
+
+static const double tones[] = {440.0, 1000.0, 3000.0, 7000.0};
+#define NUM_TONES (sizeof(tones) / sizeof(tones[0]))
+
+struct conversion {
+	const char          *name;
+	struct resample_info src;
+	struct resample_info dst;
+};
+
+static const struct conversion conversions[] = {
+	{"44.1k stereo float planar -> 48k stereo float planar",
+		{44100, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO},
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"44.1k stereo s16 -> 48k stereo float planar",
+		{44100, AUDIO_FORMAT_16BIT, SPEAKERS_STEREO},
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"32k mono s16 -> 48k mono float planar",
+		{32000, AUDIO_FORMAT_16BIT, SPEAKERS_MONO},
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_MONO}},
+	{"96k stereo s32 -> 48k stereo float planar",
+		{96000, AUDIO_FORMAT_32BIT, SPEAKERS_STEREO},
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+	{"48k stereo float planar -> 44.1k stereo s16",
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO},
+		{44100, AUDIO_FORMAT_16BIT, SPEAKERS_STEREO}},
+	{"48k stereo float -> 48k stereo float planar",
+		{48000, AUDIO_FORMAT_FLOAT, SPEAKERS_STEREO},
+		{48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}},
+};
+
+#define NUM_CONVERSIONS (sizeof(conversions) / sizeof(conversions[0]))
+
+struct tone_result {
+	double level;
+	double delay;
+};
+
+struct result {
+	struct tone_result tones[NUM_TONES];
+	double             residual;
+	double             ts_offset;
+};
+
+static inline bool is_float_format(enum audio_format format)
+{
+	return format == AUDIO_FORMAT_FLOAT ||
+	       format == AUDIO_FORMAT_FLOAT_PLANAR;
+}
+
+static double get_signal(uint32_t rate, size_t frame)
+{
+	double t = (double)frame / (double)rate;
+	double val = 0.0;
+
+	for (size_t i = 0; i < NUM_TONES; i++)
+		val += TONE_AMPLITUDE * sin(2.0 * M_PI * tones[i] * t);
+	return val;
+}
+
+/* writes frames [start, start + frames) of the test signal */
+static void fill_input(const struct resample_info *info, uint8_t *planes[],
+		size_t start, uint32_t frames)
+{
+	size_t channels = get_audio_channels(info->speakers);
+	size_t bytes = get_audio_bytes_per_channel(info->format);
+	bool planar = is_audio_planar(info->format);
+
+	for (uint32_t i = 0; i < frames; i++) {
+		double val = get_signal(info->samples_per_sec, start + i);
+
+		for (size_t ch = 0; ch < channels; ch++) {
+			uint8_t *out = planar ?
+				planes[ch] + i * bytes :
+				planes[0] + (i * channels + ch) * bytes;
+
+			switch (bytes) {
+			case 2: *(int16_t*)out = (int16_t)(val * 32767.0);
+				break;
+			case 4:
+				if (is_float_format(info->format))
+					*(float*)out = (float)val;
+				else
+					*(int32_t*)out =
+						(int32_t)(val * 2147483647.0);
+				break;
+			default:
+				*out = (uint8_t)(val * 127.0 + 128.0);
+			}
+		}
+	}
+}
+
+/* appends an output packet to the per channel float buffers */
+static void read_output(const struct resample_info *info, float *out[],
+		size_t pos, uint8_t *const planes[], uint32_t frames)
+{
+	size_t channels = get_audio_channels(info->speakers);
+	size_t bytes = get_audio_bytes_per_channel(info->format);
+	bool planar = is_audio_planar(info->format);
+
+	for (uint32_t i = 0; i < frames; i++) {
+		for (size_t ch = 0; ch < channels; ch++) {
+			const uint8_t *in = planar ?
+				planes[ch] + i * bytes :
+				planes[0] + (i * channels + ch) * bytes;
+			float val;
+
+			switch (bytes) {
+			case 2: val = (float)*(const int16_t*)in / 32767.0f;
+				break;
+			case 4:
+				if (is_float_format(info->format))
+					val = *(const float*)in;
+				else
+					val = (float)(*(const int32_t*)in /
+							2147483647.0);
+				break;
+			default:
+				val = (float)(*in - 128) / 127.0f;
+			}
+
+			out[ch][pos + i] = val;
+		}
+	}
+}
+
+/* every tone completes a whole number of cycles in the one second window,
+ * so projecting onto each tone measures it independently of the others */
+static void measure_channel(uint32_t rate, const float *data,
+		struct result *result)
+{
+	size_t start = rate / 2;
+	double residual = 0.0;
+	double a[NUM_TONES];
+	double b[NUM_TONES];
+
+	for (size_t i = 0; i < NUM_TONES; i++) {
+		double w = 2.0 * M_PI * tones[i] / (double)rate;
+
+		a[i] = 0.0;
+		b[i] = 0.0;
+
+		for (size_t n = start; n < start + rate; n++) {
+			a[i] += data[n] * sin(w * (double)n);
+			b[i] += data[n] * cos(w * (double)n);
+		}
+
+		a[i] *= 2.0 / (double)rate;
+		b[i] *= 2.0 / (double)rate;
+	}
+
+	for (size_t n = start; n < start + rate; n++) {
+		double val = data[n];
+
+		for (size_t i = 0; i < NUM_TONES; i++) {
+			double w = 2.0 * M_PI * tones[i] / (double)rate;
+			val -= a[i] * sin(w * (double)n) +
+				b[i] * cos(w * (double)n);
+		}
+
+		residual += val * val;
+	}
+
+	residual = sqrt(residual / (double)rate);
+	if (residual > result->residual)
+		result->residual = residual;
+
+	/* a * sin(wn) + b * cos(wn) = level * sin(w(n - delay)).  channels
+	 * are identical, so the last one measured is kept */
+	for (size_t i = 0; i < NUM_TONES; i++) {
+		result->tones[i].level = sqrt(a[i] * a[i] + b[i] * b[i]);
+		result->tones[i].delay = -atan2(b[i], a[i]) /
+			(2.0 * M_PI * tones[i]);
+	}
+}
+
+static bool run_conversion(const struct conversion *conv, bool native,
+		struct result *result)
+{
+	const struct resample_info *src = &conv->src;
+	const struct resample_info *dst = &conv->dst;
+	uint32_t frames = src->samples_per_sec / PACKETS_PER_SECOND;
+	size_t in_size = get_audio_size(src->format, src->speakers, frames);
+	size_t in_planes = get_audio_planes(src->format, src->speakers);
+	size_t out_ch = get_audio_channels(dst->speakers);
+	size_t out_capacity = dst->samples_per_sec * TEST_SECONDS * 2;
+	uint8_t *planes[MAX_AV_PLANES] = {0};
+	float *out[MAX_AV_PLANES] = {0};
+	size_t out_frames = 0;
+	audio_resampler_t *rs;
+	bool success = false;
+
+	memset(result, 0, sizeof(*result));
+
+	audio_resampler_set_native(native);
+	rs = audio_resampler_create(dst, src);
+	if (!rs) {
+		printf("FAIL %s (%s): could not create resampler\n",
+				conv->name, native ? "native" : "swr");
+		return false;
+	}
+
+	for (size_t p = 0; p < in_planes; p++)
+		planes[p] = bmalloc(in_size);
+	for (size_t ch = 0; ch < out_ch; ch++)
+		out[ch] = bzalloc(out_capacity * sizeof(float));
+
+	for (size_t i = 0; i < TEST_SECONDS * PACKETS_PER_SECOND; i++) {
+		uint8_t *output[MAX_AV_PLANES];
+		uint32_t count;
+		uint64_t ts_offset;
+
+		fill_input(src, planes, i * frames, frames);
+
+		if (!audio_resampler_resample(rs, output, &count, &ts_offset,
+					(const uint8_t *const *)planes,
+					frames)) {
+			printf("FAIL %s (%s): resampling failed\n",
+					conv->name, native ? "native" : "swr");
+			goto fail;
+		}
+
+		/* the output starts at the timestamp of the first packet
+		 * minus its offset, so that's the delay the output should
+		 * have relative to the input */
+		if (i == 0)
+			result->ts_offset = (double)ts_offset / 1000000000.0;
+
+		if (out_frames + count > out_capacity)
+			count = (uint32_t)(out_capacity - out_frames);
+
+		read_output(dst, out, out_frames, output, count);
+		out_frames += count;
+	}
+
+	if (out_frames < dst->samples_per_sec * 3 / 2) {
+		printf("FAIL %s (%s): only %u frames of output\n", conv->name,
+				native ? "native" : "swr",
+				(unsigned)out_frames);
+		goto fail;
+	}
+
+	for (size_t ch = 0; ch < out_ch; ch++)
+		measure_channel(dst->samples_per_sec, out[ch], result);
+
+	success = true;
+
+fail:
+	for (size_t p = 0; p < MAX_AV_PLANES; p++) {
+		bfree(planes[p]);
+		bfree(out[p]);
+	}
+
+	audio_resampler_destroy(rs);
+	return success;
+}
+
+static inline double level_error_db(double level, double expected)
+{
+	return fabs(20.0 * log10(level / expected));
+}
+
+/* a delay that's off by a full period of a tone would look right, but every
+ * tone's period is far longer than any delay a resampler should add */
+static bool check_result(const struct conversion *conv, const char *impl,
+		const struct result *result)
+{
+	double sample_time = 1.0 / (double)conv->dst.samples_per_sec;
+	bool success = true;
+
+	for (size_t i = 0; i < NUM_TONES; i++) {
+		const struct tone_result *tone = &result->tones[i];
+
+		if (level_error_db(tone->level, TONE_AMPLITUDE) >
+				MAX_LEVEL_ERROR_DB) {
+			printf("FAIL %s (%s): %g Hz tone at %.3f dB\n",
+					conv->name, impl, tones[i],
+					20.0 * log10(tone->level /
+						TONE_AMPLITUDE));
+			success = false;
+		}
+
+		if (fabs(tone->delay - result->ts_offset) > sample_time) {
+			printf("FAIL %s (%s): %g Hz tone delayed by %.1f us, "
+					"ts_offset is %.1f us\n",
+					conv->name, impl, tones[i],
+					tone->delay * 1000000.0,
+					result->ts_offset * 1000000.0);
+			success = false;
+		}
+	}
+
+	if (result->residual > MAX_RESIDUAL) {
+		printf("FAIL %s (%s): noise and distortion at %.1f dB\n",
+				conv->name, impl, 20.0 * log10(result->residual));
+		success = false;
+	}
+
+	return success;
+}
+
+static bool compare_results(const struct conversion *conv,
+		const struct result *native, const struct result *swr)
+{
+	double sample_time = 1.0 / (double)conv->dst.samples_per_sec;
+	bool success = true;
+
+	for (size_t i = 0; i < NUM_TONES; i++) {
+		const struct tone_result *a = &native->tones[i];
+		const struct tone_result *b = &swr->tones[i];
+		double a_delay = a->delay - native->ts_offset;
+		double b_delay = b->delay - swr->ts_offset;
+
+		if (level_error_db(a->level, b->level) > MAX_LEVEL_ERROR_DB) {
+			printf("FAIL %s: %g Hz tone level differs from swr by "
+					"%.3f dB\n", conv->name, tones[i],
+					20.0 * log10(a->level / b->level));
+			success = false;
+		}
+
+		if (fabs(a_delay - b_delay) > sample_time) {
+			printf("FAIL %s: %g Hz tone timing differs from swr "
+					"by %.1f us\n", conv->name, tones[i],
+					(a_delay - b_delay) * 1000000.0);
+			success = false;
+		}
+	}
+
+	return success;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	for (size_t i = 0; i < NUM_CONVERSIONS; i++) {
+		const struct conversion *conv = &conversions[i];
+		struct result native;
+		struct result swr;
+		bool success = true;
+
+		if (!run_conversion(conv, true, &native) ||
+		    !run_conversion(conv, false, &swr)) {
+			failures++;
+			continue;
+		}
+
+		success &= check_result(conv, "native", &native);
+		success &= check_result(conv, "swr", &swr);
+		success &= compare_results(conv, &native, &swr);
+
+		printf("%s %s: native noise %.1f dB, swr noise %.1f dB\n",
+				success ? "ok  " : "FAIL", conv->name,
+				20.0 * log10(native.residual + 1e-12),
+				20.0 * log10(swr.residual + 1e-12));
+
+		if (!success)
+			failures++;
+	}
+
+	audio_resampler_set_native(false);
+
+	printf("%d of %d resampler comparisons passed\n",
+			(int)NUM_CONVERSIONS - failures, (int)NUM_CONVERSIONS);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,286 @@
+/*
+ * Checks the dynamic bitrate throughput window of the RTMP output.
+ *
+ * Frames are sent over a loopback TCP connection to a sink that only reads
+ * at a fixed rate, with small socket buffers so that sends block as they
+ * would on a congested link, and the window's estimate has to end up close
+ * to the rate of the sink.  The window is also fed sends that each take
+ * longer than the whole window, which must leave the newest send in it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <util/platform.h>
+#include <util/threading.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define closesocket(s) close(s)
+#endif
+
+#include "rtmp-dbr.h"
+
+#define SOCKET_BUFFER_SIZE (16 * 1024)
+#define FRAME_SIZE         4096
+#define SINK_READ_SIZE     1024
+#define RUN_NS             3000000000ULL
+#define MAX_ERROR          0.15
+
+struct sink {
+	SOCKET           socket;
+	long             kbps;
+	pthread_t        thread;
+};
+
+/* reads no faster than the sink's rate until the sender hangs up */
+static void *sink_thread(void *data)
+{
+	struct sink *sink = data;
+	uint64_t bytes_per_sec = (uint64_t)sink->kbps * 1000 / 8;
+	uint64_t start = os_gettime_ns();
+	uint64_t total = 0;
+	char buf[SINK_READ_SIZE];
+
+	for (;;) {
+		uint64_t due = start + total * 1000000000ULL / bytes_per_sec;
+		uint64_t now = os_gettime_ns();
+		int ret;
+
+		if (due > now)
+			os_sleepto_ns(due);
+
+		ret = recv(sink->socket, buf, sizeof(buf), 0);
+		if (ret <= 0)
+			break;
+
+		total += (uint64_t)ret;
+	}
+
+	return NULL;
+}
+
+static void set_buffer_sizes(SOCKET s)
+{
+	int size = SOCKET_BUFFER_SIZE;
+
+	setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char*)&size, sizeof(size));
+	setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof(size));
+}
+
+/* returns the sending end of a loopback connection, the receiving end is
+ * handed to the sink */
+static SOCKET connect_sink(struct sink *sink)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	SOCKET sender = INVALID_SOCKET;
+
+	sink->socket = INVALID_SOCKET;
+	if (listener == INVALID_SOCKET)
+		return INVALID_SOCKET;
+
+	/* the accepted socket takes its receive buffer from the listener */
+	set_buffer_sizes(listener);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+	    listen(listener, 1) != 0 ||
+	    getsockname(listener, (struct sockaddr*)&addr, &len) != 0)
+		goto fail;
+
+	sender = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sender == INVALID_SOCKET)
+		goto fail;
+
+	set_buffer_sizes(sender);
+
+	if (connect(sender, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+		goto fail;
+
+	sink->socket = accept(listener, NULL, NULL);
+	if (sink->socket == INVALID_SOCKET)
+		goto fail;
+
+	closesocket(listener);
+	return sender;
+
+fail:
+	if (sender != INVALID_SOCKET)
+		closesocket(sender);
+	closesocket(listener);
+	return INVALID_SOCKET;
+}
+
+static bool send_all(SOCKET s, const char *data, size_t size)
+{
+	while (size) {
+		int ret = send(s, data, (int)size, 0);
+		if (ret <= 0)
+			return false;
+
+		data += ret;
+		size -= (size_t)ret;
+	}
+
+	return true;
+}
+
+static bool run_sink(long kbps)
+{
+	struct dbr_window window = {0};
+	struct sink sink = {0};
+	char frame_data[FRAME_SIZE];
+	SOCKET sender;
+	uint64_t start;
+	long est = 0;
+	double error;
+	bool success = true;
+
+	memset(frame_data, 0x55, sizeof(frame_data));
+
+	sink.kbps = kbps;
+	sender = connect_sink(&sink);
+	if (sender == INVALID_SOCKET) {
+		printf("FAIL %ld kbps: could not connect to the sink\n", kbps);
+		return false;
+	}
+
+	if (pthread_create(&sink.thread, NULL, sink_thread, &sink) != 0) {
+		printf("FAIL %ld kbps: could not start the sink\n", kbps);
+		closesocket(sender);
+		closesocket(sink.socket);
+		return false;
+	}
+
+	start = os_gettime_ns();
+	while (os_gettime_ns() - start < RUN_NS) {
+		struct dbr_frame frame;
+
+		frame.send_beg = os_gettime_ns();
+		if (!send_all(sender, frame_data, sizeof(frame_data))) {
+			printf("FAIL %ld kbps: send failed\n", kbps);
+			success = false;
+			break;
+		}
+		frame.send_end = os_gettime_ns();
+		frame.size = sizeof(frame_data);
+
+		est = dbr_window_add(&window, &frame);
+	}
+
+	closesocket(sender);
+	pthread_join(sink.thread, NULL);
+	closesocket(sink.socket);
+	dbr_window_free(&window);
+
+	if (!success)
+		return false;
+
+	error = (double)(est - kbps) / (double)kbps;
+	printf("%ld kbps sink: estimated %ld kbps (%+.1f%%)\n", kbps, est,
+			error * 100.0);
+
+	if (error > MAX_ERROR || error < -MAX_ERROR) {
+		printf("FAIL %ld kbps: estimate is more than %d%% off\n", kbps,
+				(int)(MAX_ERROR * 100.0));
+		return false;
+	}
+
+	return true;
+}
+
+static bool check_window(const struct dbr_window *window, long est,
+		const struct dbr_frame *frame, const char *name)
+{
+	long expected = (long)(frame->size * 8 * 1000000ULL /
+			(frame->send_end - frame->send_beg));
+
+	if (window->frames.size != sizeof(*frame) ||
+	    window->data_size != frame->size || est != expected) {
+		printf("FAIL %s: %u frames, %u bytes, %ld kbps, expected one "
+		       "frame, %u bytes, %ld kbps\n", name,
+		       (unsigned)(window->frames.size / sizeof(*frame)),
+		       (unsigned)window->data_size, est,
+		       (unsigned)frame->size, expected);
+		return false;
+	}
+
+	return true;
+}
+
+/* a stalled connection can hold a single send for longer than the window */
+static bool run_long_sends(void)
+{
+	struct dbr_window window = {0};
+	struct dbr_frame frame = {0};
+	uint64_t t = 1000000000ULL;
+	bool success = true;
+	long est;
+
+	for (int i = 0; i < 100; i++) {
+		frame.send_beg = t;
+		frame.send_end = t += 5000000;
+		frame.size = FRAME_SIZE;
+		dbr_window_add(&window, &frame);
+	}
+
+	frame.send_beg = t;
+	frame.send_end = t += DBR_WINDOW_NS * 3 / 2;
+	frame.size = FRAME_SIZE * 2;
+	est = dbr_window_add(&window, &frame);
+	success = check_window(&window, est, &frame, "stalled send") &&
+		success;
+
+	frame.send_beg = t;
+	frame.send_end = t += DBR_WINDOW_NS;
+	frame.size = FRAME_SIZE * 3;
+	est = dbr_window_add(&window, &frame);
+	success = check_window(&window, est, &frame, "second stalled send") &&
+		success;
+
+	dbr_window_free(&window);
+
+	if (success)
+		printf("sends longer than the window keep the newest send\n");
+	return success;
+}
+
+int main(void)
+{
+	static const long rates[] = {8000, 2000, 500};
+	int failures = 0;
+
+#ifdef _WIN32
+	WSADATA wsad;
+	WSAStartup(MAKEWORD(2, 2), &wsad);
+#endif
+
+	if (!run_long_sends())
+		failures++;
+
+	for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+		if (!run_sink(rates[i]))
+			failures++;
+	}
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+
+	return failures ? 1 : 0;
+}
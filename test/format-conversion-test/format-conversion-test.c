@@ -0,0 +1,263 @@
+/*
+ * Checks that the AVX2 format conversion routines produce exactly the same
+ * output as the SSE2/C ones.
+ *
+ * Each conversion is run on random pixels for a few frame sizes, including
+ * widths that leave a remainder after the vector loops and bands that start
+ * part way down the frame, once with AVX2 and once with it disabled.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/format-conversion.h>
+
+/* the SSE2 loops read whole vectors, and decompress_422 works through
+ * min(in_linesize, out_linesize) / 2 dwords per row, which runs past the end
+ * of the last row, so every plane gets spare rows after it */
+#define SPARE_ROWS 2
+#define PADDING 64
+
+struct frame_size {
+	uint32_t width;
+	uint32_t height;
+};
+
+static const struct frame_size sizes[] = {
+	{1920, 1080},
+	{1280,  720},
+	{ 644,  362},
+	{ 100,   34},
+	{  20,    2},
+};
+
+struct plane {
+	uint8_t  *data;
+	uint32_t linesize;
+	size_t   size;
+};
+
+static void plane_init(struct plane *plane, uint32_t linesize,
+		uint32_t height)
+{
+	plane->linesize = linesize;
+	plane->size     = (size_t)linesize * (height + SPARE_ROWS) + PADDING;
+	plane->data     = bmalloc(plane->size);
+}
+
+static void plane_randomize(struct plane *plane)
+{
+	for (size_t i = 0; i < plane->size; i++)
+		plane->data[i] = (uint8_t)rand();
+}
+
+static void plane_clear(struct plane *plane)
+{
+	memset(plane->data, 0, plane->size);
+}
+
+static bool plane_compare(const char *name, const struct frame_size *size,
+		const char *plane_name, const struct plane *expected,
+		const struct plane *actual)
+{
+	for (size_t i = 0; i < expected->size; i++) {
+		if (expected->data[i] != actual->data[i]) {
+			printf("FAIL %s %ux%u: %s differs at offset %u "
+			       "(row %u), expected %u got %u\n",
+			       name, size->width, size->height, plane_name,
+			       (unsigned)i, (unsigned)(i / expected->linesize),
+			       expected->data[i], actual->data[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+typedef void (*compress_func)(const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[]);
+
+/* packed UYVX to planar conversions */
+static bool test_compress(const char *name, compress_func func,
+		const struct frame_size *size, uint32_t start_y, int planes,
+		bool half_chroma)
+{
+	uint32_t chroma_height = half_chroma ? size->height / 2 : size->height;
+	uint32_t chroma_width  = planes == 2 ? size->width :
+		(half_chroma ? size->width / 2 : size->width);
+	struct plane input;
+	struct plane expected[3];
+	struct plane actual[3];
+	uint8_t *out[3];
+	uint32_t out_linesize[3];
+	bool success = true;
+
+	plane_init(&input, size->width * 4, size->height);
+	plane_randomize(&input);
+
+	for (int i = 0; i < planes; i++) {
+		uint32_t linesize = i == 0 ? size->width : chroma_width;
+		uint32_t height   = i == 0 ? size->height : chroma_height;
+
+		plane_init(&expected[i], linesize, height);
+		plane_init(&actual[i], linesize, height);
+		plane_clear(&expected[i]);
+		plane_clear(&actual[i]);
+		out_linesize[i] = linesize;
+	}
+
+	os_cpu_force_disable_avx2(true);
+	for (int i = 0; i < planes; i++)
+		out[i] = expected[i].data;
+	func(input.data, input.linesize, start_y, size->height,
+			out, out_linesize);
+
+	os_cpu_force_disable_avx2(false);
+	for (int i = 0; i < planes; i++)
+		out[i] = actual[i].data;
+	func(input.data, input.linesize, start_y, size->height,
+			out, out_linesize);
+
+	for (int i = 0; i < planes; i++) {
+		const char *plane_names[] = {"Y", "U", "V"};
+		if (success)
+			success = plane_compare(name, size, plane_names[i],
+					&expected[i], &actual[i]);
+		bfree(expected[i].data);
+		bfree(actual[i].data);
+	}
+
+	bfree(input.data);
+	return success;
+}
+
+typedef void (*decompress_func)(const uint8_t *const input[],
+		const uint32_t in_linesize[], uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize);
+
+/* planar 4:2:0 to packed 4:4:4 conversions */
+static bool test_decompress(const char *name, decompress_func func,
+		const struct frame_size *size, uint32_t start_y, int planes)
+{
+	struct plane input[3];
+	struct plane expected;
+	struct plane actual;
+	const uint8_t *in[3];
+	uint32_t in_linesize[3];
+	bool success;
+
+	for (int i = 0; i < planes; i++) {
+		uint32_t linesize = i == 0 ? size->width :
+			(planes == 2 ? size->width : size->width / 2);
+		uint32_t height   = i == 0 ? size->height : size->height / 2;
+
+		plane_init(&input[i], linesize, height);
+		plane_randomize(&input[i]);
+		in[i] = input[i].data;
+		in_linesize[i] = linesize;
+	}
+
+	plane_init(&expected, size->width * 4, size->height);
+	plane_init(&actual, size->width * 4, size->height);
+	plane_clear(&expected);
+	plane_clear(&actual);
+
+	os_cpu_force_disable_avx2(true);
+	func(in, in_linesize, start_y, size->height, expected.data,
+			expected.linesize);
+	os_cpu_force_disable_avx2(false);
+	func(in, in_linesize, start_y, size->height, actual.data,
+			actual.linesize);
+
+	success = plane_compare(name, size, "output", &expected, &actual);
+
+	for (int i = 0; i < planes; i++)
+		bfree(input[i].data);
+	bfree(expected.data);
+	bfree(actual.data);
+	return success;
+}
+
+/* packed 4:2:2 to packed 4:4:4 conversions */
+static bool test_decompress_422(const char *name,
+		const struct frame_size *size, uint32_t start_y,
+		bool leading_lum)
+{
+	struct plane input;
+	struct plane expected;
+	struct plane actual;
+	bool success;
+
+	plane_init(&input, size->width * 2, size->height);
+	plane_randomize(&input);
+	plane_init(&expected, size->width * 4, size->height);
+	plane_init(&actual, size->width * 4, size->height);
+	plane_clear(&expected);
+	plane_clear(&actual);
+
+	os_cpu_force_disable_avx2(true);
+	decompress_422(input.data, input.linesize, start_y, size->height,
+			expected.data, expected.linesize, leading_lum);
+	os_cpu_force_disable_avx2(false);
+	decompress_422(input.data, input.linesize, start_y, size->height,
+			actual.data, actual.linesize, leading_lum);
+
+	success = plane_compare(name, size, "output", &expected, &actual);
+
+	bfree(input.data);
+	bfree(expected.data);
+	bfree(actual.data);
+	return success;
+}
+
+int main(void)
+{
+	int failures = 0;
+	int tests = 0;
+
+	if (!os_cpu_has_avx2()) {
+		printf("AVX2 is not supported on this machine, skipping\n");
+		return 0;
+	}
+
+	srand(1);
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		const struct frame_size *size = &sizes[i];
+
+		/* a full frame, then a band starting part way down */
+		uint32_t starts[2] = {0, (size->height / 4) & ~1};
+
+		for (int s = 0; s < 2; s++) {
+			uint32_t start_y = starts[s];
+
+#define check(test) do { tests++; if (!(test)) failures++; } while (false)
+			check(test_compress("compress_uyvx_to_i420",
+					compress_uyvx_to_i420, size, start_y,
+					3, true));
+			check(test_compress("compress_uyvx_to_nv12",
+					compress_uyvx_to_nv12, size, start_y,
+					2, true));
+			check(test_compress("convert_uyvx_to_i444",
+					convert_uyvx_to_i444, size, start_y,
+					3, false));
+			check(test_decompress("decompress_420",
+					decompress_420, size, start_y, 3));
+			check(test_decompress("decompress_nv12",
+					decompress_nv12, size, start_y, 2));
+			check(test_decompress_422("decompress_422 (YUYV)",
+					size, start_y, true));
+			check(test_decompress_422("decompress_422 (UYVY)",
+					size, start_y, false));
+#undef check
+		}
+	}
+
+	printf("%d of %d format conversion tests passed\n",
+			tests - failures, tests);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * Replays generated packet timelines through the output packet interleaver
+ * and through the single sorted array it replaced, and checks that both send
+ * exactly the same packets in the same order.
+ *
+ * Timelines have one to six audio tracks that each start at their own time,
+ * 30 or 60 fps video that may not start on a keyframe, and several audio
+ * timebases.  Some round every timestamp to 20 milliseconds so that packets
+ * of different tracks tie, and now and then a packet is held back and sent
+ * after the next one, so packets also arrive out of order.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <obs-internal.h>
+
+#include "reference-interleave.h"
+
+#define NUM_TIMELINES 300
+#define PACKETS_PER_TIMELINE 4000
+
+struct sent_packet {
+	enum obs_encoder_type type;
+	size_t                track_idx;
+	int64_t               dts;
+	int64_t               pts;
+	int64_t               dts_usec;
+	bool                  keyframe;
+	uint32_t              id;
+};
+
+struct sent_packets {
+	DARRAY(struct sent_packet) packets;
+};
+
+/* the same sequence on every platform, so a failing seed can be replayed */
+static inline uint32_t next_random(uint32_t *state)
+{
+	*state = *state * 1103515245 + 12345;
+	return (*state >> 8) & 0xFFFFFF;
+}
+
+static char audio_encoders[MAX_AUDIO_MIXES];
+
+static void record_packet(void *param, struct encoder_packet *packet)
+{
+	struct sent_packets *sent = param;
+	struct sent_packet *record = da_push_back_new(sent->packets);
+
+	record->type      = packet->type;
+	record->track_idx = packet->track_idx;
+	record->dts       = packet->dts;
+	record->pts       = packet->pts;
+	record->dts_usec  = packet->dts_usec;
+	record->keyframe  = packet->keyframe;
+	memcpy(&record->id, packet->data, sizeof(record->id));
+}
+
+static struct obs_output *create_output(struct sent_packets *sent,
+		size_t audio_mixes)
+{
+	struct obs_output *output = bzalloc(sizeof(*output));
+
+	pthread_mutex_init(&output->interleaved_mutex, NULL);
+	output->active = true;
+	output->info.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED |
+		OBS_OUTPUT_MULTI_TRACK;
+	output->info.encoded_packet = record_packet;
+	output->context.data = sent;
+
+	for (size_t i = 0; i < audio_mixes; i++)
+		output->audio_encoders[i] = (obs_encoder_t*)&audio_encoders[i];
+
+	return output;
+}
+
+static void destroy_output(struct obs_output *output)
+{
+	free_interleaved_packets(output);
+	pthread_mutex_destroy(&output->interleaved_mutex);
+	bfree(output);
+}
+
+static void init_reference(struct reference_output *output,
+		struct sent_packets *sent, size_t audio_mixes)
+{
+	memset(output, 0, sizeof(*output));
+	output->audio_mixes = audio_mixes;
+	output->encoded_packet = record_packet;
+	output->param = sent;
+
+	for (size_t i = 0; i < audio_mixes; i++)
+		output->audio_encoders[i] = (obs_encoder_t*)&audio_encoders[i];
+}
+
+static void send_packet(struct obs_output *output,
+		struct reference_output *reference,
+		const struct encoder_packet *packet)
+{
+	struct encoder_packet copy = *packet;
+
+	interleave_packets(output, &copy);
+	copy = *packet;
+	reference_interleave_packets(reference, &copy);
+}
+
+static void print_packet(const char *name, const struct sent_packet *packet)
+{
+	printf("  %-9s %s %d, id %u, dts %lld, pts %lld, dts_usec %lld%s\n",
+			name,
+			packet->type == OBS_ENCODER_VIDEO ? "video" : "audio",
+			(int)packet->track_idx, packet->id,
+			(long long)packet->dts, (long long)packet->pts,
+			(long long)packet->dts_usec,
+			packet->keyframe ? ", keyframe" : "");
+}
+
+static bool compare_sent(uint32_t seed, const struct sent_packets *sent,
+		const struct sent_packets *expected)
+{
+	size_t num = sent->packets.num < expected->packets.num ?
+		sent->packets.num : expected->packets.num;
+
+	for (size_t i = 0; i < num; i++) {
+		const struct sent_packet *a = sent->packets.array + i;
+		const struct sent_packet *b = expected->packets.array + i;
+
+		if (memcmp(a, b, sizeof(*a)) == 0)
+			continue;
+
+		printf("FAIL timeline %u: packet %u differs\n", seed,
+				(unsigned)i);
+		print_packet("sent", a);
+		print_packet("expected", b);
+		return false;
+	}
+
+	if (sent->packets.num != expected->packets.num) {
+		printf("FAIL timeline %u: %u packets sent, %u expected\n",
+				seed, (unsigned)sent->packets.num,
+				(unsigned)expected->packets.num);
+		return false;
+	}
+
+	return true;
+}
+
+static bool run_timeline(uint32_t seed, size_t *p_sent)
+{
+	static const int32_t audio_rates[] = {48000, 44100, 1000000};
+	uint32_t state = seed;
+	size_t audio_mixes = 1 + next_random(&state) % MAX_AUDIO_MIXES;
+	int32_t fps = (next_random(&state) % 2) ? 30 : 60;
+	int32_t rate = audio_rates[next_random(&state) % 3];
+	int64_t keyint = 1 + next_random(&state) % 40;
+	bool coarse = next_random(&state) % 3 == 0;
+	int64_t video_start = next_random(&state) % 500000;
+	int64_t video_dts = next_random(&state) % keyint;
+	int64_t video_next;
+	int64_t audio_start[MAX_AUDIO_MIXES];
+	int64_t audio_dts[MAX_AUDIO_MIXES];
+	int64_t audio_next[MAX_AUDIO_MIXES];
+
+	struct sent_packets sent = {0};
+	struct sent_packets expected = {0};
+	struct obs_output *output = create_output(&sent, audio_mixes);
+	struct reference_output reference;
+	struct encoder_packet held = {0};
+	bool holding = false;
+	uint32_t ids[PACKETS_PER_TIMELINE];
+	bool success;
+
+	init_reference(&reference, &expected, audio_mixes);
+
+	video_next = video_start + video_dts * 1000000LL / fps;
+	for (size_t i = 0; i < audio_mixes; i++) {
+		audio_start[i] = next_random(&state) % 500000;
+		audio_dts[i] = 0;
+		audio_next[i] = audio_start[i];
+	}
+
+	for (uint32_t n = 0; n < PACKETS_PER_TIMELINE; n++) {
+		struct encoder_packet packet = {0};
+		int64_t earliest;
+		int track = -1;
+
+		/* whichever track's next packet arrives first, with up to
+		 * 30 milliseconds of jitter */
+		earliest = video_next + next_random(&state) % 30000;
+		for (size_t i = 0; i < audio_mixes; i++) {
+			int64_t t = audio_next[i] + next_random(&state) % 30000;
+			if (t < earliest) {
+				earliest = t;
+				track = (int)i;
+			}
+		}
+
+		ids[n] = n;
+		packet.data = (uint8_t*)&ids[n];
+		packet.size = sizeof(ids[n]);
+		packet.timebase_num = 1;
+
+		if (track < 0) {
+			packet.type = OBS_ENCODER_VIDEO;
+			packet.timebase_den = fps;
+			packet.dts = packet.pts = video_dts;
+			packet.keyframe = video_dts % keyint == 0;
+			packet.dts_usec = video_next;
+
+			video_dts++;
+			video_next = video_start + video_dts * 1000000LL / fps;
+		} else {
+			size_t i = (size_t)track;
+
+			packet.type = OBS_ENCODER_AUDIO;
+			packet.encoder = (obs_encoder_t*)&audio_encoders[i];
+			packet.timebase_den = rate;
+			packet.dts = packet.pts = audio_dts[i];
+			packet.dts_usec = audio_next[i];
+
+			audio_dts[i] += 1024;
+			audio_next[i] = audio_start[i] +
+				audio_dts[i] * 1000000LL / rate;
+		}
+
+		if (coarse)
+			packet.dts_usec -= packet.dts_usec % 20000;
+		packet.sys_dts_usec = packet.dts_usec;
+
+		if (!holding && next_random(&state) % 20 == 0) {
+			held = packet;
+			holding = true;
+			continue;
+		}
+
+		send_packet(output, &reference, &packet);
+
+		if (holding) {
+			send_packet(output, &reference, &held);
+			holding = false;
+		}
+	}
+
+	success = compare_sent(seed, &sent, &expected);
+	*p_sent = sent.packets.num;
+
+	destroy_output(output);
+	reference_free_packets(&reference);
+	da_free(sent.packets);
+	da_free(expected.packets);
+	return success;
+}
+
+/* short timelines with long keyframe intervals may never get to send
+ * anything, but most of them should */
+int main(void)
+{
+	size_t total_sent = 0;
+	int failures = 0;
+
+	for (uint32_t seed = 1; seed <= NUM_TIMELINES; seed++) {
+		size_t sent = 0;
+
+		if (!run_timeline(seed, &sent))
+			failures++;
+		total_sent += sent;
+	}
+
+	printf("%d of %d interleave timelines matched, %u packets sent\n",
+			NUM_TIMELINES - failures, NUM_TIMELINES,
+			(unsigned)total_sent);
+
+	if (total_sent < NUM_TIMELINES * PACKETS_PER_TIMELINE / 2) {
+		printf("FAIL too few packets were sent to compare\n");
+		failures++;
+	}
+
+	return failures ? 1 : 0;
+}
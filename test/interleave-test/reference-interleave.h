@@ -0,0 +1,31 @@
+/*
+ * The packet interleaver outputs used before packets were queued per track:
+ * one array sorted by dts, inserted into with a linear scan.  Kept only to
+ * check that the current interleaver sends packets in the same order.
+ */
+
+#pragma once
+
+#include <util/darray.h>
+#include <obs.h>
+
+struct reference_output {
+	bool                  received_video;
+	bool                  received_audio;
+	int64_t               video_offset;
+	int64_t               audio_offsets[MAX_AUDIO_MIXES];
+	int64_t               highest_audio_ts;
+	int64_t               highest_video_ts;
+	DARRAY(struct encoder_packet) interleaved_packets;
+	int                   total_frames;
+
+	obs_encoder_t         *audio_encoders[MAX_AUDIO_MIXES];
+	size_t                audio_mixes;
+
+	void (*encoded_packet)(void *param, struct encoder_packet *packet);
+	void                  *param;
+};
+
+extern void reference_interleave_packets(struct reference_output *output,
+		struct encoder_packet *packet);
+extern void reference_free_packets(struct reference_output *output);
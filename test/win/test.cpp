@@ -95,6 +95,7 @@ static void CreateOBS(HWND hwnd)
 	ovi.output_format   = VIDEO_FORMAT_RGBA;
 	ovi.output_width    = rc.right;
 	ovi.output_height   = rc.bottom;
+	ovi.readback_depth  = 0;
 
 	if (obs_reset_video(&ovi) != 0)
 		throw "Couldn't initialize video";